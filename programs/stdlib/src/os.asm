@@ -11,6 +11,21 @@ global os_process_load_start:function
 global os_system:function
 global os_process_get_arguments:function
 global os_exit:function
+global os_swap_stats:function
+global os_zram_stats:function
+global os_ksm_control:function
+global os_ksm_stats:function
+global os_shm_open:function
+global os_shm_attach:function
+global os_shm_detach:function
+global os_disk_cache_stats:function
+global os_disk_flush:function
+global os_disk_queue_stats:function
+global os_disk_set_scheduler:function
+global os_disk_trace_control:function
+global os_disk_trace_read:function
+global os_aio_setup:function
+global os_aio_enter:function
 
 ; void print(const char* filename)
 print:
@@ -124,3 +139,203 @@ os_exit:
 
     pop ebp             ; retrive state of processor
     ret
+
+; void os_swap_stats(struct swap_stats* stats)
+os_swap_stats:
+    push ebp            ; saving state of processor
+    mov ebp, esp
+
+    push dword [ebp+8]  ; argument 'stats'
+    mov eax, 10         ; command swap stats
+    int 0x80
+    add esp, 4
+
+    pop ebp             ; retrive state of processor
+    ret
+
+; void os_zram_stats(struct zram_stats* stats)
+os_zram_stats:
+    push ebp            ; saving state of processor
+    mov ebp, esp
+
+    push dword [ebp+8]  ; argument 'stats'
+    mov eax, 11         ; command zram stats
+    int 0x80
+    add esp, 4
+
+    pop ebp             ; retrive state of processor
+    ret
+
+; void os_ksm_control(int pages_per_tick)
+os_ksm_control:
+    push ebp            ; saving state of processor
+    mov ebp, esp
+
+    push dword [ebp+8]  ; argument 'pages_per_tick'
+    mov eax, 12         ; command same page merging control
+    int 0x80
+    add esp, 4
+
+    pop ebp             ; retrive state of processor
+    ret
+
+; void os_ksm_stats(struct ksm_stats* stats)
+os_ksm_stats:
+    push ebp            ; saving state of processor
+    mov ebp, esp
+
+    push dword [ebp+8]  ; argument 'stats'
+    mov eax, 13         ; command same page merging stats
+    int 0x80
+    add esp, 4
+
+    pop ebp             ; retrive state of processor
+    ret
+
+; int os_shm_open(const char* name, size_t size)
+os_shm_open:
+    push ebp            ; saving state of processor
+    mov ebp, esp
+
+    push dword [ebp+12] ; argument 'size'
+    push dword [ebp+8]  ; argument 'name'
+    mov eax, 14         ; command shared memory open
+    int 0x80
+    add esp, 8
+
+    pop ebp             ; retrive state of processor
+    ret
+
+; void* os_shm_attach(int handle)
+os_shm_attach:
+    push ebp            ; saving state of processor
+    mov ebp, esp
+
+    push dword [ebp+8]  ; argument 'handle'
+    mov eax, 15         ; command shared memory attach
+    int 0x80
+    add esp, 4
+
+    pop ebp             ; retrive state of processor
+    ret
+
+; int os_shm_detach(void* ptr)
+os_shm_detach:
+    push ebp            ; saving state of processor
+    mov ebp, esp
+
+    push dword [ebp+8]  ; argument 'ptr'
+    mov eax, 16         ; command shared memory detach
+    int 0x80
+    add esp, 4
+
+    pop ebp             ; retrive state of processor
+    ret
+
+; void os_disk_cache_stats(struct disk_cache_stats* stats)
+os_disk_cache_stats:
+    push ebp            ; saving state of processor
+    mov ebp, esp
+
+    push dword [ebp+8]  ; argument 'stats'
+    mov eax, 17         ; command disk cache stats
+    int 0x80
+    add esp, 4
+
+    pop ebp             ; retrive state of processor
+    ret
+
+; int os_disk_flush(int drive)
+os_disk_flush:
+    push ebp            ; saving state of processor
+    mov ebp, esp
+
+    push dword [ebp+8]  ; argument 'drive'
+    mov eax, 18         ; command disk flush
+    int 0x80
+    add esp, 4
+
+    pop ebp             ; retrive state of processor
+    ret
+
+; int os_disk_queue_stats(int drive, struct disk_queue_stats* stats)
+os_disk_queue_stats:
+    push ebp            ; saving state of processor
+    mov ebp, esp
+
+    push dword [ebp+12] ; argument 'stats'
+    push dword [ebp+8]  ; argument 'drive'
+    mov eax, 19         ; command disk queue stats
+    int 0x80
+    add esp, 8
+
+    pop ebp             ; retrive state of processor
+    ret
+
+; int os_disk_set_scheduler(int drive, int scheduler)
+os_disk_set_scheduler:
+    push ebp            ; saving state of processor
+    mov ebp, esp
+
+    push dword [ebp+12] ; argument 'scheduler'
+    push dword [ebp+8]  ; argument 'drive'
+    mov eax, 20         ; command disk set scheduler
+    int 0x80
+    add esp, 8
+
+    pop ebp             ; retrive state of processor
+    ret
+
+; int os_disk_trace_control(int enable)
+os_disk_trace_control:
+    push ebp            ; saving state of processor
+    mov ebp, esp
+
+    push dword [ebp+8]  ; argument 'enable'
+    mov eax, 21         ; command disk trace control
+    int 0x80
+    add esp, 4
+
+    pop ebp             ; retrive state of processor
+    ret
+
+; int os_disk_trace_read(struct disk_trace_entry* entries, int max)
+os_disk_trace_read:
+    push ebp            ; saving state of processor
+    mov ebp, esp
+
+    push dword [ebp+12] ; argument 'max'
+    push dword [ebp+8]  ; argument 'entries'
+    mov eax, 22         ; command disk trace read
+    int 0x80
+    add esp, 8
+
+    pop ebp             ; retrive state of processor
+    ret
+
+; void* os_aio_setup(int entries)
+os_aio_setup:
+    push ebp            ; saving state of processor
+    mov ebp, esp
+
+    push dword [ebp+8]  ; argument 'entries'
+    mov eax, 23         ; command aio setup
+    int 0x80
+    add esp, 4
+
+    pop ebp             ; retrive state of processor
+    ret
+
+; int os_aio_enter(int to_submit, int min_complete)
+os_aio_enter:
+    push ebp            ; saving state of processor
+    mov ebp, esp
+
+    push dword [ebp+12] ; argument 'min_complete'
+    push dword [ebp+8]  ; argument 'to_submit'
+    mov eax, 24         ; command aio enter
+    int 0x80
+    add esp, 8
+
+    pop ebp             ; retrive state of processor
+    ret
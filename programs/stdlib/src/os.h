@@ -3,6 +3,7 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #define INVALID_COMMAND_ARGUMENT    10
 
@@ -18,6 +19,167 @@ struct process_arguments
     char **argv;
 };
 
+struct swap_stats
+{
+    uint32_t total_slots;
+    uint32_t used_slots;
+    uint32_t page_outs;
+    uint32_t page_ins;
+    uint32_t clean_evictions;
+    uint32_t faults;
+    /* time spent in disk transfers, in processor cycles */
+    uint64_t page_out_cycles;
+    uint64_t page_in_cycles;
+};
+
+struct zram_stats
+{
+    uint32_t pool_pages;
+    uint32_t stored_pages;
+    uint32_t compressed_bytes;
+    /* uncompressed over compressed size, times 100 */
+    uint32_t ratio_x100;
+    /* stored pages per pool page, times 100 */
+    uint32_t density_x100;
+    uint32_t page_outs;
+    uint32_t incompressible;
+    uint32_t faults;
+    uint64_t compress_cycles;
+    uint64_t decompress_cycles;
+};
+
+struct ksm_stats
+{
+    /* zero when the scanner is off */
+    uint32_t pages_per_tick;
+    uint32_t pages_scanned;
+    uint32_t full_scans;
+    /* shared frames in use */
+    uint32_t pages_shared;
+    /* process pages mapped to a shared frame */
+    uint32_t pages_sharing;
+    uint32_t saved_bytes;
+    /* writes that had to copy a shared frame */
+    uint32_t cow_breaks;
+    uint64_t scan_cycles;
+};
+
+struct disk_cache_stats
+{
+    uint32_t total_sectors;
+    uint32_t cached_sectors;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+    /* large reads that went around the cache */
+    uint32_t bypasses;
+
+    uint32_t dirty_sectors;
+    uint32_t writebacks;
+    /* dirty sectors that could not be written back and were dropped */
+    uint32_t write_errors;
+};
+
+#define DISK_SCHEDULER_NOOP        0
+#define DISK_SCHEDULER_DEADLINE    1
+#define DISK_HISTOGRAM_BUCKETS     32
+
+struct disk_queue_stats
+{
+    uint32_t scheduler;
+    uint32_t submitted;
+    /* requests that joined a neighbour instead of taking a command of their own */
+    uint32_t merges;
+    /* commands sent to the driver */
+    uint32_t dispatched;
+    uint32_t depth;
+    uint32_t max_depth;
+    /* from submission to completion */
+    uint64_t total_latency_cycles;
+    uint64_t max_latency_cycles;
+
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t read_sectors;
+    uint32_t write_sectors;
+    uint64_t read_bytes;
+    uint64_t write_bytes;
+    /* commands that failed */
+    uint32_t errors;
+
+    /* time spent in the driver per command, bucket n holds 2^n up to 2^(n+1) cycles */
+    uint32_t service_histogram[ DISK_HISTOGRAM_BUCKETS ];
+};
+
+/* requests the kernel issued on its own, cache write back for one */
+#define DISK_TRACE_KERNEL_PID    0xFFFFFFFF
+
+/* one completed request, times in cycles */
+struct disk_trace_entry
+{
+    uint32_t disk;
+    uint32_t pid;
+    uint32_t lba;
+    uint32_t total_sectors;
+    uint32_t write;
+    int32_t status;
+
+    uint64_t submitted;
+    /* sent to the driver, merged requests share it */
+    uint64_t issued;
+    uint64_t completed;
+};
+
+#define AIO_OP_NOP      0
+/* open the path in buffer with one of the AIO_OPEN modes in length, the result is the file descriptor */
+#define AIO_OP_OPEN     1
+/* read length bytes at offset into buffer, the result is the number of bytes read */
+#define AIO_OP_READ     2
+/* write length bytes from buffer at offset, or at the end of a file opened to append */
+#define AIO_OP_WRITE    3
+#define AIO_OP_CLOSE    4
+
+#define AIO_OPEN_READ   0
+/* creates the file, an existing one is truncated */
+#define AIO_OPEN_WRITE  1
+#define AIO_OPEN_APPEND 2
+
+struct aio_sqe
+{
+    uint32_t opcode;
+    int32_t fd;
+    uint32_t offset;
+    uint32_t length;
+    void *buffer;
+    uint32_t user_data;
+}
+__attribute__( ( packed ) );
+
+struct aio_cqe
+{
+    uint32_t user_data;
+    int32_t result;
+}
+__attribute__( ( packed ) );
+
+/*
+ * returned by os_aio_setup, submit by filling sqes at sq_tail and advancing it,
+ * completions appear at cq_head, advance it once they are consumed
+ */
+struct aio_ring
+{
+    uint32_t sq_head;
+    uint32_t sq_tail;
+    uint32_t cq_head;
+    uint32_t cq_tail;
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    /* from the start of the ring */
+    uint32_t sq_offset;
+    uint32_t cq_offset;
+}
+__attribute__( ( packed ) );
+
 void print( const char *filename );
 int os_getkey();
 int os_putchar( int chr );
@@ -26,6 +188,26 @@ void os_free( void *ptr );
 int os_system( struct command_argument *arguments );
 void os_process_get_arguments( struct process_arguments *arguments );
 void os_exit();
+void os_swap_stats( struct swap_stats *stats );
+void os_zram_stats( struct zram_stats *stats );
+void os_ksm_control( int pages_per_tick );
+void os_ksm_stats( struct ksm_stats *stats );
+int os_shm_open( const char *name,
+                 size_t size );
+void *os_shm_attach( int handle );
+int os_shm_detach( void *ptr );
+void os_disk_cache_stats( struct disk_cache_stats *stats );
+int os_disk_flush( int drive );
+int os_disk_queue_stats( int drive,
+                         struct disk_queue_stats *stats );
+int os_disk_set_scheduler( int drive,
+                           int scheduler );
+int os_disk_trace_control( int enable );
+int os_disk_trace_read( struct disk_trace_entry *entries,
+                        int max );
+struct aio_ring *os_aio_setup( int entries );
+int os_aio_enter( int to_submit,
+                  int min_complete );
 
 int os_getkey_block();
 void os_terminal_readline( char *out,
@@ -0,0 +1,475 @@
+#include "aio.h"
+#include "status.h"
+#include "fs/file.h"
+#include "task/task.h"
+#include "task/process.h"
+#include "memory/memory.h"
+#include "memory/heap/kheap.h"
+#include "memory/shm/shm.h"
+
+static struct aio_context *aio_contexts[ OS_MAX_PROCESSES ];
+
+/* the ring the next timer tick starts with, so one busy ring cannot take every tick budget */
+static int aio_tick_next;
+
+static uint32_t aio_round_up_power_of_two( uint32_t value )
+{
+    uint32_t power = 1;
+
+    while( power < value )
+    {
+        power <<= 1;
+    }
+
+    return power;
+}
+
+static void aio_free_context( struct aio_context *context )
+{
+    if( context->ring )
+    {
+        shm_release( context->segment );
+    }
+
+    kfree( context->pending );
+    kfree( context );
+}
+
+/* map a submission and a completion ring into the process, returns their user address */
+void *aio_setup( struct process *process,
+                 uint32_t entries )
+{
+    if( aio_contexts[ process->id ] || ( entries == 0 ) || ( entries > OS_AIO_MAX_ENTRIES ) )
+    {
+        return 0;
+    }
+
+    entries = aio_round_up_power_of_two( entries );
+
+    uint32_t sq_offset = sizeof( struct aio_ring );
+    uint32_t cq_offset = sq_offset + ( sizeof( struct aio_sqe ) * entries );
+    uint32_t size      = cq_offset + ( sizeof( struct aio_cqe ) * entries * 2 );
+
+    struct aio_context *context = kzalloc( sizeof( struct aio_context ) );
+
+    if( !context )
+    {
+        return 0;
+    }
+
+    context->process = process;
+    context->pending = kzalloc( sizeof( struct aio_sqe ) * entries );
+
+    if( !context->pending )
+    {
+        aio_free_context( context );
+        return 0;
+    }
+
+    /* an unnamed segment, nobody else can find it; if the attach fails it is freed on exit */
+    context->segment = shm_open( process, "", size );
+    context->user_ring = ( context->segment >= 0 ) ? shm_attach( process, context->segment ) : 0;
+
+    if( !context->user_ring )
+    {
+        aio_free_context( context );
+        return 0;
+    }
+
+    /* a detach by the process must not free the ring under the kernel */
+    if( shm_reference( context->segment ) < 0 )
+    {
+        aio_free_context( context );
+        return 0;
+    }
+
+    context->ring       = shm_get_memory( context->segment );
+    context->sqes       = ( void * ) context->ring + sq_offset;
+    context->cqes       = ( void * ) context->ring + cq_offset;
+    context->sq_entries = entries;
+    context->cq_entries = entries * 2;
+
+    context->ring->sq_entries = entries;
+    context->ring->cq_entries = entries * 2;
+    context->ring->sq_offset  = sq_offset;
+    context->ring->cq_offset  = cq_offset;
+
+    aio_contexts[ process->id ] = context;
+
+    return context->user_ring;
+}
+
+static int aio_find_file( struct aio_context *context,
+                          int fd )
+{
+    for( int idx = 0; idx < OS_AIO_MAX_FILES; idx++ )
+    {
+        if( context->files[ idx ] == fd )
+        {
+            return idx;
+        }
+    }
+
+    return -INVALID_ARGUMENT_ERROR;
+}
+
+static int aio_open( struct aio_context *context,
+                     struct aio_sqe *sqe )
+{
+    char path[ OS_MAX_PATH ];
+    int slot = aio_find_file( context, 0 );
+
+    if( slot < 0 )
+    {
+        return -NO_MEMORY_ERROR;
+    }
+
+    int res = copy_string_from_task( context->process->task, sqe->buffer, path, sizeof( path ) );
+
+    if( res < 0 )
+    {
+        return res;
+    }
+
+    const char *modes[] = { "r", "w", "a" };
+
+    if( sqe->length > AIO_OPEN_APPEND )
+    {
+        return -INVALID_ARGUMENT_ERROR;
+    }
+
+    int fd = fopen( path, modes[ sqe->length ] );
+
+    if( fd <= 0 )
+    {
+        return -IO_ERROR;
+    }
+
+    context->files[ slot ] = fd;
+
+    return fd;
+}
+
+/*
+ * file data to or from the process a page at a time, its pages are not physically contiguous,
+ * stops when the budget runs out and picks up from pending_done when called again
+ */
+static int aio_transfer( struct aio_context *context,
+                         struct aio_sqe *sqe,
+                         uint32_t length,
+                         bool write,
+                         uint32_t *budget )
+{
+    uint32_t done = context->pending_done;
+    void *virtual = sqe->buffer + done;
+
+    while( ( done < length ) && ( *budget > 0 ) )
+    {
+        uint32_t chunk = PAGING_PAGE_SIZE - ( ( uint32_t ) virtual % PAGING_PAGE_SIZE );
+
+        if( chunk > length - done )
+        {
+            chunk = length - done;
+        }
+
+        if( chunk > *budget )
+        {
+            chunk = *budget;
+        }
+
+        /* reading the file writes the memory of the process */
+        void *buffer = task_user_address_to_physical( context->process->task, virtual, !write );
+
+        if( !buffer )
+        {
+            return -INVALID_ARGUMENT_ERROR;
+        }
+
+        int res = write ? fwrite( buffer, 1, chunk, sqe->fd ) : fread( buffer, 1, chunk, sqe->fd );
+
+        if( res < 0 )
+        {
+            return res;
+        }
+
+        virtual += chunk;
+        done    += chunk;
+        *budget -= chunk;
+    }
+
+    if( done < length )
+    {
+        context->pending_done    = done;
+        context->pending_partial = true;
+        return 0;
+    }
+
+    return done;
+}
+
+/* positioned read, stops at the end of the file */
+static int aio_read( struct aio_context *context,
+                     struct aio_sqe *sqe,
+                     uint32_t *budget )
+{
+    struct file_stat stat;
+
+    if( ( sqe->fd <= 0 ) || ( aio_find_file( context, sqe->fd ) < 0 ) )
+    {
+        return -INVALID_ARGUMENT_ERROR;
+    }
+
+    int res = fstat( sqe->fd, &stat );
+
+    if( res < 0 )
+    {
+        return res;
+    }
+
+    if( sqe->offset >= stat.filesize )
+    {
+        return context->pending_done;
+    }
+
+    uint32_t length = sqe->length;
+
+    if( length > stat.filesize - sqe->offset )
+    {
+        length = stat.filesize - sqe->offset;
+    }
+
+    /* the file may have shrunk since an earlier tick moved part of the request */
+    if( length <= context->pending_done )
+    {
+        return context->pending_done;
+    }
+
+    res = fseek( sqe->fd, sqe->offset + context->pending_done, SEEK_SET );
+
+    if( res < 0 )
+    {
+        return res;
+    }
+
+    return aio_transfer( context, sqe, length, false, budget );
+}
+
+/* positioned write up to the end of the file, files opened to append always write at the end */
+static int aio_write( struct aio_context *context,
+                      struct aio_sqe *sqe,
+                      uint32_t *budget )
+{
+    int slot = ( sqe->fd > 0 ) ? aio_find_file( context, sqe->fd ) : -INVALID_ARGUMENT_ERROR;
+
+    if( slot < 0 )
+    {
+        return slot;
+    }
+
+    if( sqe->length == 0 )
+    {
+        return 0;
+    }
+
+    int res = fseek( sqe->fd, sqe->offset + context->pending_done, SEEK_SET );
+
+    if( res < 0 )
+    {
+        return res;
+    }
+
+    return aio_transfer( context, sqe, sqe->length, true, budget );
+}
+
+static int aio_close( struct aio_context *context,
+                      struct aio_sqe *sqe )
+{
+    int slot = ( sqe->fd > 0 ) ? aio_find_file( context, sqe->fd ) : -INVALID_ARGUMENT_ERROR;
+
+    if( slot < 0 )
+    {
+        return slot;
+    }
+
+    context->files[ slot ] = 0;
+
+    return fclose( sqe->fd );
+}
+
+static int aio_execute( struct aio_context *context,
+                        struct aio_sqe *sqe,
+                        uint32_t *budget )
+{
+    switch( sqe->opcode )
+    {
+        case AIO_OP_NOP:
+            return OS_OK;
+
+        case AIO_OP_OPEN:
+            return aio_open( context, sqe );
+
+        case AIO_OP_READ:
+            return aio_read( context, sqe, budget );
+
+        case AIO_OP_WRITE:
+            return aio_write( context, sqe, budget );
+
+        case AIO_OP_CLOSE:
+            return aio_close( context, sqe );
+    }
+
+    return -INVALID_ARGUMENT_ERROR;
+}
+
+static bool aio_completion_queue_full( struct aio_context *context )
+{
+    return ( context->cq_tail - context->ring->cq_head ) >= context->cq_entries;
+}
+
+/*
+ * carry out up to max pending requests within budget bytes, stops early when the process
+ * does not reap completions, a transfer the budget cuts short stays at the head of the queue
+ */
+static int aio_run( struct aio_context *context,
+                    int max,
+                    uint32_t *budget )
+{
+    int total = 0;
+
+    while( ( total < max ) && ( *budget > 0 ) && ( context->pending_total > 0 ) && !aio_completion_queue_full( context ) )
+    {
+        struct aio_sqe *sqe = &context->pending[ context->pending_head ];
+        struct aio_cqe *cqe = &context->cqes[ context->cq_tail & ( context->cq_entries - 1 ) ];
+
+        context->pending_partial = false;
+        int result = aio_execute( context, sqe, budget );
+
+        /* opening a file or looking up its size reads the disk as well, so every request costs at least a sector */
+        *budget -= ( *budget < OS_SECTOR_SIZE ) ? *budget : OS_SECTOR_SIZE;
+
+        if( context->pending_partial )
+        {
+            break;
+        }
+
+        context->pending_done = 0;
+
+        cqe->result    = result;
+        cqe->user_data = sqe->user_data;
+        context->cq_tail++;
+        context->ring->cq_tail = context->cq_tail;
+
+        context->pending_head = ( context->pending_head + 1 ) % context->sq_entries;
+        context->pending_total--;
+        total++;
+    }
+
+    return total;
+}
+
+/* move submissions out of the shared ring, returns how many were taken */
+static int aio_consume( struct aio_context *context,
+                        uint32_t to_submit )
+{
+    struct aio_ring *ring = context->ring;
+    uint32_t sq_tail = ring->sq_tail;
+    uint32_t total   = 0;
+
+    /* a tail more than a ring ahead of the head was not produced by following the protocol */
+    if( sq_tail - context->sq_head > context->sq_entries )
+    {
+        return -INVALID_ARGUMENT_ERROR;
+    }
+
+    while( ( total < to_submit ) && ( context->sq_head != sq_tail ) && ( context->pending_total < context->sq_entries ) )
+    {
+        uint32_t slot = ( context->pending_head + context->pending_total ) % context->sq_entries;
+
+        memcpy( &context->pending[ slot ], &context->sqes[ context->sq_head & ( context->sq_entries - 1 ) ], sizeof( struct aio_sqe ) );
+        context->pending_total++;
+        context->sq_head++;
+        total++;
+    }
+
+    ring->sq_head = context->sq_head;
+
+    return total;
+}
+
+/*
+ * take a batch of submissions in one trap and complete requests until min_complete
+ * completions wait in the ring, the rest is carried out in the background
+ */
+int aio_enter( struct process *process,
+               uint32_t to_submit,
+               uint32_t min_complete )
+{
+    struct aio_context *context = aio_contexts[ process->id ];
+
+    if( !context )
+    {
+        return -INVALID_ARGUMENT_ERROR;
+    }
+
+    int submitted = aio_consume( context, to_submit );
+
+    if( submitted < 0 )
+    {
+        return submitted;
+    }
+
+    /* the submitter waits for these, they are not limited like the background work */
+    uint32_t budget = 0xFFFFFFFF;
+
+    while( ( context->cq_tail - context->ring->cq_head ) < min_complete )
+    {
+        if( aio_run( context, 1, &budget ) == 0 )
+        {
+            break;
+        }
+    }
+
+    return submitted;
+}
+
+/*
+ * background progress from the timer interrupt, the disk waits in here keep every other
+ * interrupt out, so each tick moves at most OS_AIO_BYTES_PER_TICK across all rings
+ */
+void aio_tick()
+{
+    uint32_t budget = OS_AIO_BYTES_PER_TICK;
+
+    for( int count = 0; ( count < OS_MAX_PROCESSES ) && ( budget > 0 ); count++ )
+    {
+        int idx = aio_tick_next;
+        aio_tick_next = ( aio_tick_next + 1 ) % OS_MAX_PROCESSES;
+
+        if( aio_contexts[ idx ] )
+        {
+            aio_run( aio_contexts[ idx ], aio_contexts[ idx ]->pending_total, &budget );
+        }
+    }
+}
+
+/* close what the ring opened and drop the kernel reference, the attachment goes with the other shared memory of the process */
+void aio_process_terminate( struct process *process )
+{
+    struct aio_context *context = aio_contexts[ process->id ];
+
+    if( !context )
+    {
+        return;
+    }
+
+    for( int idx = 0; idx < OS_AIO_MAX_FILES; idx++ )
+    {
+        if( context->files[ idx ] )
+        {
+            fclose( context->files[ idx ] );
+        }
+    }
+
+    aio_contexts[ process->id ] = 0;
+    aio_free_context( context );
+}
@@ -0,0 +1,102 @@
+#ifndef AIO_H_
+#define AIO_H_
+
+#include "config.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#define AIO_OP_NOP      0
+/* open the path in buffer with one of the AIO_OPEN modes in length, the result is the file descriptor */
+#define AIO_OP_OPEN     1
+/* read length bytes at offset into buffer, the result is the number of bytes read */
+#define AIO_OP_READ     2
+/* write length bytes from buffer at offset, or at the end of a file opened to append */
+#define AIO_OP_WRITE    3
+#define AIO_OP_CLOSE    4
+
+#define AIO_OPEN_READ   0
+/* creates the file, an existing one is truncated */
+#define AIO_OPEN_WRITE  1
+#define AIO_OPEN_APPEND 2
+
+/* submission queue entry, written by the process */
+struct aio_sqe
+{
+    uint32_t opcode;
+    int32_t fd;
+    uint32_t offset;
+    uint32_t length;
+    void *buffer;
+    /* handed back untouched in the completion */
+    uint32_t user_data;
+}
+__attribute__( ( packed ) );
+
+/* completion queue entry, written by the kernel */
+struct aio_cqe
+{
+    uint32_t user_data;
+    int32_t result;
+}
+__attribute__( ( packed ) );
+
+/*
+ * start of the memory shared with the process, the process produces at sq_tail and
+ * consumes at cq_head, the kernel does the opposite, the indexes only ever grow
+ */
+struct aio_ring
+{
+    uint32_t sq_head;
+    uint32_t sq_tail;
+    uint32_t cq_head;
+    uint32_t cq_tail;
+    /* powers of two, the completion queue is twice the submission queue */
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    /* from the start of the ring */
+    uint32_t sq_offset;
+    uint32_t cq_offset;
+}
+__attribute__( ( packed ) );
+
+struct process;
+
+struct aio_context
+{
+    struct process *process;
+
+    /* the ring lives in a shared memory segment attached to the process, the kernel holds a reference of its own */
+    int segment;
+    struct aio_ring *ring;
+    void *user_ring;
+    struct aio_sqe *sqes;
+    struct aio_cqe *cqes;
+
+    /* the process can write the ring, sizes and the indexes the kernel owns are only trusted from here */
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    uint32_t sq_head;
+    uint32_t cq_tail;
+
+    /* consumed from the ring but not completed yet, copied so the process may reuse the slots */
+    struct aio_sqe *pending;
+    uint32_t pending_head;
+    uint32_t pending_total;
+
+    /* bytes of the request at pending_head moved so far when the tick budget split it */
+    uint32_t pending_done;
+    bool pending_partial;
+
+    /* descriptors opened through the ring, only these may be used by it */
+    int files[ OS_AIO_MAX_FILES ];
+};
+
+void *aio_setup( struct process *process,
+                 uint32_t entries );
+int aio_enter( struct process *process,
+               uint32_t to_submit,
+               uint32_t min_complete );
+void aio_tick();
+void aio_process_terminate( struct process *process );
+
+#endif /* AIO_H_ */
@@ -4,6 +4,13 @@ BITS 16
 CODE_SEL equ gdt_code - gdt_start
 DATA_SEL equ gdt_data - gdt_start
 
+E820_MAP_ADDRESS    equ 0x0500      ; must match OS_E820_MAP_ADDRESS in config.h
+E820_MAX_ENTRIES    equ 32          ; must match OS_E820_MAX_ENTRIES in config.h
+E820_ENTRY_SIZE     equ 24
+E820_SIGNATURE      equ 0x534D4150  ; 'SMAP'
+
+KERNEL_SECTORS      equ 255         ; must stay below ReserverdSectors
+
 jmp short start
 nop
 
@@ -11,7 +18,7 @@ nop
 OEMIdentifier       db 'KEYUR_OS'
 BytesPerSector      dw 0x200
 SectorsPerCluster   db 0x80
-ReserverdSectors    dw 200
+ReserverdSectors    dw 256
 FATCopies           db 0x02
 RootDirEntries      dw 0x40
 NumSectors          dw 0x00
@@ -41,6 +48,7 @@ main:
     mov ss, ax
     mov sp, 0x7c00
     sti             ; setting the interrupts
+    call detect_memory
 .load_protected:
     cli
     lgdt[gdt_descriptor]
@@ -49,6 +57,37 @@ main:
     mov cr0, eax
     jmp CODE_SEL:load32
 
+; collect the BIOS E820 memory map at E820_MAP_ADDRESS
+; layout: dword entry count followed by 24 byte entries (base, length, type, acpi attributes)
+detect_memory:
+    mov di, E820_MAP_ADDRESS + 4    ; entries start after the entry count
+    xor ebx, ebx                    ; continuation value must be zero for the first call
+    xor bp, bp                      ; number of entries stored so far
+.next_entry:
+    mov eax, 0xE820
+    mov ecx, E820_ENTRY_SIZE
+    mov edx, E820_SIGNATURE
+    mov dword [es:di+20], 1         ; valid acpi attributes if the BIOS only returns 20 bytes
+    int 0x15
+    jc .done                        ; carry set means unsupported or past the last entry
+    cmp eax, E820_SIGNATURE
+    jne .done
+    jcxz .skip_entry                ; nothing was returned
+    mov ecx, [es:di+8]
+    or ecx, [es:di+12]
+    jz .skip_entry                  ; ignore zero length entries
+    inc bp
+    add di, E820_ENTRY_SIZE
+.skip_entry:
+    test ebx, ebx                   ; zero means that was the last entry
+    jz .done
+    cmp bp, E820_MAX_ENTRIES
+    jb .next_entry
+.done:
+    mov word [E820_MAP_ADDRESS], bp
+    mov word [E820_MAP_ADDRESS+2], 0
+    ret
+
 ; Global Descriptor Table (GDT)
 gdt_start:
 
@@ -82,10 +121,11 @@ gdt_descriptor:
 
 BITS 32
 load32:
-    mov eax, 0x01       ; starting sector number to load
-    mov ecx, 100        ; total number of sector to load
-    mov edi, 0x0100000  ; address we want to load them into
+    mov eax, 0x01           ; starting sector number to load
+    mov ecx, KERNEL_SECTORS ; total number of sector to load
+    mov edi, 0x0100000      ; address we want to load them into
     call ata_lba_read
+    mov esi, E820_MAP_ADDRESS   ; hand the memory map over to the kernel
     jmp CODE_SEL:0x0100000
 
 ata_lba_read:
@@ -4,16 +4,42 @@
 #define KERNEL_CODE_SELECTOR                      0x08
 #define KERNEL_DATA_SELECTOR                      0x10
 #define OS_TOTAL_INTERRUPTS                       512
-#define OS_HEAP_SIZE_BYTES                        104857600 /* 100MB heap size (1024 * 1024 * 100) */
+#define OS_HEAP_SIZE_BYTES                        104857600 /* 100MB heap size, used only when the BIOS gives no memory map */
 #define OS_HEAP_BLOCK_SIZE                        4096
 #define OS_HEAP_ADDRESS                           0x01000000
-#define OS_HEAP_TABLE_ADDRESS                     0x00007E00
+#define OS_HEAP_MAX_RECLAIMERS                    4 /* asked in registration order when the heap runs out */
+
+#define OS_E820_MAP_ADDRESS                       0x00000500 /* filled by the boot loader */
+#define OS_E820_MAX_ENTRIES                       32
 
 #define OS_SECTOR_SIZE                            512
 #define OS_MAX_PATH                               108
 #define OS_MAX_FILESYSTEMS                        12
 #define OS_MAX_FILEDISCRIPTORS                    512
 
+#define OS_MAX_DISKS                              10 /* drive numbers in paths are one digit */
+#define OS_RAMDISK_SIZE_BYTES                     4194304 /* 4MB drive 1:/ */
+#define OS_RAMDISK_IMAGE                          "0:/ramdisk.img" /* copied in at boot when present */
+#define OS_DISK_CACHE_SIZE_BYTES                  1048576 /* 1MB of cached sectors */
+#define OS_DISK_CACHE_BUCKETS                     1024
+#define OS_DISK_CACHE_MAX_SECTORS                 32 /* larger reads bypass the cache */
+#define OS_DISK_CACHE_MAX_DIRTY                   256 /* dirty sectors before a forced write back */
+#define OS_DISK_CACHE_WRITEBACK_TICKS             55  /* about three seconds of timer ticks */
+#define OS_DISK_CACHE_WRITEBACK_RETRIES           3   /* write back attempts before a dirty sector is passed over */
+#define OS_DISK_QUEUE_MAX_DEPTH                   64  /* queued commands before the queue runs by itself */
+#define OS_DISK_QUEUE_MAX_MERGE_SECTORS           128
+#define OS_DISK_DEFAULT_SCHEDULER                 DISK_SCHEDULER_DEADLINE
+#define OS_DISK_DEADLINE_READ_EXPIRE              8   /* dispatches a request may be passed over */
+#define OS_DISK_DEADLINE_WRITE_EXPIRE             32
+#define OS_DISK_TRACE_ENTRIES                     1024
+#define OS_DISK_MAX_SECTORS_PER_BLOCK             16 /* READ MULTIPLE block size limit */
+#define OS_DISK_MAX_SECTORS_PER_TRANSFER          256 /* the ATA sector count register takes at most 256 */
+#define OS_DISK_VECTOR_BATCH                      16 /* runs of a vectored read queued at once */
+#define OS_DISK_DMA_MAX_PRDS                      16
+#define OS_DISK_DMA_MIN_SECTORS                   8  /* shorter transfers stay on PIO */
+#define OS_AHCI_MAX_SECTORS_PER_COMMAND           128
+#define OS_VIRTIO_BLK_MAX_SECTORS_PER_REQUEST     128
+
 #define OS_TOTAL_GDT_SEGMENTS                     6
 
 #define OS_PROGRAM_VIRTUAL_ADDRESS                0x400000
@@ -22,6 +48,10 @@
 #define OS_PROGRAM_VIRTUAL_STACK_ADDRESS_END      OS_PROGRAM_VIRTUAL_STACK_ADDRESS_START - OS_USER_PROGRAM_STACK_SIZE
 #define USER_DATA_SEGMENT                         0x23
 #define USER_CODE_SEGMENT                         0x1B
+#define OS_PROGRAM_VIRTUAL_HEAP_ADDRESS           0xC0000000 /* above any RAM the kernel heap can reach */
+#define OS_PROGRAM_VIRTUAL_HEAP_SIZE              0x20000000 /* 512MB of address space for process_malloc */
+#define OS_PROGRAM_VIRTUAL_SHM_ADDRESS            0xE0000000 /* shared memory segments are attached here */
+#define OS_PROGRAM_VIRTUAL_SHM_SIZE               0x10000000
 #define OS_MAX_PROGRAMS_ALLOCATIONS               1024
 #define OS_MAX_PROCESSES                          12
 
@@ -29,4 +59,27 @@
 
 #define OS_KEYBOARD_BUFFER_SIZE                   1024
 
+#define OS_SWAP_FILE                              "0:/swap.sys"
+#define OS_SWAP_CLUSTER_PAGES                     8 /* pages brought back per fault when they sit together on disk */
+
+#define OS_ZRAM_MAX_POOL_PAGES                    4096 /* 16MB of heap for compressed pages */
+#define OS_ZRAM_MAX_OBJECTS                       16384
+
+#define OS_KSM_MAX_FRAMES                         1024
+#define OS_KSM_HASH_BUCKETS                       256
+#define OS_KSM_UNSTABLE_SLOTS                     1024
+#define OS_KSM_MAX_PAGES_PER_TICK                 64
+
+#define OS_MAX_SHM_SEGMENTS                       32
+#define OS_MAX_SHM_ATTACHMENTS                    16 /* per process */
+#define OS_SHM_NAME_SIZE                          32
+#define OS_SHM_MAX_SIZE                           0x01000000 /* 16MB */
+
+#define OS_PAGE_CACHE_MAX_PAGES                   1024 /* 4MB of cached file data */
+#define OS_PAGE_CACHE_BUCKETS                     256
+
+#define OS_AIO_MAX_ENTRIES                        256 /* submission queue entries per ring */
+#define OS_AIO_MAX_FILES                          16 /* descriptors opened through a ring */
+#define OS_AIO_BYTES_PER_TICK                     16384 /* background transfers from the timer tick, across all rings */
+
 #endif /* CONFIG_H_ */
@@ -0,0 +1,420 @@
+#include "ahci.h"
+#include "config.h"
+#include "status.h"
+#include "memory/memory.h"
+#include "memory/heap/kheap.h"
+
+static struct ahci ahci;
+
+static void ahci_port_stop( struct ahci_port *port )
+{
+    port->registers->command &= ~( AHCI_PORT_CMD_START | AHCI_PORT_CMD_FIS_RECEIVE );
+
+    while( port->registers->command & ( AHCI_PORT_CMD_LIST_RUNNING | AHCI_PORT_CMD_FIS_RUNNING ) )
+    {
+    }
+}
+
+static void ahci_port_start( struct ahci_port *port )
+{
+    while( port->registers->command & AHCI_PORT_CMD_LIST_RUNNING )
+    {
+    }
+
+    port->registers->command |= AHCI_PORT_CMD_FIS_RECEIVE;
+    port->registers->command |= AHCI_PORT_CMD_START;
+}
+
+/* a failed command stops the port, clear the errors and start it over */
+static void ahci_port_recover( struct ahci_port *port )
+{
+    ahci_port_stop( port );
+    port->registers->sata_error       = 0xFFFFFFFF;
+    port->registers->interrupt_status = 0xFFFFFFFF;
+    ahci_port_start( port );
+}
+
+/* fill the command slot, the caller issues it */
+static void ahci_port_build_command( struct ahci_port *port,
+                                     int slot,
+                                     uint8_t command,
+                                     uint64_t lba,
+                                     int total_sectors,
+                                     void *buffer,
+                                     uint32_t total_bytes,
+                                     bool write )
+{
+    struct ahci_command_header *header = &port->command_list[ slot ];
+    struct ahci_command_table *table   = &port->command_tables[ slot ];
+    struct ahci_fis_h2d *fis           = ( struct ahci_fis_h2d * ) table->command_fis;
+
+    header->flags            = ( sizeof( struct ahci_fis_h2d ) / sizeof( uint32_t ) ) | ( write ? AHCI_HEADER_WRITE : 0x00 );
+    header->flags_extended   = 0x00;
+    header->prd_table_length = buffer ? 1 : 0;
+    header->prd_byte_count   = 0;
+
+    bzero( table, sizeof( struct ahci_command_table ) );
+
+    if( buffer )
+    {
+        table->prd.address    = ( uint32_t ) buffer;
+        table->prd.byte_count = total_bytes - 1;
+    }
+
+    fis->type    = AHCI_FIS_TYPE_REGISTER_H2D;
+    fis->flags   = AHCI_FIS_COMMAND;
+    fis->command = command;
+    fis->device  = AHCI_FIS_DEVICE_LBA;
+    fis->lba0    = lba & 0xFF;
+    fis->lba1    = ( lba >> 8 ) & 0xFF;
+    fis->lba2    = ( lba >> 16 ) & 0xFF;
+    fis->lba3    = ( lba >> 24 ) & 0xFF;
+    fis->lba4    = ( lba >> 32 ) & 0xFF;
+    fis->lba5    = ( lba >> 40 ) & 0xFF;
+
+    if( ( command == AHCI_COMMAND_READ_FPDMA_QUEUED ) || ( command == AHCI_COMMAND_WRITE_FPDMA_QUEUED ) )
+    {
+        /* queued commands carry the count in the feature field and the tag in the count field */
+        fis->feature_low  = total_sectors & 0xFF;
+        fis->feature_high = ( total_sectors >> 8 ) & 0xFF;
+        fis->count_low    = slot << 3;
+    }
+    else
+    {
+        fis->count_low  = total_sectors & 0xFF;
+        fis->count_high = ( total_sectors >> 8 ) & 0xFF;
+    }
+}
+
+static void ahci_port_issue( struct ahci_port *port,
+                             uint32_t slots )
+{
+    /* queued commands are marked active before they are issued */
+    if( port->ncq )
+    {
+        port->registers->sata_active = slots;
+    }
+
+    port->registers->command_issue = slots;
+}
+
+/* the commands complete when the HBA clears their bits in both registers */
+static int ahci_port_wait( struct ahci_port *port,
+                           uint32_t slots )
+{
+    while( ( port->registers->command_issue | port->registers->sata_active ) & slots )
+    {
+        if( port->registers->interrupt_status & AHCI_PORT_IS_TASK_FILE_ERROR )
+        {
+            ahci_port_recover( port );
+            return -IO_ERROR;
+        }
+    }
+
+    /* PxIS is write-one-to-clear, so test the value that was read before clearing it */
+    uint32_t interrupt_status = port->registers->interrupt_status;
+    port->registers->interrupt_status = interrupt_status;
+
+    if( interrupt_status & AHCI_PORT_IS_TASK_FILE_ERROR )
+    {
+        ahci_port_recover( port );
+        return -IO_ERROR;
+    }
+
+    return OS_OK;
+}
+
+static void ahci_port_wait_idle( struct ahci_port *port )
+{
+    while( port->registers->task_file_data & ( AHCI_PORT_TFD_BSY | AHCI_PORT_TFD_DRQ ) )
+    {
+    }
+}
+
+static uint8_t ahci_port_command( struct ahci_port *port,
+                                  bool write )
+{
+    if( port->ncq )
+    {
+        return write ? AHCI_COMMAND_WRITE_FPDMA_QUEUED : AHCI_COMMAND_READ_FPDMA_QUEUED;
+    }
+
+    return write ? AHCI_COMMAND_WRITE_DMA_EXT : AHCI_COMMAND_READ_DMA_EXT;
+}
+
+/* odd buffers cannot be described by a region, they go through the bounce buffer one command at a time */
+static int ahci_transfer_bounce( struct ahci_port *port,
+                                 unsigned int lba,
+                                 int total_sectors,
+                                 void *buffer,
+                                 bool write )
+{
+    int res = OS_OK;
+
+    while( total_sectors > 0 )
+    {
+        int sectors = ( total_sectors > OS_AHCI_MAX_SECTORS_PER_COMMAND ) ? OS_AHCI_MAX_SECTORS_PER_COMMAND : total_sectors;
+        uint32_t bytes = sectors * OS_SECTOR_SIZE;
+
+        if( write )
+        {
+            memcpy( port->bounce, buffer, bytes );
+        }
+
+        ahci_port_wait_idle( port );
+        ahci_port_build_command( port, 0, ahci_port_command( port, write ), lba, sectors, port->bounce, bytes, write );
+        ahci_port_issue( port, 0x01 );
+
+        res = ahci_port_wait( port, 0x01 );
+
+        if( res < 0 )
+        {
+            return res;
+        }
+
+        if( !write )
+        {
+            memcpy( buffer, port->bounce, bytes );
+        }
+
+        lba           += sectors;
+        buffer        += bytes;
+        total_sectors -= sectors;
+    }
+
+    return res;
+}
+
+/*
+ * split the transfer into commands and keep up to queue depth of them in flight,
+ * the drive is free to complete the queued ones in whatever order suits it
+ */
+static int ahci_transfer( struct ahci_port *port,
+                          unsigned int lba,
+                          int total_sectors,
+                          void *buffer,
+                          bool write )
+{
+    int res = OS_OK;
+
+    if( ( uint32_t ) buffer & 0x01 )
+    {
+        return ahci_transfer_bounce( port, lba, total_sectors, buffer, write );
+    }
+
+    while( total_sectors > 0 )
+    {
+        uint32_t slots = 0;
+
+        ahci_port_wait_idle( port );
+
+        for( int slot = 0; ( slot < port->queue_depth ) && ( total_sectors > 0 ); slot++ )
+        {
+            int sectors = ( total_sectors > OS_AHCI_MAX_SECTORS_PER_COMMAND ) ? OS_AHCI_MAX_SECTORS_PER_COMMAND : total_sectors;
+            uint32_t bytes = sectors * OS_SECTOR_SIZE;
+
+            ahci_port_build_command( port, slot, ahci_port_command( port, write ), lba, sectors, buffer, bytes, write );
+            slots |= ( 1U << slot );
+
+            lba           += sectors;
+            buffer        += bytes;
+            total_sectors -= sectors;
+        }
+
+        ahci_port_issue( port, slots );
+        res = ahci_port_wait( port, slots );
+
+        if( res < 0 )
+        {
+            return res;
+        }
+    }
+
+    return res;
+}
+
+static int ahci_read( struct disk *disk,
+                      unsigned int lba,
+                      int total_sectors,
+                      void *buffer )
+{
+    return ahci_transfer( disk->driver_private, lba, total_sectors, buffer, false );
+}
+
+static int ahci_write( struct disk *disk,
+                       unsigned int lba,
+                       int total_sectors,
+                       void *buffer )
+{
+    return ahci_transfer( disk->driver_private, lba, total_sectors, buffer, true );
+}
+
+/* a non queued command without data, only issued while nothing else is in flight */
+static int ahci_flush( struct disk *disk )
+{
+    struct ahci_port *port = disk->driver_private;
+
+    ahci_port_wait_idle( port );
+    ahci_port_build_command( port, 0, AHCI_COMMAND_FLUSH_CACHE_EXT, 0, 0, 0, 0, false );
+    port->registers->command_issue = 0x01;
+
+    return ahci_port_wait( port, 0x01 );
+}
+
+/* decide between queued and plain DMA commands from what the drive reports */
+static int ahci_port_identify( struct ahci_port *port )
+{
+    int res = OS_OK;
+    uint16_t *identify = port->bounce;
+
+    ahci_port_wait_idle( port );
+    ahci_port_build_command( port, 0, ATA_COMMAND_IDENTIFY, 0, 0, identify, OS_SECTOR_SIZE, false );
+    port->registers->command_issue = 0x01;
+
+    res = ahci_port_wait( port, 0x01 );
+
+    if( res < 0 )
+    {
+        return res;
+    }
+
+    port->ncq         = false;
+    port->queue_depth = 1;
+
+    if( ( ahci.hba->capabilities & AHCI_CAP_NCQ ) && ( identify[ AHCI_IDENTIFY_SATA_CAPABILITIES ] & AHCI_SATA_CAPABILITY_NCQ ) )
+    {
+        port->ncq         = true;
+        port->queue_depth = ( identify[ AHCI_IDENTIFY_QUEUE_DEPTH ] & 0x1F ) + 1;
+
+        if( port->queue_depth > ahci.command_slots )
+        {
+            port->queue_depth = ahci.command_slots;
+        }
+    }
+
+    return res;
+}
+
+static void ahci_port_free( struct ahci_port *port )
+{
+    kfree( port->command_list );
+    kfree( port->fis );
+    kfree( port->command_tables );
+    kfree( port->bounce );
+    kfree( port );
+}
+
+static int ahci_port_init( int index )
+{
+    int res = OS_OK;
+    volatile struct ahci_port_registers *registers = &ahci.hba->ports[ index ];
+
+    /* only SATA disks, no ATAPI, port multipliers or empty ports */
+    if( ( ( registers->sata_status & AHCI_PORT_SSTS_DET_MASK ) != AHCI_PORT_SSTS_DET_PRESENT ) || ( registers->signature != AHCI_PORT_SIGNATURE_ATA ) )
+    {
+        res = -IO_ERROR;
+        return res;
+    }
+
+    struct ahci_port *port = kzalloc( sizeof( struct ahci_port ) );
+
+    if( !port )
+    {
+        res = -NO_MEMORY_ERROR;
+        return res;
+    }
+
+    /* every kernel heap allocation starts on a block boundary, more than any alignment needed here */
+    port->registers      = registers;
+    port->command_list   = kzalloc( sizeof( struct ahci_command_header ) * AHCI_MAX_COMMAND_SLOTS );
+    port->fis            = kzalloc( 256 );
+    port->command_tables = kzalloc( sizeof( struct ahci_command_table ) * AHCI_MAX_COMMAND_SLOTS );
+    port->bounce         = kzalloc( OS_AHCI_MAX_SECTORS_PER_COMMAND * OS_SECTOR_SIZE );
+
+    if( !port->command_list || !port->fis || !port->command_tables || !port->bounce )
+    {
+        res = -NO_MEMORY_ERROR;
+        ahci_port_free( port );
+        return res;
+    }
+
+    for( int slot = 0; slot < AHCI_MAX_COMMAND_SLOTS; slot++ )
+    {
+        port->command_list[ slot ].command_table_base = ( uint32_t ) &port->command_tables[ slot ];
+    }
+
+    ahci_port_stop( port );
+    registers->command_list_base       = ( uint32_t ) port->command_list;
+    registers->command_list_base_upper = 0;
+    registers->fis_base                = ( uint32_t ) port->fis;
+    registers->fis_base_upper          = 0;
+    registers->sata_error              = 0xFFFFFFFF;
+    registers->interrupt_status        = 0xFFFFFFFF;
+    /* completions are polled */
+    registers->interrupt_enable        = 0;
+    ahci_port_start( port );
+
+    res = ahci_port_identify( port );
+
+    if( res < 0 )
+    {
+        ahci_port_stop( port );
+        ahci_port_free( port );
+        return res;
+    }
+
+    port->disk.type           = OS_DISK_TYPE_AHCI;
+    port->disk.sector_size    = OS_SECTOR_SIZE;
+    port->disk.read_sectors   = ahci_read;
+    port->disk.write_sectors  = ahci_write;
+    port->disk.flush_cache    = ahci_flush;
+    port->disk.driver_private = port;
+
+    res = disk_register( &port->disk );
+
+    if( res < 0 )
+    {
+        ahci_port_stop( port );
+        ahci_port_free( port );
+        return res;
+    }
+
+    ahci.ports[ index ] = port;
+
+    return OS_OK;
+}
+
+/* find the AHCI controller and register a disk for every SATA drive attached to it */
+int ahci_init()
+{
+    int res = OS_OK;
+
+    bzero( &ahci, sizeof( ahci ) );
+
+    res = pci_find_class( PCI_CLASS_MASS_STORAGE, AHCI_PCI_SUBCLASS_SATA, &ahci.controller );
+
+    if( ( res < 0 ) || ( ahci.controller.prog_if != AHCI_PCI_PROG_IF ) )
+    {
+        res = -IO_ERROR;
+        return res;
+    }
+
+    pci_enable_bus_master( &ahci.controller );
+
+    /* the kernel maps all memory one to one, the registers are reachable at their physical address */
+    ahci.hba = ( volatile struct ahci_hba_registers * ) pci_get_bar( &ahci.controller, AHCI_BAR );
+    ahci.hba->global_host_control |= AHCI_GHC_ENABLE;
+    ahci.command_slots = AHCI_CAP_COMMAND_SLOTS( ahci.hba->capabilities );
+
+    uint32_t implemented = ahci.hba->ports_implemented;
+
+    for( int index = 0; index < AHCI_MAX_PORTS; index++ )
+    {
+        if( implemented & ( 1U << index ) )
+        {
+            ahci_port_init( index );
+        }
+    }
+
+    return res;
+}
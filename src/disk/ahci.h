@@ -0,0 +1,190 @@
+#ifndef AHCI_H_
+#define AHCI_H_
+
+#include "disk.h"
+#include "pci/pci.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#define AHCI_PCI_SUBCLASS_SATA          0x06
+#define AHCI_PCI_PROG_IF                0x01
+/* ABAR, the memory mapped HBA registers */
+#define AHCI_BAR                        5
+#define AHCI_MAX_PORTS                  32
+#define AHCI_MAX_COMMAND_SLOTS          32
+
+/* host capabilities and global host control */
+#define AHCI_CAP_COMMAND_SLOTS(cap)     ( ( ( ( cap ) >> 8 ) & 0x1F ) + 1 )
+#define AHCI_CAP_NCQ                    0x40000000
+#define AHCI_GHC_ENABLE                 0x80000000
+
+/* port registers */
+#define AHCI_PORT_CMD_START             0x00000001
+#define AHCI_PORT_CMD_FIS_RECEIVE       0x00000010
+#define AHCI_PORT_CMD_FIS_RUNNING       0x00004000
+#define AHCI_PORT_CMD_LIST_RUNNING      0x00008000
+#define AHCI_PORT_IS_TASK_FILE_ERROR    0x40000000
+#define AHCI_PORT_TFD_BSY               0x80
+#define AHCI_PORT_TFD_DRQ               0x08
+#define AHCI_PORT_SSTS_DET_MASK         0x0F
+#define AHCI_PORT_SSTS_DET_PRESENT      0x03
+#define AHCI_PORT_SIGNATURE_ATA         0x00000101
+
+#define AHCI_FIS_TYPE_REGISTER_H2D      0x27
+/* the register FIS carries a command, not a control update */
+#define AHCI_FIS_COMMAND                0x80
+#define AHCI_FIS_DEVICE_LBA             0x40
+
+/* command header flags, the low five bits hold the FIS length in dwords */
+#define AHCI_HEADER_WRITE               0x40
+
+#define AHCI_COMMAND_READ_DMA_EXT       0x25
+#define AHCI_COMMAND_WRITE_DMA_EXT      0x35
+#define AHCI_COMMAND_READ_FPDMA_QUEUED  0x60
+#define AHCI_COMMAND_WRITE_FPDMA_QUEUED 0x61
+#define AHCI_COMMAND_FLUSH_CACHE_EXT    0xEA
+
+#define AHCI_IDENTIFY_QUEUE_DEPTH       75
+#define AHCI_IDENTIFY_SATA_CAPABILITIES 76
+#define AHCI_SATA_CAPABILITY_NCQ        0x0100
+
+struct ahci_port_registers
+{
+    uint32_t command_list_base;
+    uint32_t command_list_base_upper;
+    uint32_t fis_base;
+    uint32_t fis_base_upper;
+    uint32_t interrupt_status;
+    uint32_t interrupt_enable;
+    uint32_t command;
+    uint32_t reserved0;
+    uint32_t task_file_data;
+    uint32_t signature;
+    uint32_t sata_status;
+    uint32_t sata_control;
+    uint32_t sata_error;
+    uint32_t sata_active;
+    uint32_t command_issue;
+    uint32_t sata_notification;
+    uint32_t fis_switching_control;
+    uint32_t reserved1[ 11 ];
+    uint32_t vendor[ 4 ];
+}
+__attribute__( ( packed ) );
+
+struct ahci_hba_registers
+{
+    uint32_t capabilities;
+    uint32_t global_host_control;
+    uint32_t interrupt_status;
+    uint32_t ports_implemented;
+    uint32_t version;
+    uint32_t ccc_control;
+    uint32_t ccc_ports;
+    uint32_t em_location;
+    uint32_t em_control;
+    uint32_t capabilities_extended;
+    uint32_t handoff_control;
+    uint8_t reserved[ 0x74 ];
+    uint8_t vendor[ 0x60 ];
+    struct ahci_port_registers ports[ AHCI_MAX_PORTS ];
+}
+__attribute__( ( packed ) );
+
+struct ahci_command_header
+{
+    uint8_t flags;
+    uint8_t flags_extended;
+    uint16_t prd_table_length;
+    /* bytes transferred, written by the HBA */
+    uint32_t prd_byte_count;
+    uint32_t command_table_base;
+    uint32_t command_table_base_upper;
+    uint32_t reserved[ 4 ];
+}
+__attribute__( ( packed ) );
+
+/* host to device register FIS */
+struct ahci_fis_h2d
+{
+    uint8_t type;
+    uint8_t flags;
+    uint8_t command;
+    uint8_t feature_low;
+
+    uint8_t lba0;
+    uint8_t lba1;
+    uint8_t lba2;
+    uint8_t device;
+
+    uint8_t lba3;
+    uint8_t lba4;
+    uint8_t lba5;
+    uint8_t feature_high;
+
+    uint8_t count_low;
+    uint8_t count_high;
+    uint8_t icc;
+    uint8_t control;
+
+    uint8_t reserved[ 4 ];
+}
+__attribute__( ( packed ) );
+
+struct ahci_prd
+{
+    uint32_t address;
+    uint32_t address_upper;
+    uint32_t reserved;
+    /* byte count minus one */
+    uint32_t byte_count;
+}
+__attribute__( ( packed ) );
+
+/*
+ * the kernel is identity mapped and its heap allocations are contiguous,
+ * a single region describes the whole buffer of a command
+ */
+struct ahci_command_table
+{
+    uint8_t command_fis[ 64 ];
+    uint8_t atapi_command[ 16 ];
+    uint8_t reserved[ 48 ];
+    struct ahci_prd prd;
+    /* command tables are 128 byte aligned */
+    uint8_t padding[ 112 ];
+}
+__attribute__( ( packed ) );
+
+struct ahci_port
+{
+    volatile struct ahci_port_registers *registers;
+
+    /* 32 command headers, 1KB aligned */
+    struct ahci_command_header *command_list;
+    /* received FIS area, 256 byte aligned */
+    void *fis;
+    struct ahci_command_table *command_tables;
+
+    /* word aligned copy area for odd caller buffers and IDENTIFY */
+    void *bounce;
+
+    /* commands the port keeps in flight, one without native command queuing */
+    int queue_depth;
+    bool ncq;
+
+    struct disk disk;
+};
+
+struct ahci
+{
+    struct pci_device controller;
+    volatile struct ahci_hba_registers *hba;
+    int command_slots;
+
+    struct ahci_port *ports[ AHCI_MAX_PORTS ];
+};
+
+int ahci_init();
+
+#endif /* AHCI_H_ */
@@ -1,62 +1,373 @@
 #include "disk.h"
+#include "disk_cache.h"
+#include "disk_dma.h"
+#include "ahci.h"
+#include "virtio_blk.h"
+#include "ramdisk.h"
 #include "io/io.h"
 #include "memory/memory.h"
 #include "status.h"
 #include "config.h"
+#include "idt/idt.h"
 
 struct disk disk;
+static struct disk *disks[ OS_MAX_DISKS ];
+
+/* sectors moved per interrupt by READ MULTIPLE, one until the drive accepted SET MULTIPLE */
+static int disk_sectors_per_block = 1;
+/* the drive is polled until the interrupt descriptor table is up */
+static bool disk_interrupts_enabled = false;
+/* the drive and the PCI IDE controller both do bus master DMA */
+static bool disk_dma_enabled = false;
+
+static void disk_delay_400ns()
+{
+    /* every read of the alternate status register takes about 100ns */
+    for( int idx = 0; idx < 4; idx++ )
+    {
+        insb( ATA_REGISTER_ALT_STATUS );
+    }
+}
+
+/* halt until the drive raises IRQ14, nothing but the disk may interrupt the kernel meanwhile */
+static void disk_wait_interrupt()
+{
+    uint8_t master_mask = insb( PIC_MASTER_DATA );
+    uint8_t slave_mask  = insb( PIC_SLAVE_DATA );
+
+    outb( PIC_MASTER_DATA, ~PIC_MASTER_CASCADE_IRQ_MASK );
+    outb( PIC_SLAVE_DATA, ~ATA_IRQ_SLAVE_MASK );
+
+    while( insb( ATA_REGISTER_ALT_STATUS ) & ATA_STATUS_BSY )
+    {
+        wait_for_interrupt();
+    }
+
+    outb( PIC_MASTER_DATA, master_mask );
+    outb( PIC_SLAVE_DATA, slave_mask );
+}
+
+/*
+ * wait for the drive to finish the current step, use the interrupt only where the
+ * protocol raises one, the first block of a write is always polled
+ */
+static int disk_wait( bool interrupt,
+                      bool data )
+{
+    disk_delay_400ns();
+
+    if( interrupt && disk_interrupts_enabled )
+    {
+        disk_wait_interrupt();
+    }
+
+    /* reading the status register also acknowledges the drive interrupt */
+    uint8_t status = insb( ATA_REGISTER_STATUS );
+
+    while( ( status & ATA_STATUS_BSY ) || ( data && !( status & ( ATA_STATUS_DRQ | ATA_STATUS_ERR | ATA_STATUS_DF ) ) ) )
+    {
+        status = insb( ATA_REGISTER_STATUS );
+    }
+
+    if( status & ( ATA_STATUS_ERR | ATA_STATUS_DF ) )
+    {
+        return -IO_ERROR;
+    }
+
+    return OS_OK;
+}
+
+static void disk_select( int lba,
+                         int total_sectors )
+{
+    outb( ATA_REGISTER_DRIVE, ( lba >> 24 ) | 0xE0 );
+    outb( ATA_REGISTER_SECTOR_COUNT, total_sectors );
+    outb( ATA_REGISTER_LBA_LOW, ( unsigned char ) ( lba & 0xFF ) );
+    outb( ATA_REGISTER_LBA_MID, ( unsigned char ) ( lba >> 8 ) );
+    outb( ATA_REGISTER_LBA_HIGH, ( unsigned char ) ( lba >> 16 ) );
+}
+
+/* the controller moves the data by itself, the CPU halts until the drive interrupts */
+static int disk_transfer_dma( int lba,
+                              int total_sectors,
+                              void *buffer,
+                              bool read )
+{
+    int res = diskdma_prepare( buffer, total_sectors, read );
+
+    if( res < 0 )
+    {
+        return res;
+    }
+
+    disk_select( lba, total_sectors );
+    outb( ATA_REGISTER_COMMAND, read ? ATA_COMMAND_READ_DMA : ATA_COMMAND_WRITE_DMA );
+    diskdma_start( read );
+
+    res = disk_wait( true, false );
+
+    /* the engine has to be stopped even when the drive failed */
+    int dma_res = diskdma_finish();
+
+    return ( res < 0 ) ? res : dma_res;
+}
+
+static bool disk_use_dma( int total_sectors,
+                          void *buffer )
+{
+    return disk_dma_enabled && ( total_sectors >= OS_DISK_DMA_MIN_SECTORS ) && !( ( uint32_t ) buffer & 0x01 );
+}
 
 int disk_read_sector( int lba,
                       int total_block_to_read,
                       void *buffer )
 {
-    outb( 0x1F6, ( lba >> 24 ) | 0xE0 );
-    outb( 0x1F2, total_block_to_read );
-    outb( 0x1F3, ( unsigned char ) ( lba & 0xFF ) );
-    outb( 0x1F4, ( unsigned char ) ( lba >> 8 ) );
-    outb( 0x1F5, ( unsigned char ) ( lba >> 16 ) );
-    outb( 0x1F7, 0x20 );
+    int res = OS_OK;
+    unsigned short *ptr = ( unsigned short * ) buffer;
+
+    if( disk_use_dma( total_block_to_read, buffer ) )
+    {
+        return disk_transfer_dma( lba, total_block_to_read, buffer, true );
+    }
+
+    disk_select( lba, total_block_to_read );
+    outb( ATA_REGISTER_COMMAND, ( disk_sectors_per_block > 1 ) ? ATA_COMMAND_READ_MULTIPLE : ATA_COMMAND_READ_SECTORS );
+
+    /* the drive interrupts once per block of sectors */
+    for( int read_blocks = 0; read_blocks < total_block_to_read; read_blocks += disk_sectors_per_block )
+    {
+        int total_sectors = total_block_to_read - read_blocks;
+
+        if( total_sectors > disk_sectors_per_block )
+        {
+            total_sectors = disk_sectors_per_block;
+        }
+
+        res = disk_wait( true, true );
+
+        if( res < 0 )
+        {
+            return res;
+        }
 
+        /* copy the whole block from hard disk to memory with a single rep insw */
+        insw_rep( ATA_REGISTER_DATA, ptr, total_sectors * ATA_WORDS_PER_SECTOR );
+        ptr += total_sectors * ATA_WORDS_PER_SECTOR;
+    }
+
+    return res;
+}
+
+int disk_write_sector( int lba,
+                       int total_block_to_write,
+                       void *buffer )
+{
+    int res = OS_OK;
     unsigned short *ptr = ( unsigned short * ) buffer;
 
-    for( int read_bytes = 0; read_bytes < total_block_to_read; read_bytes++ )
+    if( disk_use_dma( total_block_to_write, buffer ) )
     {
-        /* wait for the buffer to be ready */
-        char chr = insb( 0x1F7 );
+        return disk_transfer_dma( lba, total_block_to_write, buffer, false );
+    }
 
-        while( !( chr & 0x08 ) )
+    disk_select( lba, total_block_to_write );
+    outb( ATA_REGISTER_COMMAND, ( disk_sectors_per_block > 1 ) ? ATA_COMMAND_WRITE_MULTIPLE : ATA_COMMAND_WRITE_SECTORS );
+
+    for( int written_blocks = 0; written_blocks < total_block_to_write; written_blocks += disk_sectors_per_block )
+    {
+        int total_sectors = total_block_to_write - written_blocks;
+
+        if( total_sectors > disk_sectors_per_block )
         {
-            chr = insb( 0x1F7 );
+            total_sectors = disk_sectors_per_block;
         }
 
-        /* copy from hard disk to memory */
-        for( int copy_bytes = 0; copy_bytes < 256; copy_bytes++ )
+        /* the drive asks for the first block without an interrupt, the others follow one */
+        res = disk_wait( written_blocks != 0, true );
+
+        if( res < 0 )
         {
-            *ptr = insw( 0x1F0 );
-            ptr++;
+            return res;
         }
+
+        /* copy from memory to hard disk */
+        outsw_rep( ATA_REGISTER_DATA, ptr, total_sectors * ATA_WORDS_PER_SECTOR );
+        ptr += total_sectors * ATA_WORDS_PER_SECTOR;
+    }
+
+    /* wait until the drive has taken the last sector */
+    return disk_wait( true, false );
+}
+
+static int disk_identify( uint16_t *identify )
+{
+    outb( ATA_REGISTER_DRIVE, 0xE0 );
+    outb( ATA_REGISTER_COMMAND, ATA_COMMAND_IDENTIFY );
+
+    /* a status of zero means there is no drive */
+    if( !insb( ATA_REGISTER_STATUS ) || ( disk_wait( false, true ) < 0 ) )
+    {
+        return -IO_ERROR;
+    }
+
+    insw_rep( ATA_REGISTER_DATA, identify, ATA_WORDS_PER_SECTOR );
+
+    return OS_OK;
+}
+
+/* ask the drive how many sectors it can move per interrupt and switch it to that block size */
+static int disk_set_multiple_mode( uint16_t *identify )
+{
+    int sectors_per_block = identify[ ATA_IDENTIFY_MAX_MULTIPLE ] & 0xFF;
+
+    if( sectors_per_block > OS_DISK_MAX_SECTORS_PER_BLOCK )
+    {
+        sectors_per_block = OS_DISK_MAX_SECTORS_PER_BLOCK;
+    }
+
+    if( sectors_per_block < 2 )
+    {
+        return 1;
+    }
+
+    outb( ATA_REGISTER_SECTOR_COUNT, sectors_per_block );
+    outb( ATA_REGISTER_DRIVE, 0xE0 );
+    outb( ATA_REGISTER_COMMAND, ATA_COMMAND_SET_MULTIPLE );
+
+    if( disk_wait( false, false ) < 0 )
+    {
+        return 1;
+    }
+
+    return sectors_per_block;
+}
+
+static void disk_interrupt_handler()
+{
+    /* reading the status register lowers the drive interrupt line */
+    insb( ATA_REGISTER_STATUS );
+}
+
+/* from now on the drive completes commands through IRQ14 instead of being polled */
+void disk_enable_interrupts()
+{
+    idt_register_interrupt_callback( ATA_IRQ_INTERRUPT, disk_interrupt_handler );
+    outb( ATA_REGISTER_CONTROL, 0x00 );
+    disk_interrupts_enabled = true;
+}
+
+static int disk_ata_read( struct disk *idisk,
+                          unsigned int lba,
+                          int total_sectors,
+                          void *buffer )
+{
+    return disk_read_sector( lba, total_sectors, buffer );
+}
+
+static int disk_ata_write( struct disk *idisk,
+                           unsigned int lba,
+                           int total_sectors,
+                           void *buffer )
+{
+    return disk_write_sector( lba, total_sectors, buffer );
+}
+
+static int disk_ata_flush( struct disk *idisk )
+{
+    outb( ATA_REGISTER_DRIVE, 0xE0 );
+    outb( ATA_REGISTER_COMMAND, ATA_COMMAND_FLUSH_CACHE );
+
+    return disk_wait( true, false );
+}
+
+/* give the disk the next drive number and look for a filesystem on it */
+int disk_register( struct disk *idisk )
+{
+    for( int index = 0; index < OS_MAX_DISKS; index++ )
+    {
+        if( disks[ index ] )
+        {
+            continue;
+        }
+
+        idisk->id         = index;
+        disks[ index ]    = idisk;
+        diskqueue_init( &idisk->queue, idisk );
+        idisk->filesystem = fs_resolve( idisk );
+
+        return index;
     }
 
-    return 0;
+    return -NO_MEMORY_ERROR;
 }
 
 void disk_search_and_init()
 {
+    /* the filesystem probe below already goes through the cache */
+    diskcache_init();
+
+    /* no interrupts from the drive until the interrupt descriptor table is loaded */
+    outb( ATA_REGISTER_CONTROL, ATA_CONTROL_NIEN );
+
+    uint16_t identify[ ATA_WORDS_PER_SECTOR ];
+
+    if( disk_identify( identify ) == OS_OK )
+    {
+        disk_sectors_per_block = disk_set_multiple_mode( identify );
+        disk_dma_enabled       = ( identify[ ATA_IDENTIFY_CAPABILITIES ] & ATA_CAPABILITY_DMA ) && ( diskdma_init() == OS_OK );
+    }
+
+    /* the legacy channel is always drive 0 */
+    bzero( disks, sizeof( disks ) );
     bzero( &disk, sizeof( disk ) );
-    disk.type        = OS_DISK_TYPE_REAL;
-    disk.sector_size = OS_SECTOR_SIZE;
-    disk.id          = 0;
-    disk.filesystem  = fs_resolve( &disk );
+    disk.type          = OS_DISK_TYPE_REAL;
+    disk.sector_size   = OS_SECTOR_SIZE;
+    disk.read_sectors  = disk_ata_read;
+    disk.write_sectors = disk_ata_write;
+    disk.flush_cache   = disk_ata_flush;
+    disk_register( &disk );
+
+    /* the ramdisk is always drive 1, its image comes from the boot disk */
+    ramdisk_init( OS_RAMDISK_IMAGE );
+
+    /* SATA and paravirtual disks follow as 2:/, 3:/ ... */
+    ahci_init();
+    virtio_blk_init();
 }
 
 struct disk *disk_get( int index )
 {
-    if( index != 0 )
+    if( ( index < 0 ) || ( index >= OS_MAX_DISKS ) )
     {
         return 0;
     }
 
-    return &disk;
+    return disks[ index ];
+}
+
+static bool disk_is_registered( struct disk *idisk )
+{
+    return idisk && ( disk_get( idisk->id ) == idisk );
+}
+
+/* a single request through the queue of the disk, waits for it to complete */
+int disk_transfer( struct disk *idisk,
+                   unsigned int lba,
+                   int total_sectors,
+                   void *buffer,
+                   bool write )
+{
+    struct disk_request request;
+
+    diskqueue_request_init( &request, lba, total_sectors, buffer, write );
+    diskqueue_submit( &idisk->queue, &request );
+
+    if( !request.done )
+    {
+        diskqueue_run( &idisk->queue );
+    }
+
+    return request.status;
 }
 
 int disk_read_block( struct disk *idisk,
@@ -64,10 +375,205 @@ int disk_read_block( struct disk *idisk,
                      int total_block_to_read,
                      void *buffer )
 {
-    if( idisk != &disk )
+    int res = OS_OK;
+
+    if( !disk_is_registered( idisk ) )
+    {
+        return -IO_ERROR;
+    }
+
+    /* caching memory in memory only costs a copy */
+    if( idisk->type == OS_DISK_TYPE_RAM )
+    {
+        return disk_transfer( idisk, lba, total_block_to_read, buffer, false );
+    }
+
+    if( !diskcache_is_cacheable( total_block_to_read ) )
+    {
+        res = disk_transfer( idisk, lba, total_block_to_read, buffer, false );
+
+        if( res >= 0 )
+        {
+            diskcache_overlay( idisk, lba, total_block_to_read, buffer );
+        }
+
+        return res;
+    }
+
+    int block = 0;
+
+    while( block < total_block_to_read )
+    {
+        void *cached = diskcache_lookup( idisk, lba + block );
+
+        if( cached )
+        {
+            memcpy( buffer + ( block * OS_SECTOR_SIZE ), cached, OS_SECTOR_SIZE );
+            block++;
+            continue;
+        }
+
+        /* read the whole run of missing sectors with a single command */
+        int run = 1;
+
+        while( ( block + run < total_block_to_read ) && !diskcache_contains( idisk, lba + block + run ) )
+        {
+            run++;
+        }
+
+        res = disk_transfer( idisk, lba + block, run, buffer + ( block * OS_SECTOR_SIZE ), false );
+
+        if( res < 0 )
+        {
+            return res;
+        }
+
+        for( int idx = 0; idx < run; idx++ )
+        {
+            diskcache_insert( idisk, lba + block + idx, buffer + ( ( block + idx ) * OS_SECTOR_SIZE ) );
+        }
+
+        block += run;
+    }
+
+    return res;
+}
+
+static int disk_run_requests( struct disk *idisk,
+                              struct disk_request *requests,
+                              int total )
+{
+    int res = OS_OK;
+
+    diskqueue_run( &idisk->queue );
+
+    for( int idx = 0; idx < total; idx++ )
+    {
+        if( requests[ idx ].status < 0 )
+        {
+            res = requests[ idx ].status;
+        }
+    }
+
+    return res;
+}
+
+/*
+ * scattered runs straight into their buffers, the bulk runs are queued together so the
+ * elevator sees all of them, small runs go through the sector cache as usual
+ */
+int disk_read_vector( struct disk *idisk,
+                      struct disk_io_vector *vector,
+                      int total )
+{
+    int res = OS_OK;
+    struct disk_request requests[ OS_DISK_VECTOR_BATCH ];
+    int total_requests = 0;
+
+    if( !disk_is_registered( idisk ) )
     {
         return -IO_ERROR;
     }
 
-    return disk_read_sector( lba, total_block_to_read, buffer );
+    for( int idx = 0; ( idx < total ) && ( res >= 0 ); idx++ )
+    {
+        if( ( idisk->type != OS_DISK_TYPE_RAM ) && ( vector[ idx ].total_sectors <= OS_DISK_CACHE_MAX_SECTORS ) )
+        {
+            res = disk_read_block( idisk, vector[ idx ].lba, vector[ idx ].total_sectors, vector[ idx ].buffer );
+            continue;
+        }
+
+        for( int sector = 0; ( sector < vector[ idx ].total_sectors ) && ( res >= 0 ); sector += OS_DISK_MAX_SECTORS_PER_TRANSFER )
+        {
+            int total_sectors = vector[ idx ].total_sectors - sector;
+
+            if( total_sectors > OS_DISK_MAX_SECTORS_PER_TRANSFER )
+            {
+                total_sectors = OS_DISK_MAX_SECTORS_PER_TRANSFER;
+            }
+
+            diskqueue_request_init( &requests[ total_requests ], vector[ idx ].lba + sector, total_sectors, vector[ idx ].buffer + ( sector * OS_SECTOR_SIZE ), false );
+            diskqueue_submit( &idisk->queue, &requests[ total_requests ] );
+            total_requests++;
+
+            if( total_requests == OS_DISK_VECTOR_BATCH )
+            {
+                res = disk_run_requests( idisk, requests, total_requests );
+                total_requests = 0;
+            }
+        }
+    }
+
+    /* the requests live on this stack, none may stay queued */
+    if( total_requests > 0 )
+    {
+        int status = disk_run_requests( idisk, requests, total_requests );
+
+        res = ( res < 0 ) ? res : status;
+    }
+
+    for( int idx = 0; ( idx < total ) && ( res >= 0 ) && ( idisk->type != OS_DISK_TYPE_RAM ); idx++ )
+    {
+        if( vector[ idx ].total_sectors > OS_DISK_CACHE_MAX_SECTORS )
+        {
+            diskcache_overlay( idisk, vector[ idx ].lba, vector[ idx ].total_sectors, vector[ idx ].buffer );
+        }
+    }
+
+    return res;
+}
+
+/* small writes land in the sector cache and reach the disk later in sorted batches */
+int disk_write_block( struct disk *idisk,
+                      unsigned int lba,
+                      int total_block_to_write,
+                      void *buffer )
+{
+    if( !disk_is_registered( idisk ) )
+    {
+        return -IO_ERROR;
+    }
+
+    if( ( idisk->type != OS_DISK_TYPE_RAM ) && diskcache_is_cacheable( total_block_to_write ) )
+    {
+        return diskcache_write( idisk, lba, total_block_to_write, buffer );
+    }
+
+    int res = disk_transfer( idisk, lba, total_block_to_write, buffer, true );
+
+    if( res < 0 )
+    {
+        return res;
+    }
+
+    /* cached copies must not go stale */
+    diskcache_update( idisk, lba, total_block_to_write, buffer );
+
+    return res;
+}
+
+/*
+ * barrier, every write issued before it is on stable storage when it returns
+ * and none issued after it can overtake it
+ */
+int disk_flush( struct disk *idisk )
+{
+    if( !disk_is_registered( idisk ) )
+    {
+        return -IO_ERROR;
+    }
+
+    int res = diskcache_writeback( idisk );
+
+    if( res < 0 )
+    {
+        return res;
+    }
+
+    if( idisk->flush_cache )
+    {
+        res = idisk->flush_cache( idisk );
+    }
+
+    return res;
 }
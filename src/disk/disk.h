@@ -2,11 +2,73 @@
 #define DISK_H_
 
 #include "fs/file.h"
+#include "idt/idt.h"
+#include "disk_queue.h"
 
 typedef unsigned int OS_DISK_TYPE;
 
 /* represents real physical hard disk */
 #define OS_DISK_TYPE_REAL    0
+/* a SATA disk behind an AHCI controller */
+#define OS_DISK_TYPE_AHCI    1
+/* a paravirtual virtio block device */
+#define OS_DISK_TYPE_VIRTIO  2
+/* a block device in kernel memory */
+#define OS_DISK_TYPE_RAM     3
+
+/* primary ATA channel */
+#define ATA_REGISTER_DATA               0x1F0
+#define ATA_REGISTER_ERROR              0x1F1
+#define ATA_REGISTER_SECTOR_COUNT       0x1F2
+#define ATA_REGISTER_LBA_LOW            0x1F3
+#define ATA_REGISTER_LBA_MID            0x1F4
+#define ATA_REGISTER_LBA_HIGH           0x1F5
+#define ATA_REGISTER_DRIVE              0x1F6
+#define ATA_REGISTER_STATUS             0x1F7
+#define ATA_REGISTER_COMMAND            0x1F7
+#define ATA_REGISTER_ALT_STATUS         0x3F6 /* reading it does not acknowledge the interrupt */
+#define ATA_REGISTER_CONTROL            0x3F6
+
+#define ATA_WORDS_PER_SECTOR            ( OS_SECTOR_SIZE / 2 )
+
+#define ATA_STATUS_ERR                  0x01
+#define ATA_STATUS_DRQ                  0x08
+#define ATA_STATUS_DF                   0x20
+#define ATA_STATUS_BSY                  0x80
+
+#define ATA_CONTROL_NIEN                0x02 /* drive interrupts off */
+
+#define ATA_COMMAND_READ_SECTORS        0x20
+#define ATA_COMMAND_WRITE_SECTORS       0x30
+#define ATA_COMMAND_READ_MULTIPLE       0xC4
+#define ATA_COMMAND_WRITE_MULTIPLE      0xC5
+#define ATA_COMMAND_SET_MULTIPLE        0xC6
+#define ATA_COMMAND_READ_DMA            0xC8
+#define ATA_COMMAND_WRITE_DMA           0xCA
+#define ATA_COMMAND_FLUSH_CACHE         0xE7
+#define ATA_COMMAND_IDENTIFY            0xEC
+
+/* identify word with the largest READ MULTIPLE block in its low byte */
+#define ATA_IDENTIFY_MAX_MULTIPLE       47
+#define ATA_IDENTIFY_CAPABILITIES       49
+#define ATA_CAPABILITY_DMA              0x0100
+
+/* IRQ14 on the slave interrupt controller */
+#define ATA_IRQ_INTERRUPT               ( PIC_SLAVE_INTERRUPT_START + 6 )
+#define ATA_IRQ_SLAVE_MASK              0b01000000
+
+struct disk;
+
+typedef int (*DISK_READ_FUNCTION)( struct disk *disk,
+                                   unsigned int lba,
+                                   int total_sectors,
+                                   void *buffer );
+typedef int (*DISK_WRITE_FUNCTION)( struct disk *disk,
+                                    unsigned int lba,
+                                    int total_sectors,
+                                    void *buffer );
+/* empty the volatile write cache of the drive */
+typedef int (*DISK_FLUSH_FUNCTION)( struct disk *disk );
 
 struct disk
 {
@@ -17,13 +79,47 @@ struct disk
     struct filesystem *filesystem;
     /* the private data of our filesystem */
     void *fs_private;
+
+    /* the driver moving the sectors, below the sector cache */
+    DISK_READ_FUNCTION read_sectors;
+    DISK_WRITE_FUNCTION write_sectors;
+    /* optional */
+    DISK_FLUSH_FUNCTION flush_cache;
+    /* the private data of the driver */
+    void *driver_private;
+
+    /* requests on their way to the driver */
+    struct disk_queue queue;
+};
+
+/* one contiguous run of sectors and the memory it is read into */
+struct disk_io_vector
+{
+    unsigned int lba;
+    int total_sectors;
+    void *buffer;
 };
 
 void disk_search_and_init();
+void disk_enable_interrupts();
+int disk_register( struct disk *idisk );
 struct disk *disk_get( int index );
 int disk_read_block( struct disk *idisk,
                      unsigned int lba,
                      int total_block_to_read,
                      void *buffer );
+int disk_read_vector( struct disk *idisk,
+                      struct disk_io_vector *vector,
+                      int total );
+int disk_write_block( struct disk *idisk,
+                      unsigned int lba,
+                      int total_block_to_write,
+                      void *buffer );
+int disk_flush( struct disk *idisk );
+int disk_transfer( struct disk *idisk,
+                   unsigned int lba,
+                   int total_sectors,
+                   void *buffer,
+                   bool write );
 
 #endif /* DISK_H_ */
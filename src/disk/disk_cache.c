@@ -0,0 +1,404 @@
+#include "disk_cache.h"
+#include "disk.h"
+#include "disk_trace.h"
+#include "config.h"
+#include "status.h"
+#include "memory/memory.h"
+#include "memory/heap/kheap.h"
+#include "kernel.h"
+
+struct disk_cache disk_cache;
+
+/* sector cache in front of the disks, sized by OS_DISK_CACHE_SIZE_BYTES */
+int diskcache_init()
+{
+    int res = OS_OK;
+
+    bzero( &disk_cache, sizeof( disk_cache ) );
+
+    disk_cache.total_entries = OS_DISK_CACHE_SIZE_BYTES / OS_SECTOR_SIZE;
+    disk_cache.entries       = kzalloc( sizeof( struct disk_cache_entry ) * disk_cache.total_entries );
+    disk_cache.data          = kzalloc( OS_DISK_CACHE_SIZE_BYTES );
+    disk_cache.buckets       = kzalloc( sizeof( int ) * OS_DISK_CACHE_BUCKETS );
+
+    disk_cache.writeback_requests = kzalloc( sizeof( struct disk_request ) * OS_DISK_CACHE_MAX_DIRTY );
+
+    if( !disk_cache.entries || !disk_cache.data || !disk_cache.buckets || !disk_cache.writeback_requests )
+    {
+        res = -NO_MEMORY_ERROR;
+        kfree( disk_cache.entries );
+        kfree( disk_cache.data );
+        kfree( disk_cache.buckets );
+        kfree( disk_cache.writeback_requests );
+        bzero( &disk_cache, sizeof( disk_cache ) );
+        return res;
+    }
+
+    for( int idx = 0; idx < OS_DISK_CACHE_BUCKETS; idx++ )
+    {
+        disk_cache.buckets[ idx ] = -1;
+    }
+
+    disk_cache.stats.total_sectors = disk_cache.total_entries;
+
+    return res;
+}
+
+static bool diskcache_is_enabled()
+{
+    return disk_cache.entries != 0;
+}
+
+/* bulk reads would only push metadata out of the cache */
+bool diskcache_is_cacheable( int total_sectors )
+{
+    if( diskcache_is_enabled() && ( total_sectors <= OS_DISK_CACHE_MAX_SECTORS ) )
+    {
+        return true;
+    }
+
+    disk_cache.stats.bypasses++;
+    return false;
+}
+
+static uint32_t diskcache_hash( struct disk *disk,
+                                uint32_t lba )
+{
+    return ( lba + ( disk->id * 2654435761U ) ) % OS_DISK_CACHE_BUCKETS;
+}
+
+static uint8_t *diskcache_entry_data( int index )
+{
+    return disk_cache.data + ( index * OS_SECTOR_SIZE );
+}
+
+static int diskcache_find( struct disk *disk,
+                           uint32_t lba )
+{
+    if( !diskcache_is_enabled() )
+    {
+        return -IO_ERROR;
+    }
+
+    for( int index = disk_cache.buckets[ diskcache_hash( disk, lba ) ]; index >= 0; index = disk_cache.entries[ index ].next )
+    {
+        struct disk_cache_entry *entry = &disk_cache.entries[ index ];
+
+        if( ( entry->disk == disk ) && ( entry->lba == lba ) )
+        {
+            return index;
+        }
+    }
+
+    return -IO_ERROR;
+}
+
+static void diskcache_link( int index,
+                            struct disk *disk,
+                            uint32_t lba )
+{
+    struct disk_cache_entry *entry = &disk_cache.entries[ index ];
+    uint32_t bucket = diskcache_hash( disk, lba );
+
+    entry->disk       = disk;
+    entry->lba        = lba;
+    entry->valid      = true;
+    entry->referenced = false;
+    entry->dirty      = false;
+    entry->next       = disk_cache.buckets[ bucket ];
+    disk_cache.buckets[ bucket ] = index;
+    disk_cache.stats.cached_sectors++;
+}
+
+static void diskcache_unlink( int index )
+{
+    struct disk_cache_entry *entry = &disk_cache.entries[ index ];
+    int *link = &disk_cache.buckets[ diskcache_hash( entry->disk, entry->lba ) ];
+
+    while( *link >= 0 )
+    {
+        if( *link == index )
+        {
+            *link = entry->next;
+            break;
+        }
+
+        link = &disk_cache.entries[ *link ].next;
+    }
+
+    entry->valid = false;
+    disk_cache.stats.cached_sectors--;
+}
+
+static void diskcache_clean( int index )
+{
+    if( disk_cache.entries[ index ].dirty )
+    {
+        disk_cache.entries[ index ].dirty = false;
+        disk_cache.stats.dirty_sectors--;
+    }
+}
+
+/*
+ * hand every dirty sector of the disk, or of all disks when zero, to the disk queues,
+ * the elevator sorts them and merges neighbours into runs, the sectors stay cached but clean
+ */
+int diskcache_writeback( struct disk *disk )
+{
+    int res = OS_OK;
+    int total = 0;
+    struct disk_request *requests = disk_cache.writeback_requests;
+
+    if( !diskcache_is_enabled() || ( disk_cache.stats.dirty_sectors == 0 ) )
+    {
+        return res;
+    }
+
+    for( int index = 0; index < disk_cache.total_entries; index++ )
+    {
+        struct disk_cache_entry *entry = &disk_cache.entries[ index ];
+
+        if( !entry->valid || !entry->dirty || ( disk && ( entry->disk != disk ) ) )
+        {
+            continue;
+        }
+
+        /* only reachable after failed write backs, the rest waits for the next round */
+        if( total >= OS_DISK_CACHE_MAX_DIRTY )
+        {
+            break;
+        }
+
+        diskqueue_request_init( &requests[ total ], entry->lba, 1, diskcache_entry_data( index ), true );
+        requests[ total ].pid = DISK_TRACE_KERNEL_PID;
+        diskqueue_submit( &entry->disk->queue, &requests[ total ] );
+        total++;
+    }
+
+    for( int id = 0; id < OS_MAX_DISKS; id++ )
+    {
+        struct disk *queued = disk_get( id );
+
+        if( queued && ( !disk || ( queued == disk ) ) )
+        {
+            diskqueue_run( &queued->queue );
+        }
+    }
+
+    for( int idx = 0; idx < total; idx++ )
+    {
+        /* keep going, one bad run should not hold back the rest */
+        if( requests[ idx ].status < 0 )
+        {
+            res = requests[ idx ].status;
+            continue;
+        }
+
+        diskcache_clean( ( ( uint8_t * ) requests[ idx ].buffer - disk_cache.data ) / OS_SECTOR_SIZE );
+        disk_cache.stats.writebacks++;
+    }
+
+    return res;
+}
+
+/* background flusher, driven by the timer */
+void diskcache_writeback_tick()
+{
+    disk_cache.ticks++;
+
+    if( disk_cache.ticks < OS_DISK_CACHE_WRITEBACK_TICKS )
+    {
+        return;
+    }
+
+    disk_cache.ticks = 0;
+    diskcache_writeback( 0 );
+}
+
+/*
+ * clock over all entries, a referenced entry loses its bit and survives one more lap,
+ * a dirty entry that cannot be written back is passed over while clean ones are left
+ */
+static int diskcache_evict()
+{
+    bool failed      = false;
+    uint32_t visited = 0;
+
+    while( true )
+    {
+        int index = disk_cache.hand;
+        struct disk_cache_entry *entry = &disk_cache.entries[ index ];
+
+        disk_cache.hand = ( disk_cache.hand + 1 ) % disk_cache.total_entries;
+        visited++;
+
+        if( !entry->valid )
+        {
+            return index;
+        }
+
+        if( entry->referenced )
+        {
+            entry->referenced = false;
+            continue;
+        }
+
+        /* write back the whole disk at once, the neighbours are likely dirty too */
+        for( int attempt = 0; !failed && entry->dirty && ( attempt < OS_DISK_CACHE_WRITEBACK_RETRIES ); attempt++ )
+        {
+            diskcache_writeback( entry->disk );
+        }
+
+        if( entry->dirty )
+        {
+            failed = true;
+
+            /* the write back is retried on the next tick, unless there is nothing else to take */
+            if( visited <= disk_cache.total_entries * 2 )
+            {
+                continue;
+            }
+
+            disk_cache.stats.write_errors++;
+            diskcache_clean( index );
+            print( "disk cache: dropped a sector that could not be written back\n" );
+        }
+
+        diskcache_unlink( index );
+        disk_cache.stats.evictions++;
+
+        return index;
+    }
+}
+
+/* returns the cached copy of the sector, or zero on a miss */
+void *diskcache_lookup( struct disk *disk,
+                        uint32_t lba )
+{
+    int index = diskcache_find( disk, lba );
+
+    if( index < 0 )
+    {
+        return 0;
+    }
+
+    disk_cache.entries[ index ].referenced = true;
+    disk_cache.stats.hits++;
+
+    return diskcache_entry_data( index );
+}
+
+bool diskcache_contains( struct disk *disk,
+                         uint32_t lba )
+{
+    return diskcache_find( disk, lba ) >= 0;
+}
+
+/* add a sector that was just read from the disk */
+void diskcache_insert( struct disk *disk,
+                       uint32_t lba,
+                       void *sector )
+{
+    if( !diskcache_is_enabled() )
+    {
+        return;
+    }
+
+    int index = diskcache_find( disk, lba );
+
+    if( index < 0 )
+    {
+        index = diskcache_evict();
+        diskcache_link( index, disk, lba );
+    }
+
+    memcpy( diskcache_entry_data( index ), sector, OS_SECTOR_SIZE );
+    disk_cache.stats.misses++;
+}
+
+/* absorb a write at memory speed, the sectors reach the disk on write back */
+int diskcache_write( struct disk *disk,
+                     uint32_t lba,
+                     int total_sectors,
+                     void *buffer )
+{
+    int res = OS_OK;
+
+    for( int idx = 0; idx < total_sectors; idx++ )
+    {
+        int index = diskcache_find( disk, lba + idx );
+
+        if( index < 0 )
+        {
+            index = diskcache_evict();
+            diskcache_link( index, disk, lba + idx );
+        }
+
+        memcpy( diskcache_entry_data( index ), buffer + ( idx * OS_SECTOR_SIZE ), OS_SECTOR_SIZE );
+        disk_cache.entries[ index ].referenced = true;
+
+        if( !disk_cache.entries[ index ].dirty )
+        {
+            disk_cache.entries[ index ].dirty = true;
+            disk_cache.stats.dirty_sectors++;
+        }
+
+        /* the sort buffer bounds how much may pile up */
+        if( disk_cache.stats.dirty_sectors >= OS_DISK_CACHE_MAX_DIRTY )
+        {
+            res = diskcache_writeback( 0 );
+
+            if( res < 0 )
+            {
+                return res;
+            }
+        }
+    }
+
+    return res;
+}
+
+/* keep cached copies in step with sectors written to the disk */
+void diskcache_update( struct disk *disk,
+                       uint32_t lba,
+                       int total_sectors,
+                       void *buffer )
+{
+    for( int idx = 0; idx < total_sectors; idx++ )
+    {
+        int index = diskcache_find( disk, lba + idx );
+
+        if( index >= 0 )
+        {
+            memcpy( diskcache_entry_data( index ), buffer + ( idx * OS_SECTOR_SIZE ), OS_SECTOR_SIZE );
+            diskcache_clean( index );
+        }
+    }
+}
+
+/* bulk reads go around the cache, sectors written since must still win over the disk */
+void diskcache_overlay( struct disk *disk,
+                        uint32_t lba,
+                        int total_sectors,
+                        void *buffer )
+{
+    if( !diskcache_is_enabled() || ( disk_cache.stats.dirty_sectors == 0 ) )
+    {
+        return;
+    }
+
+    for( int idx = 0; idx < total_sectors; idx++ )
+    {
+        int index = diskcache_find( disk, lba + idx );
+
+        if( ( index >= 0 ) && disk_cache.entries[ index ].dirty )
+        {
+            memcpy( buffer + ( idx * OS_SECTOR_SIZE ), diskcache_entry_data( index ), OS_SECTOR_SIZE );
+        }
+    }
+}
+
+void diskcache_get_stats( struct disk_cache_stats *stats )
+{
+    memcpy( stats, &disk_cache.stats, sizeof( struct disk_cache_stats ) );
+}
@@ -0,0 +1,83 @@
+#ifndef DISK_CACHE_H_
+#define DISK_CACHE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+struct disk;
+struct disk_request;
+
+/* one cached sector */
+struct disk_cache_entry
+{
+    struct disk *disk;
+    uint32_t lba;
+    /* next entry in the same hash bucket, -1 ends the chain */
+    int next;
+    bool valid;
+    /* set on every hit, cleared by the clock hand */
+    bool referenced;
+    /* written by the kernel but not yet by the disk */
+    bool dirty;
+};
+
+struct disk_cache_stats
+{
+    uint32_t total_sectors;
+    uint32_t cached_sectors;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+    /* large reads that went around the cache */
+    uint32_t bypasses;
+
+    uint32_t dirty_sectors;
+    uint32_t writebacks;
+    /* dirty sectors that could not be written back and were dropped */
+    uint32_t write_errors;
+};
+
+struct disk_cache
+{
+    struct disk_cache_entry *entries;
+    /* sector sized slots, one per entry */
+    uint8_t *data;
+    int *buckets;
+    uint32_t total_entries;
+
+    /* clock hand */
+    uint32_t hand;
+
+    /* one write request per dirty entry */
+    struct disk_request *writeback_requests;
+    uint32_t ticks;
+
+    struct disk_cache_stats stats;
+};
+
+int diskcache_init();
+bool diskcache_is_cacheable( int total_sectors );
+void *diskcache_lookup( struct disk *disk,
+                        uint32_t lba );
+bool diskcache_contains( struct disk *disk,
+                         uint32_t lba );
+void diskcache_insert( struct disk *disk,
+                       uint32_t lba,
+                       void *sector );
+int diskcache_write( struct disk *disk,
+                     uint32_t lba,
+                     int total_sectors,
+                     void *buffer );
+int diskcache_writeback( struct disk *disk );
+void diskcache_writeback_tick();
+void diskcache_update( struct disk *disk,
+                       uint32_t lba,
+                       int total_sectors,
+                       void *buffer );
+void diskcache_overlay( struct disk *disk,
+                        uint32_t lba,
+                        int total_sectors,
+                        void *buffer );
+void diskcache_get_stats( struct disk_cache_stats *stats );
+
+#endif /* DISK_CACHE_H_ */
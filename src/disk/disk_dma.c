@@ -0,0 +1,148 @@
+#include "disk_dma.h"
+#include "config.h"
+#include "status.h"
+#include "io/io.h"
+#include "memory/memory.h"
+#include "memory/heap/kheap.h"
+
+struct disk_dma disk_dma;
+
+/* find the PCI IDE controller and its bus master registers */
+int diskdma_init()
+{
+    int res = OS_OK;
+
+    bzero( &disk_dma, sizeof( disk_dma ) );
+
+    res = pci_find_class( PCI_CLASS_MASS_STORAGE, PCI_SUBCLASS_IDE, &disk_dma.controller );
+
+    if( res < 0 )
+    {
+        return res;
+    }
+
+    uint32_t base = pci_get_bar( &disk_dma.controller, DISK_DMA_BAR );
+
+    /* no bus master support, or the registers live in memory space */
+    if( !base || !( pci_config_read( &disk_dma.controller, PCI_REGISTER_BAR0 + ( DISK_DMA_BAR * 4 ) ) & PCI_BAR_IO_SPACE ) )
+    {
+        res = -IO_ERROR;
+        bzero( &disk_dma, sizeof( disk_dma ) );
+        return res;
+    }
+
+    disk_dma.prd_table = kzalloc( sizeof( struct disk_dma_prd ) * OS_DISK_DMA_MAX_PRDS );
+
+    if( !disk_dma.prd_table )
+    {
+        res = -NO_MEMORY_ERROR;
+        bzero( &disk_dma, sizeof( disk_dma ) );
+        return res;
+    }
+
+    disk_dma.base = base;
+    pci_enable_bus_master( &disk_dma.controller );
+
+    /* stop the engine and clear any stale error or interrupt */
+    outb( disk_dma.base + DISK_DMA_REGISTER_COMMAND, 0x00 );
+    outb( disk_dma.base + DISK_DMA_REGISTER_STATUS, DISK_DMA_STATUS_ERROR | DISK_DMA_STATUS_INTERRUPT );
+
+    return res;
+}
+
+bool diskdma_is_enabled()
+{
+    return disk_dma.prd_table != 0;
+}
+
+/*
+ * describe the buffer in the descriptor table, the kernel is identity mapped so the
+ * buffer address is its physical address and heap allocations are contiguous
+ */
+static int diskdma_build_prd_table( void *buffer,
+                                    uint32_t size )
+{
+    uint32_t address = ( uint32_t ) buffer;
+    int total_prds   = 0;
+
+    while( size > 0 )
+    {
+        if( total_prds >= OS_DISK_DMA_MAX_PRDS )
+        {
+            return -INVALID_ARGUMENT_ERROR;
+        }
+
+        uint32_t region = DISK_DMA_REGION_BOUNDARY - ( address % DISK_DMA_REGION_BOUNDARY );
+
+        if( region > size )
+        {
+            region = size;
+        }
+
+        disk_dma.prd_table[ total_prds ].address = address;
+        disk_dma.prd_table[ total_prds ].size    = region & 0xFFFF;
+        disk_dma.prd_table[ total_prds ].flags   = 0x00;
+
+        address += region;
+        size    -= region;
+        total_prds++;
+    }
+
+    disk_dma.prd_table[ total_prds - 1 ].flags = DISK_DMA_PRD_END_OF_TABLE;
+
+    return OS_OK;
+}
+
+/* load the descriptor table and direction, the drive command goes out before diskdma_start */
+int diskdma_prepare( void *buffer,
+                     int total_sectors,
+                     bool read )
+{
+    int res = OS_OK;
+
+    /* the controller moves whole words only */
+    if( !diskdma_is_enabled() || ( ( uint32_t ) buffer & 0x01 ) || ( total_sectors <= 0 ) )
+    {
+        res = -INVALID_ARGUMENT_ERROR;
+        return res;
+    }
+
+    res = diskdma_build_prd_table( buffer, total_sectors * OS_SECTOR_SIZE );
+
+    if( res < 0 )
+    {
+        return res;
+    }
+
+    outl( disk_dma.base + DISK_DMA_REGISTER_PRD_TABLE, ( uint32_t ) disk_dma.prd_table );
+    outb( disk_dma.base + DISK_DMA_REGISTER_COMMAND, read ? DISK_DMA_COMMAND_READ : 0x00 );
+    outb( disk_dma.base + DISK_DMA_REGISTER_STATUS, DISK_DMA_STATUS_ERROR | DISK_DMA_STATUS_INTERRUPT );
+
+    return res;
+}
+
+void diskdma_start( bool read )
+{
+    outb( disk_dma.base + DISK_DMA_REGISTER_COMMAND, ( read ? DISK_DMA_COMMAND_READ : 0x00 ) | DISK_DMA_COMMAND_START );
+}
+
+/* stop the engine once the drive raised its interrupt and report how the transfer went */
+int diskdma_finish()
+{
+    uint8_t status = insb( disk_dma.base + DISK_DMA_REGISTER_STATUS );
+
+    while( ( status & DISK_DMA_STATUS_ACTIVE ) && !( status & ( DISK_DMA_STATUS_INTERRUPT | DISK_DMA_STATUS_ERROR ) ) )
+    {
+        status = insb( disk_dma.base + DISK_DMA_REGISTER_STATUS );
+    }
+
+    outb( disk_dma.base + DISK_DMA_REGISTER_COMMAND, 0x00 );
+    outb( disk_dma.base + DISK_DMA_REGISTER_STATUS, DISK_DMA_STATUS_ERROR | DISK_DMA_STATUS_INTERRUPT );
+
+    if( status & DISK_DMA_STATUS_ERROR )
+    {
+        return -IO_ERROR;
+    }
+
+    return OS_OK;
+}
@@ -0,0 +1,53 @@
+#ifndef DISK_DMA_H_
+#define DISK_DMA_H_
+
+#include "pci/pci.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/* bus master IDE registers of the primary channel, relative to BAR4 */
+#define DISK_DMA_REGISTER_COMMAND       0x00
+#define DISK_DMA_REGISTER_STATUS        0x02
+#define DISK_DMA_REGISTER_PRD_TABLE     0x04
+
+#define DISK_DMA_COMMAND_START          0x01
+/* the controller writes to memory, a disk read */
+#define DISK_DMA_COMMAND_READ           0x08
+
+#define DISK_DMA_STATUS_ACTIVE          0x01
+#define DISK_DMA_STATUS_ERROR           0x02
+#define DISK_DMA_STATUS_INTERRUPT       0x04
+
+/* a region may not cross a 64KB boundary, a size of zero means 64KB */
+#define DISK_DMA_REGION_BOUNDARY        0x10000
+#define DISK_DMA_PRD_END_OF_TABLE       0x8000
+
+#define DISK_DMA_BAR                    4
+
+/* physical region descriptor */
+struct disk_dma_prd
+{
+    uint32_t address;
+    uint16_t size;
+    uint16_t flags;
+}
+__attribute__( ( packed ) );
+
+struct disk_dma
+{
+    struct pci_device controller;
+    uint16_t base;
+
+    /* the descriptor table, one kernel heap block never crosses a 64KB boundary */
+    struct disk_dma_prd *prd_table;
+};
+
+int diskdma_init();
+bool diskdma_is_enabled();
+int diskdma_prepare( void *buffer,
+                     int total_sectors,
+                     bool read );
+void diskdma_start( bool read );
+int diskdma_finish();
+
+#endif /* DISK_DMA_H_ */
@@ -0,0 +1,454 @@
+#include "disk_queue.h"
+#include "disk.h"
+#include "config.h"
+#include "status.h"
+#include "memory/memory.h"
+#include "memory/heap/kheap.h"
+#include "time/tsc.h"
+#include "disk_trace.h"
+#include "task/task.h"
+#include "task/process.h"
+
+static void diskqueue_noop_add( struct disk_queue *queue,
+                                struct disk_request *request )
+{
+    struct disk_request **link = &queue->head;
+
+    while( *link )
+    {
+        link = &( *link )->next;
+    }
+
+    *link = request;
+}
+
+static struct disk_request *diskqueue_noop_next( struct disk_queue *queue )
+{
+    struct disk_request *request = queue->head;
+
+    queue->head = request->next;
+
+    return request;
+}
+
+/* the queue is kept sorted by sector */
+static void diskqueue_deadline_add( struct disk_queue *queue,
+                                    struct disk_request *request )
+{
+    struct disk_request **link = &queue->head;
+
+    while( *link && ( ( *link )->lba < request->lba ) )
+    {
+        link = &( *link )->next;
+    }
+
+    request->expires = queue->stats.dispatched + ( request->write ? OS_DISK_DEADLINE_WRITE_EXPIRE : OS_DISK_DEADLINE_READ_EXPIRE );
+    request->next    = *link;
+    *link            = request;
+}
+
+/* the most overdue request if there is one, else the next one up from the elevator position */
+static struct disk_request *diskqueue_deadline_next( struct disk_queue *queue )
+{
+    struct disk_request **chosen = 0;
+
+    for( struct disk_request **link = &queue->head; *link; link = &( *link )->next )
+    {
+        if( ( ( *link )->expires <= queue->stats.dispatched ) && ( !chosen || ( ( *link )->expires < ( *chosen )->expires ) ) )
+        {
+            chosen = link;
+        }
+    }
+
+    for( struct disk_request **link = &queue->head; !chosen && *link; link = &( *link )->next )
+    {
+        if( ( *link )->lba >= queue->position )
+        {
+            chosen = link;
+        }
+    }
+
+    /* nothing above the position, sweep again from the lowest sector */
+    if( !chosen )
+    {
+        chosen = &queue->head;
+    }
+
+    struct disk_request *request = *chosen;
+
+    *chosen = request->next;
+
+    return request;
+}
+
+static struct disk_scheduler disk_schedulers[ DISK_TOTAL_SCHEDULERS ] =
+{
+    { .add = diskqueue_noop_add,     .next = diskqueue_noop_next },
+    { .add = diskqueue_deadline_add, .next = diskqueue_deadline_next }
+};
+
+void diskqueue_init( struct disk_queue *queue,
+                     struct disk *disk )
+{
+    bzero( queue, sizeof( struct disk_queue ) );
+    queue->disk            = disk;
+    queue->scheduler       = &disk_schedulers[ OS_DISK_DEFAULT_SCHEDULER ];
+    queue->stats.scheduler = OS_DISK_DEFAULT_SCHEDULER;
+}
+
+/* only switched while the queue is empty, the schedulers keep their lists in different orders */
+int diskqueue_set_scheduler( struct disk_queue *queue,
+                             int scheduler )
+{
+    if( ( scheduler < 0 ) || ( scheduler >= DISK_TOTAL_SCHEDULERS ) )
+    {
+        return -INVALID_ARGUMENT_ERROR;
+    }
+
+    diskqueue_run( queue );
+
+    queue->scheduler       = &disk_schedulers[ scheduler ];
+    queue->stats.scheduler = scheduler;
+
+    return OS_OK;
+}
+
+void diskqueue_request_init( struct disk_request *request,
+                             uint32_t lba,
+                             int total_sectors,
+                             void *buffer,
+                             bool write )
+{
+    bzero( request, sizeof( struct disk_request ) );
+    request->lba           = lba;
+    request->total_sectors = total_sectors;
+    request->buffer        = buffer;
+    request->write         = write;
+    request->pid           = DISK_TRACE_KERNEL_PID;
+
+    if( task_current() && task_current()->process )
+    {
+        request->pid = task_current()->process->id;
+    }
+}
+
+static uint32_t diskqueue_end( struct disk_request *request )
+{
+    return request->lba + request->merged_sectors;
+}
+
+static bool diskqueue_can_merge( struct disk_request *first,
+                                 struct disk_request *second )
+{
+    return ( first->write == second->write ) &&
+           ( diskqueue_end( first ) == second->lba ) &&
+           ( first->merged_sectors + second->merged_sectors <= OS_DISK_QUEUE_MAX_MERGE_SECTORS );
+}
+
+/* append the chain of second to the chain of first, second is not queued on its own anymore */
+static void diskqueue_join( struct disk_request *first,
+                            struct disk_request *second )
+{
+    struct disk_request *tail = first;
+
+    while( tail->merged )
+    {
+        tail = tail->merged;
+    }
+
+    tail->merged            = second;
+    first->merged_sectors  += second->merged_sectors;
+
+    if( second->expires < first->expires )
+    {
+        first->expires = second->expires;
+    }
+}
+
+static struct disk_request **diskqueue_find_link( struct disk_queue *queue,
+                                                  struct disk_request *request )
+{
+    struct disk_request **link = &queue->head;
+
+    while( *link && ( *link != request ) )
+    {
+        link = &( *link )->next;
+    }
+
+    return link;
+}
+
+/* back merge into a queued request ending where this one starts, or front merge into one starting where it ends */
+static bool diskqueue_merge( struct disk_queue *queue,
+                             struct disk_request *request )
+{
+    for( struct disk_request **link = &queue->head; *link; link = &( *link )->next )
+    {
+        struct disk_request *queued = *link;
+
+        if( diskqueue_can_merge( queued, request ) )
+        {
+            diskqueue_join( queued, request );
+
+            /* the request may have closed the gap to the next one */
+            for( struct disk_request **after = &queue->head; *after; after = &( *after )->next )
+            {
+                if( ( *after != queued ) && diskqueue_can_merge( queued, *after ) )
+                {
+                    struct disk_request *joined = *after;
+
+                    *after = joined->next;
+                    diskqueue_join( queued, joined );
+                    queue->stats.depth--;
+                    break;
+                }
+            }
+
+            return true;
+        }
+
+        if( diskqueue_can_merge( request, queued ) )
+        {
+            /* the request takes the place of the one it precedes */
+            request->expires = queued->expires;
+            request->next    = queued->next;
+            *link            = request;
+            diskqueue_join( request, queued );
+
+            for( struct disk_request **before = &queue->head; *before; before = &( *before )->next )
+            {
+                if( ( *before != request ) && diskqueue_can_merge( *before, request ) )
+                {
+                    struct disk_request **request_link = diskqueue_find_link( queue, request );
+
+                    *request_link = request->next;
+                    diskqueue_join( *before, request );
+                    queue->stats.depth--;
+                    break;
+                }
+            }
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* reordering is only safe between requests that do not touch the same sectors */
+static bool diskqueue_overlaps( struct disk_queue *queue,
+                                struct disk_request *request )
+{
+    for( struct disk_request *queued = queue->head; queued; queued = queued->next )
+    {
+        if( ( request->lba < diskqueue_end( queued ) ) && ( queued->lba < request->lba + request->total_sectors ) )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void diskqueue_submit( struct disk_queue *queue,
+                       struct disk_request *request )
+{
+    request->done           = false;
+    request->status         = OS_OK;
+    request->merged_sectors = request->total_sectors;
+    request->merged         = 0;
+    request->next           = 0;
+    request->submitted      = tsc_read();
+    request->expires        = 0xFFFFFFFF;
+
+    queue->stats.submitted++;
+
+    if( diskqueue_overlaps( queue, request ) )
+    {
+        diskqueue_run( queue );
+    }
+
+    if( diskqueue_merge( queue, request ) )
+    {
+        queue->stats.merges++;
+        return;
+    }
+
+    queue->scheduler->add( queue, request );
+    queue->stats.depth++;
+
+    if( queue->stats.depth > queue->stats.max_depth )
+    {
+        queue->stats.max_depth = queue->stats.depth;
+    }
+
+    if( queue->stats.depth >= OS_DISK_QUEUE_MAX_DEPTH )
+    {
+        diskqueue_run( queue );
+    }
+}
+
+static int diskqueue_transfer( struct disk_queue *queue,
+                               uint32_t lba,
+                               int total_sectors,
+                               void *buffer,
+                               bool write )
+{
+    struct disk *disk = queue->disk;
+
+    queue->stats.dispatched++;
+
+    if( write )
+    {
+        return disk->write_sectors( disk, lba, total_sectors, buffer );
+    }
+
+    return disk->read_sectors( disk, lba, total_sectors, buffer );
+}
+
+static int diskqueue_histogram_bucket( uint64_t cycles )
+{
+    int bucket = 0;
+
+    while( ( cycles >>= 1 ) && ( bucket < DISK_HISTOGRAM_BUCKETS - 1 ) )
+    {
+        bucket++;
+    }
+
+    return bucket;
+}
+
+static void diskqueue_account( struct disk_queue *queue,
+                               struct disk_request *part,
+                               uint64_t issued,
+                               uint64_t completed )
+{
+    uint64_t latency = completed - part->submitted;
+    uint32_t bytes   = part->total_sectors * OS_SECTOR_SIZE;
+
+    queue->stats.total_latency_cycles += latency;
+
+    if( latency > queue->stats.max_latency_cycles )
+    {
+        queue->stats.max_latency_cycles = latency;
+    }
+
+    if( part->write )
+    {
+        queue->stats.writes++;
+        queue->stats.write_sectors += part->total_sectors;
+        queue->stats.write_bytes   += bytes;
+    }
+    else
+    {
+        queue->stats.reads++;
+        queue->stats.read_sectors += part->total_sectors;
+        queue->stats.read_bytes   += bytes;
+    }
+
+    disktrace_record( queue->disk, part, issued, completed );
+}
+
+static bool diskqueue_is_contiguous( struct disk_request *request )
+{
+    for( ; request->merged; request = request->merged )
+    {
+        if( request->buffer + ( request->total_sectors * OS_SECTOR_SIZE ) != request->merged->buffer )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* one command for the whole chain, through the bounce buffer when the buffers are scattered */
+static void diskqueue_dispatch( struct disk_queue *queue,
+                                struct disk_request *request )
+{
+    int res = OS_OK;
+    uint64_t issued = tsc_read();
+
+    if( !queue->bounce && !diskqueue_is_contiguous( request ) )
+    {
+        queue->bounce = kzalloc( OS_DISK_QUEUE_MAX_MERGE_SECTORS * OS_SECTOR_SIZE );
+    }
+
+    if( diskqueue_is_contiguous( request ) )
+    {
+        res = diskqueue_transfer( queue, request->lba, request->merged_sectors, request->buffer, request->write );
+    }
+    else if( queue->bounce )
+    {
+        void *ptr = queue->bounce;
+
+        for( struct disk_request *part = request; part && request->write; part = part->merged )
+        {
+            memcpy( ptr, part->buffer, part->total_sectors * OS_SECTOR_SIZE );
+            ptr += part->total_sectors * OS_SECTOR_SIZE;
+        }
+
+        res = diskqueue_transfer( queue, request->lba, request->merged_sectors, queue->bounce, request->write );
+
+        ptr = queue->bounce;
+
+        for( struct disk_request *part = request; part && !request->write && ( res >= 0 ); part = part->merged )
+        {
+            memcpy( part->buffer, ptr, part->total_sectors * OS_SECTOR_SIZE );
+            ptr += part->total_sectors * OS_SECTOR_SIZE;
+        }
+    }
+    else
+    {
+        /* no memory for the bounce buffer, fall back to a command per request */
+        for( struct disk_request *part = request; part; part = part->merged )
+        {
+            part->status = diskqueue_transfer( queue, part->lba, part->total_sectors, part->buffer, part->write );
+
+            if( part->status < 0 )
+            {
+                res = part->status;
+            }
+        }
+    }
+
+    queue->position = diskqueue_end( request );
+
+    uint64_t completed = tsc_read();
+
+    queue->stats.service_histogram[ diskqueue_histogram_bucket( completed - issued ) ]++;
+
+    if( res < 0 )
+    {
+        queue->stats.errors++;
+    }
+
+    for( struct disk_request *part = request; part; part = part->merged )
+    {
+        if( part->status == OS_OK )
+        {
+            part->status = res;
+        }
+
+        diskqueue_account( queue, part, issued, completed );
+        part->done = true;
+    }
+}
+
+/* dispatch everything queued in the order the scheduler picks */
+void diskqueue_run( struct disk_queue *queue )
+{
+    while( queue->head )
+    {
+        struct disk_request *request = queue->scheduler->next( queue );
+
+        queue->stats.depth--;
+        diskqueue_dispatch( queue, request );
+    }
+}
+
+void diskqueue_get_stats( struct disk_queue *queue,
+                          struct disk_queue_stats *stats )
+{
+    memcpy( stats, &queue->stats, sizeof( struct disk_queue_stats ) );
+}
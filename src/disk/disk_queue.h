@@ -0,0 +1,112 @@
+#ifndef DISK_QUEUE_H_
+#define DISK_QUEUE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+struct disk;
+
+/* requests go out in submission order, only adjacent requests are merged */
+#define DISK_SCHEDULER_NOOP        0
+/* one way elevator over the sectors, requests past their deadline go first */
+#define DISK_SCHEDULER_DEADLINE    1
+#define DISK_TOTAL_SCHEDULERS      2
+
+/* service times are counted in power of two buckets of cycles */
+#define DISK_HISTOGRAM_BUCKETS     32
+
+/* a range of sectors to move, owned by the submitter until it is done */
+struct disk_request
+{
+    uint32_t lba;
+    int total_sectors;
+    void *buffer;
+    bool write;
+
+    bool done;
+    int status;
+
+    /* the process the request is accounted to */
+    uint32_t pid;
+
+    /* cycles at submission, for the latency statistics */
+    uint64_t submitted;
+    /* dispatch count by which the deadline scheduler has to take it */
+    uint32_t expires;
+
+    /* sectors of the whole merged chain, only kept on its first request */
+    int merged_sectors;
+    /* the next request in the queue */
+    struct disk_request *next;
+    /* the request merged right behind this one */
+    struct disk_request *merged;
+};
+
+struct disk_queue_stats
+{
+    uint32_t scheduler;
+    uint32_t submitted;
+    /* requests that joined a neighbour instead of taking a command of their own */
+    uint32_t merges;
+    /* commands sent to the driver */
+    uint32_t dispatched;
+    uint32_t depth;
+    uint32_t max_depth;
+    /* from submission to completion */
+    uint64_t total_latency_cycles;
+    uint64_t max_latency_cycles;
+
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t read_sectors;
+    uint32_t write_sectors;
+    uint64_t read_bytes;
+    uint64_t write_bytes;
+    /* commands that failed */
+    uint32_t errors;
+
+    /* time spent in the driver per command, bucket n holds 2^n up to 2^(n+1) cycles */
+    uint32_t service_histogram[ DISK_HISTOGRAM_BUCKETS ];
+};
+
+struct disk_queue;
+
+struct disk_scheduler
+{
+    void (*add)( struct disk_queue *queue,
+                 struct disk_request *request );
+    /* unlink and return the next request to dispatch */
+    struct disk_request *(*next)( struct disk_queue *queue );
+};
+
+struct disk_queue
+{
+    struct disk *disk;
+    struct disk_scheduler *scheduler;
+
+    struct disk_request *head;
+    /* sector following the last dispatched request, the elevator position */
+    uint32_t position;
+
+    /* gathers merged requests whose buffers are not contiguous, allocated on first use */
+    void *bounce;
+
+    struct disk_queue_stats stats;
+};
+
+void diskqueue_init( struct disk_queue *queue,
+                     struct disk *disk );
+int diskqueue_set_scheduler( struct disk_queue *queue,
+                             int scheduler );
+void diskqueue_request_init( struct disk_request *request,
+                             uint32_t lba,
+                             int total_sectors,
+                             void *buffer,
+                             bool write );
+void diskqueue_submit( struct disk_queue *queue,
+                       struct disk_request *request );
+void diskqueue_run( struct disk_queue *queue );
+void diskqueue_get_stats( struct disk_queue *queue,
+                          struct disk_queue_stats *stats );
+
+#endif /* DISK_QUEUE_H_ */
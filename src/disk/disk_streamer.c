@@ -1,6 +1,8 @@
 #include "disk_streamer.h"
 #include "memory/heap/kheap.h"
 #include "config.h"
+#include "status.h"
+#include "memory/memory.h"
 #include <stdbool.h>
 
 struct disk_stream *diskstreamer_new( int disk_id )
@@ -26,22 +28,15 @@ int diskstreamer_seek( struct disk_stream *stream,
     return 0;
 }
 
-int diskstreamer_read( struct disk_stream *stream,
-                       void *out,
-                       int bytes_to_read )
+/* part of a single sector, read through a bounce buffer */
+static int diskstreamer_read_fragment( struct disk_stream *stream,
+                                       void *out,
+                                       int bytes_to_read )
 {
-    int sector        = stream->position / OS_SECTOR_SIZE;
-    int offset        = stream->position % OS_SECTOR_SIZE;
-    int total_to_read = bytes_to_read;
-    bool overflow     = ( offset + total_to_read ) >= OS_SECTOR_SIZE;
+    int sector = stream->position / OS_SECTOR_SIZE;
+    int offset = stream->position % OS_SECTOR_SIZE;
     char buffer[ OS_SECTOR_SIZE ];
 
-
-    if( overflow )
-    {
-        total_to_read -= ( offset + total_to_read ) - OS_SECTOR_SIZE;
-    }
-
     int res = disk_read_block( stream->disk, sector, 1, buffer );
 
     if( res < 0 )
@@ -49,17 +44,66 @@ int diskstreamer_read( struct disk_stream *stream,
         return res;
     }
 
-    for( int idx = 0; idx < total_to_read; idx++ )
+    memcpy( out, buffer + offset, bytes_to_read );
+
+    /* adjust the stream */
+    stream->position += bytes_to_read;
+
+    return res;
+}
+
+/* a read is split in a head fragment, a run of whole sectors read in place and a tail fragment */
+int diskstreamer_read( struct disk_stream *stream,
+                       void *out,
+                       int bytes_to_read )
+{
+    int res    = OS_OK;
+    int offset = stream->position % OS_SECTOR_SIZE;
+
+    if( ( offset != 0 ) && ( bytes_to_read > 0 ) )
     {
-        *( char * ) out++ = buffer[ offset + idx ];
+        int total_to_read = OS_SECTOR_SIZE - offset;
+
+        if( total_to_read > bytes_to_read )
+        {
+            total_to_read = bytes_to_read;
+        }
+
+        res = diskstreamer_read_fragment( stream, out, total_to_read );
+
+        if( res < 0 )
+        {
+            return res;
+        }
+
+        out           += total_to_read;
+        bytes_to_read -= total_to_read;
     }
 
-    /* adjust the stream */
-    stream->position += total_to_read;
+    while( bytes_to_read >= OS_SECTOR_SIZE )
+    {
+        int total_sectors = bytes_to_read / OS_SECTOR_SIZE;
+
+        if( total_sectors > OS_DISK_MAX_SECTORS_PER_TRANSFER )
+        {
+            total_sectors = OS_DISK_MAX_SECTORS_PER_TRANSFER;
+        }
+
+        res = disk_read_block( stream->disk, stream->position / OS_SECTOR_SIZE, total_sectors, out );
+
+        if( res < 0 )
+        {
+            return res;
+        }
+
+        stream->position += total_sectors * OS_SECTOR_SIZE;
+        out              += total_sectors * OS_SECTOR_SIZE;
+        bytes_to_read    -= total_sectors * OS_SECTOR_SIZE;
+    }
 
-    if( overflow )
+    if( bytes_to_read > 0 )
     {
-        res = diskstreamer_read( stream, out, bytes_to_read - total_to_read );
+        res = diskstreamer_read_fragment( stream, out, bytes_to_read );
     }
 
     return res;
@@ -0,0 +1,81 @@
+#include "disk_trace.h"
+#include "disk.h"
+#include "config.h"
+#include "status.h"
+#include "memory/memory.h"
+#include "memory/heap/kheap.h"
+
+static struct disk_trace disk_trace;
+
+int disktrace_enable( bool enable )
+{
+    if( enable && !disk_trace.entries )
+    {
+        disk_trace.entries = kzalloc( sizeof( struct disk_trace_entry ) * OS_DISK_TRACE_ENTRIES );
+
+        if( !disk_trace.entries )
+        {
+            return -NO_MEMORY_ERROR;
+        }
+    }
+
+    disk_trace.enabled = enable;
+
+    return OS_OK;
+}
+
+/* the oldest entry makes room when the ring is full */
+void disktrace_record( struct disk *disk,
+                       struct disk_request *request,
+                       uint64_t issued,
+                       uint64_t completed )
+{
+    if( !disk_trace.enabled )
+    {
+        return;
+    }
+
+    struct disk_trace_entry *entry = &disk_trace.entries[ ( disk_trace.head + disk_trace.total ) % OS_DISK_TRACE_ENTRIES ];
+
+    if( disk_trace.total == OS_DISK_TRACE_ENTRIES )
+    {
+        disk_trace.head = ( disk_trace.head + 1 ) % OS_DISK_TRACE_ENTRIES;
+        disk_trace.dropped++;
+    }
+    else
+    {
+        disk_trace.total++;
+    }
+
+    entry->disk          = disk->id;
+    entry->pid           = request->pid;
+    entry->lba           = request->lba;
+    entry->total_sectors = request->total_sectors;
+    entry->write         = request->write;
+    entry->status        = request->status;
+    entry->submitted     = request->submitted;
+    entry->issued        = issued;
+    entry->completed     = completed;
+}
+
+/* move up to max entries out of the ring, oldest first, returns how many */
+int disktrace_read( struct disk_trace_entry *out,
+                    int max )
+{
+    int total = 0;
+
+    while( ( total < max ) && ( disk_trace.total > 0 ) )
+    {
+        memcpy( &out[ total ], &disk_trace.entries[ disk_trace.head ], sizeof( struct disk_trace_entry ) );
+        disk_trace.head = ( disk_trace.head + 1 ) % OS_DISK_TRACE_ENTRIES;
+        disk_trace.total--;
+        total++;
+    }
+
+    return total;
+}
+
+uint32_t disktrace_get_dropped()
+{
+    return disk_trace.dropped;
+}
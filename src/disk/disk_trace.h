@@ -0,0 +1,51 @@
+#ifndef DISK_TRACE_H_
+#define DISK_TRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* requests the kernel issued on its own, cache write back for one */
+#define DISK_TRACE_KERNEL_PID    0xFFFFFFFF
+
+/* one completed request, times in cycles */
+struct disk_trace_entry
+{
+    uint32_t disk;
+    uint32_t pid;
+    uint32_t lba;
+    uint32_t total_sectors;
+    uint32_t write;
+    int32_t status;
+
+    uint64_t submitted;
+    /* sent to the driver, merged requests share it */
+    uint64_t issued;
+    uint64_t completed;
+};
+
+struct disk_trace
+{
+    bool enabled;
+
+    /* ring of OS_DISK_TRACE_ENTRIES, allocated when tracing is first enabled */
+    struct disk_trace_entry *entries;
+    uint32_t head;
+    uint32_t total;
+
+    /* overwritten before anybody read them */
+    uint32_t dropped;
+};
+
+struct disk;
+struct disk_request;
+
+int disktrace_enable( bool enable );
+void disktrace_record( struct disk *disk,
+                       struct disk_request *request,
+                       uint64_t issued,
+                       uint64_t completed );
+int disktrace_read( struct disk_trace_entry *out,
+                    int max );
+uint32_t disktrace_get_dropped();
+
+#endif /* DISK_TRACE_H_ */
@@ -0,0 +1,124 @@
+#include "ramdisk.h"
+#include "config.h"
+#include "status.h"
+#include "fs/file.h"
+#include "memory/memory.h"
+#include "memory/heap/kheap.h"
+
+static struct ramdisk ramdisk;
+
+static int ramdisk_check_range( unsigned int lba,
+                                int total_sectors )
+{
+    /* lba + total_sectors can wrap around, so compare against what is left after lba */
+    if( ( total_sectors < 0 ) || ( lba >= ramdisk.total_sectors ) || ( total_sectors > ramdisk.total_sectors - lba ) )
+    {
+        return -INVALID_ARGUMENT_ERROR;
+    }
+
+    return OS_OK;
+}
+
+static int ramdisk_read( struct disk *disk,
+                         unsigned int lba,
+                         int total_sectors,
+                         void *buffer )
+{
+    int res = ramdisk_check_range( lba, total_sectors );
+
+    if( res < 0 )
+    {
+        return res;
+    }
+
+    memcpy( buffer, ramdisk.memory + ( lba * OS_SECTOR_SIZE ), total_sectors * OS_SECTOR_SIZE );
+
+    return res;
+}
+
+static int ramdisk_write( struct disk *disk,
+                          unsigned int lba,
+                          int total_sectors,
+                          void *buffer )
+{
+    int res = ramdisk_check_range( lba, total_sectors );
+
+    if( res < 0 )
+    {
+        return res;
+    }
+
+    memcpy( ramdisk.memory + ( lba * OS_SECTOR_SIZE ), buffer, total_sectors * OS_SECTOR_SIZE );
+
+    return res;
+}
+
+/* copy the image file into the ramdisk, a missing image leaves it zeroed */
+static int ramdisk_load_image( const char *image )
+{
+    int res = OS_OK;
+    struct file_stat stat;
+
+    int fd = fopen( image, "r" );
+
+    if( !fd )
+    {
+        res = -IO_ERROR;
+        return res;
+    }
+
+    res = fstat( fd, &stat );
+
+    if( ( res == OS_OK ) && ( stat.filesize > ramdisk.total_sectors * OS_SECTOR_SIZE ) )
+    {
+        res = -INVALID_ARGUMENT_ERROR;
+    }
+
+    if( ( res == OS_OK ) && stat.filesize )
+    {
+        res = fread( ramdisk.memory, stat.filesize, 1, fd );
+        res = ( res < 0 ) ? res : OS_OK;
+    }
+
+    fclose( fd );
+
+    return res;
+}
+
+/* a block device in kernel memory, registered as the drive after the boot disk */
+int ramdisk_init( const char *image )
+{
+    int res = OS_OK;
+
+    bzero( &ramdisk, sizeof( ramdisk ) );
+
+    ramdisk.total_sectors = OS_RAMDISK_SIZE_BYTES / OS_SECTOR_SIZE;
+    ramdisk.memory        = kzalloc( OS_RAMDISK_SIZE_BYTES );
+
+    if( !ramdisk.memory )
+    {
+        res = -NO_MEMORY_ERROR;
+        bzero( &ramdisk, sizeof( ramdisk ) );
+        return res;
+    }
+
+    /* without an image the drive is raw scratch space until something formats it */
+    ramdisk_load_image( image );
+
+    ramdisk.disk.type           = OS_DISK_TYPE_RAM;
+    ramdisk.disk.sector_size    = OS_SECTOR_SIZE;
+    ramdisk.disk.read_sectors   = ramdisk_read;
+    ramdisk.disk.write_sectors  = ramdisk_write;
+    ramdisk.disk.driver_private = &ramdisk;
+
+    res = disk_register( &ramdisk.disk );
+
+    if( res < 0 )
+    {
+        kfree( ramdisk.memory );
+        bzero( &ramdisk, sizeof( ramdisk ) );
+        return res;
+    }
+
+    return OS_OK;
+}
@@ -0,0 +1,17 @@
+#ifndef RAMDISK_H_
+#define RAMDISK_H_
+
+#include "disk.h"
+#include <stdint.h>
+
+struct ramdisk
+{
+    uint8_t *memory;
+    uint32_t total_sectors;
+
+    struct disk disk;
+};
+
+int ramdisk_init( const char *image );
+
+#endif /* RAMDISK_H_ */
@@ -0,0 +1,260 @@
+#include "virtio_blk.h"
+#include "config.h"
+#include "status.h"
+#include "io/io.h"
+#include "memory/memory.h"
+#include "memory/heap/kheap.h"
+
+static struct virtio_blk virtio_blk;
+
+static uint32_t virtio_blk_align( uint32_t value )
+{
+    return ( value + VIRTIO_QUEUE_ALIGN - 1 ) & ~( VIRTIO_QUEUE_ALIGN - 1 );
+}
+
+/* descriptor table and available ring, the used ring starts on the next aligned boundary */
+static uint32_t virtio_blk_queue_first_bytes( uint16_t queue_size )
+{
+    return ( sizeof( struct virtq_desc ) * queue_size ) + sizeof( struct virtq_avail ) + ( sizeof( uint16_t ) * ( queue_size + 1 ) );
+}
+
+static uint32_t virtio_blk_queue_bytes( uint16_t queue_size )
+{
+    uint32_t used = sizeof( struct virtq_used ) + ( sizeof( struct virtq_used_element ) * queue_size ) + sizeof( uint16_t );
+
+    return virtio_blk_align( virtio_blk_queue_first_bytes( queue_size ) ) + virtio_blk_align( used );
+}
+
+static int virtio_blk_setup_queue()
+{
+    int res = OS_OK;
+
+    outw( virtio_blk.base + VIRTIO_REGISTER_QUEUE_SELECT, 0 );
+    virtio_blk.queue_size = insw( virtio_blk.base + VIRTIO_REGISTER_QUEUE_SIZE );
+
+    if( virtio_blk.queue_size < VIRTIO_BLK_DESCRIPTORS_PER_REQUEST )
+    {
+        res = -IO_ERROR;
+        return res;
+    }
+
+    virtio_blk.max_requests = virtio_blk.queue_size / VIRTIO_BLK_DESCRIPTORS_PER_REQUEST;
+
+    /* kernel heap blocks are page aligned and contiguous, which is what the device expects */
+    virtio_blk.queue_memory = kzalloc( virtio_blk_queue_bytes( virtio_blk.queue_size ) );
+    virtio_blk.headers      = kzalloc( sizeof( struct virtio_blk_request_header ) * virtio_blk.max_requests );
+    virtio_blk.statuses     = kzalloc( virtio_blk.max_requests );
+
+    if( !virtio_blk.queue_memory || !virtio_blk.headers || !virtio_blk.statuses )
+    {
+        res = -NO_MEMORY_ERROR;
+        kfree( virtio_blk.queue_memory );
+        kfree( virtio_blk.headers );
+        kfree( ( void * ) virtio_blk.statuses );
+        return res;
+    }
+
+    virtio_blk.descriptors     = virtio_blk.queue_memory;
+    virtio_blk.avail           = virtio_blk.queue_memory + ( sizeof( struct virtq_desc ) * virtio_blk.queue_size );
+    virtio_blk.used            = virtio_blk.queue_memory + virtio_blk_align( virtio_blk_queue_first_bytes( virtio_blk.queue_size ) );
+    virtio_blk.last_used_index = 0;
+
+    /* the kernel is identity mapped, the virtual address is the physical one */
+    outl( virtio_blk.base + VIRTIO_REGISTER_QUEUE_ADDRESS, ( uint32_t ) virtio_blk.queue_memory / VIRTIO_QUEUE_ALIGN );
+
+    return res;
+}
+
+/* chain header, data and status of one request into three descriptors, a flush has no data */
+static void virtio_blk_add_request( int request,
+                                    uint32_t type,
+                                    unsigned int lba,
+                                    int total_sectors,
+                                    void *buffer )
+{
+    struct virtio_blk_request_header *header = &virtio_blk.headers[ request ];
+    int first = request * VIRTIO_BLK_DESCRIPTORS_PER_REQUEST;
+    volatile struct virtq_desc *descriptor = &virtio_blk.descriptors[ first ];
+
+    bool write = ( type != VIRTIO_BLK_T_IN );
+
+    header->type     = type;
+    header->reserved = 0;
+    header->sector   = lba;
+    virtio_blk.statuses[ request ] = 0xFF;
+
+    descriptor[ 0 ].address = ( uint32_t ) header;
+    descriptor[ 0 ].length  = sizeof( struct virtio_blk_request_header );
+    descriptor[ 0 ].flags   = VIRTQ_DESC_F_NEXT;
+    descriptor[ 0 ].next    = buffer ? first + 1 : first + 2;
+
+    descriptor[ 1 ].address = ( uint32_t ) buffer;
+    descriptor[ 1 ].length  = total_sectors * OS_SECTOR_SIZE;
+    descriptor[ 1 ].flags   = VIRTQ_DESC_F_NEXT | ( write ? 0x00 : VIRTQ_DESC_F_WRITE );
+    descriptor[ 1 ].next    = first + 2;
+
+    descriptor[ 2 ].address = ( uint32_t ) &virtio_blk.statuses[ request ];
+    descriptor[ 2 ].length  = sizeof( uint8_t );
+    descriptor[ 2 ].flags   = VIRTQ_DESC_F_WRITE;
+    descriptor[ 2 ].next    = 0;
+
+    virtio_blk.avail->ring[ virtio_blk.avail->index % virtio_blk.queue_size ] = first;
+    virtio_blk.avail->index++;
+}
+
+/* poll the used ring until every submitted request came back */
+static void virtio_blk_complete( int total_requests )
+{
+    uint16_t target = virtio_blk.last_used_index + total_requests;
+
+    while( virtio_blk.used->index != target )
+    {
+    }
+
+    virtio_blk.last_used_index = target;
+
+    /* reading the ISR status lowers the interrupt line of the device */
+    insb( virtio_blk.base + VIRTIO_REGISTER_ISR_STATUS );
+}
+
+static void virtio_blk_notify()
+{
+    if( !( virtio_blk.used->flags & VIRTQ_USED_F_NO_NOTIFY ) )
+    {
+        outw( virtio_blk.base + VIRTIO_REGISTER_QUEUE_NOTIFY, 0 );
+    }
+}
+
+/*
+ * queue as many requests as the ring holds and notify the device once for the whole batch,
+ * every notification is a VM exit
+ */
+static int virtio_blk_transfer( unsigned int lba,
+                                int total_sectors,
+                                void *buffer,
+                                bool write )
+{
+    int res = OS_OK;
+
+    while( total_sectors > 0 )
+    {
+        int total_requests = 0;
+
+        while( ( total_requests < virtio_blk.max_requests ) && ( total_sectors > 0 ) )
+        {
+            int sectors = ( total_sectors > OS_VIRTIO_BLK_MAX_SECTORS_PER_REQUEST ) ? OS_VIRTIO_BLK_MAX_SECTORS_PER_REQUEST : total_sectors;
+
+            virtio_blk_add_request( total_requests, write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN, lba, sectors, buffer );
+
+            lba           += sectors;
+            buffer        += sectors * OS_SECTOR_SIZE;
+            total_sectors -= sectors;
+            total_requests++;
+        }
+
+        virtio_blk_notify();
+        virtio_blk_complete( total_requests );
+
+        for( int request = 0; request < total_requests; request++ )
+        {
+            if( virtio_blk.statuses[ request ] != VIRTIO_BLK_S_OK )
+            {
+                res = -IO_ERROR;
+                return res;
+            }
+        }
+    }
+
+    return res;
+}
+
+static int virtio_blk_read( struct disk *disk,
+                            unsigned int lba,
+                            int total_sectors,
+                            void *buffer )
+{
+    if( lba + total_sectors > virtio_blk.capacity )
+    {
+        return -INVALID_ARGUMENT_ERROR;
+    }
+
+    return virtio_blk_transfer( lba, total_sectors, buffer, false );
+}
+
+static int virtio_blk_write( struct disk *disk,
+                             unsigned int lba,
+                             int total_sectors,
+                             void *buffer )
+{
+    if( lba + total_sectors > virtio_blk.capacity )
+    {
+        return -INVALID_ARGUMENT_ERROR;
+    }
+
+    return virtio_blk_transfer( lba, total_sectors, buffer, true );
+}
+
+static int virtio_blk_flush( struct disk *disk )
+{
+    if( !virtio_blk.flush )
+    {
+        return OS_OK;
+    }
+
+    virtio_blk_add_request( 0, VIRTIO_BLK_T_FLUSH, 0, 0, 0 );
+    virtio_blk_notify();
+    virtio_blk_complete( 1 );
+
+    return ( virtio_blk.statuses[ 0 ] == VIRTIO_BLK_S_OK ) ? OS_OK : -IO_ERROR;
+}
+
+/* find a virtio block device and register it as the next drive */
+int virtio_blk_init()
+{
+    int res = OS_OK;
+
+    bzero( &virtio_blk, sizeof( virtio_blk ) );
+
+    res = pci_find_device( VIRTIO_PCI_VENDOR_ID, VIRTIO_PCI_DEVICE_BLOCK_LEGACY, &virtio_blk.device );
+
+    if( res < 0 )
+    {
+        return res;
+    }
+
+    virtio_blk.base = pci_get_bar( &virtio_blk.device, 0 );
+    pci_enable_bus_master( &virtio_blk.device );
+
+    /* reset, then tell the device we found it and know how to drive it */
+    outb( virtio_blk.base + VIRTIO_REGISTER_DEVICE_STATUS, 0x00 );
+    outb( virtio_blk.base + VIRTIO_REGISTER_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE );
+    outb( virtio_blk.base + VIRTIO_REGISTER_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER );
+
+    /* flush is the only optional feature used */
+    virtio_blk.flush = insl( virtio_blk.base + VIRTIO_REGISTER_DEVICE_FEATURES ) & VIRTIO_BLK_F_FLUSH;
+    outl( virtio_blk.base + VIRTIO_REGISTER_GUEST_FEATURES, virtio_blk.flush ? VIRTIO_BLK_F_FLUSH : 0x00 );
+
+    virtio_blk.capacity = insl( virtio_blk.base + VIRTIO_REGISTER_BLOCK_CAPACITY ) | ( ( uint64_t ) insl( virtio_blk.base + VIRTIO_REGISTER_BLOCK_CAPACITY + 4 ) << 32 );
+
+    res = virtio_blk_setup_queue();
+
+    if( res < 0 )
+    {
+        outb( virtio_blk.base + VIRTIO_REGISTER_DEVICE_STATUS, VIRTIO_STATUS_FAILED );
+        bzero( &virtio_blk, sizeof( virtio_blk ) );
+        return res;
+    }
+
+    outb( virtio_blk.base + VIRTIO_REGISTER_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_DRIVER_OK );
+
+    virtio_blk.disk.type           = OS_DISK_TYPE_VIRTIO;
+    virtio_blk.disk.sector_size    = OS_SECTOR_SIZE;
+    virtio_blk.disk.read_sectors   = virtio_blk_read;
+    virtio_blk.disk.write_sectors  = virtio_blk_write;
+    virtio_blk.disk.flush_cache    = virtio_blk_flush;
+    virtio_blk.disk.driver_private = &virtio_blk;
+
+    res = disk_register( &virtio_blk.disk );
+
+    return ( res < 0 ) ? res : OS_OK;
+}
@@ -0,0 +1,115 @@
+#ifndef VIRTIO_BLK_H_
+#define VIRTIO_BLK_H_
+
+#include "disk.h"
+#include "pci/pci.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#define VIRTIO_PCI_VENDOR_ID                 0x1AF4
+/* transitional block device, it still offers the legacy I/O port interface */
+#define VIRTIO_PCI_DEVICE_BLOCK_LEGACY       0x1001
+
+/* legacy register layout in the I/O space of BAR0 */
+#define VIRTIO_REGISTER_DEVICE_FEATURES      0x00
+#define VIRTIO_REGISTER_GUEST_FEATURES       0x04
+#define VIRTIO_REGISTER_QUEUE_ADDRESS        0x08
+#define VIRTIO_REGISTER_QUEUE_SIZE           0x0C
+#define VIRTIO_REGISTER_QUEUE_SELECT         0x0E
+#define VIRTIO_REGISTER_QUEUE_NOTIFY         0x10
+#define VIRTIO_REGISTER_DEVICE_STATUS        0x12
+#define VIRTIO_REGISTER_ISR_STATUS           0x13
+/* the block device configuration starts with the capacity in sectors */
+#define VIRTIO_REGISTER_BLOCK_CAPACITY       0x14
+
+#define VIRTIO_STATUS_ACKNOWLEDGE            0x01
+#define VIRTIO_STATUS_DRIVER                 0x02
+#define VIRTIO_STATUS_DRIVER_OK              0x04
+#define VIRTIO_STATUS_FAILED                 0x80
+
+/* the legacy interface takes the queue address as a page frame number */
+#define VIRTIO_QUEUE_ALIGN                   4096
+
+#define VIRTQ_DESC_F_NEXT                    0x01
+/* the device writes into the buffer */
+#define VIRTQ_DESC_F_WRITE                   0x02
+/* the device asks not to be notified about new buffers */
+#define VIRTQ_USED_F_NO_NOTIFY               0x01
+
+#define VIRTIO_BLK_T_IN                      0
+#define VIRTIO_BLK_T_OUT                     1
+#define VIRTIO_BLK_T_FLUSH                   4
+/* the device has a volatile write cache and takes flush requests */
+#define VIRTIO_BLK_F_FLUSH                   ( 1 << 9 )
+#define VIRTIO_BLK_S_OK                      0
+
+/* header, data and status */
+#define VIRTIO_BLK_DESCRIPTORS_PER_REQUEST   3
+
+struct virtq_desc
+{
+    uint64_t address;
+    uint32_t length;
+    uint16_t flags;
+    uint16_t next;
+}
+__attribute__( ( packed ) );
+
+struct virtq_avail
+{
+    uint16_t flags;
+    uint16_t index;
+    uint16_t ring[];
+}
+__attribute__( ( packed ) );
+
+struct virtq_used_element
+{
+    uint32_t id;
+    uint32_t length;
+}
+__attribute__( ( packed ) );
+
+struct virtq_used
+{
+    uint16_t flags;
+    uint16_t index;
+    struct virtq_used_element ring[];
+}
+__attribute__( ( packed ) );
+
+struct virtio_blk_request_header
+{
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t sector;
+}
+__attribute__( ( packed ) );
+
+struct virtio_blk
+{
+    struct pci_device device;
+    uint16_t base;
+
+    /* the whole queue in one physically contiguous allocation */
+    void *queue_memory;
+    uint16_t queue_size;
+    volatile struct virtq_desc *descriptors;
+    volatile struct virtq_avail *avail;
+    volatile struct virtq_used *used;
+    uint16_t last_used_index;
+
+    /* one header and status byte per request that fits in the queue */
+    struct virtio_blk_request_header *headers;
+    volatile uint8_t *statuses;
+    int max_requests;
+
+    uint64_t capacity;
+    bool flush;
+
+    struct disk disk;
+};
+
+int virtio_blk_init();
+
+#endif /* VIRTIO_BLK_H_ */
@@ -4,15 +4,21 @@
 #include "memory/memory.h"
 #include "kernel.h"
 #include "config.h"
+#include "memory/paging/paging.h"
+#include "memory/page_cache/page_cache.h"
 
 struct filesystem fat16_fs =
 {
-    .resolve = fat16_resolve,
-    .open    = fat16_open,
-    .read    = fat16_read,
-    .seek    = fat16_seek,
-    .stat    = fat16_stat,
-    .close   = fat16_close
+    .resolve  = fat16_resolve,
+    .open     = fat16_open,
+    .read     = fat16_read,
+    .seek     = fat16_seek,
+    .stat     = fat16_stat,
+    .close    = fat16_close,
+    .bmap     = fat16_bmap,
+    .write    = fat16_write,
+    .truncate = fat16_truncate,
+    .allocate = fat16_allocate
 };
 
 struct filesystem *fat16_init()
@@ -28,6 +34,11 @@ static void fat16_init_private( struct disk *disk,
     private->cluster_read_stream = diskstreamer_new( disk->id );
     private->fat_read_stream     = diskstreamer_new( disk->id );
     private->directory_stream    = diskstreamer_new( disk->id );
+
+    for( int idx = 0; idx < OS_FAT16_DENTRY_BUCKETS; idx++ )
+    {
+        private->dentry_cache.buckets[ idx ] = -1;
+    }
 }
 
 int fat16_sector_to_absolute( struct disk *disk,
@@ -71,12 +82,7 @@ int fat16_get_total_items_for_directory( struct disk *disk,
             break;
         }
 
-        /* is item is unused */
-        if( item.filename[ 0 ] == OS_DIRECTORY_ENTRY_IS_FREE )
-        {
-            continue;
-        }
-
+        /* free slots are counted too, the entries behind them must be loaded as well */
         idx++;
     }
 
@@ -104,6 +110,12 @@ int fat16_get_root_directory( struct disk *disk,
 
     int total_items = fat16_get_total_items_for_directory( disk, root_dir_sector_pos );
 
+    /* a full root directory has no end marker */
+    if( total_items > root_dir_entires )
+    {
+        total_items = root_dir_entires;
+    }
+
     dir = kzalloc( root_dir_size );
 
     if( !dir )
@@ -152,6 +164,107 @@ int fat16_get_root_directory( struct disk *disk,
     return res;
 }
 
+static uint32_t fat16_get_first_fat_sector( struct fat_private *private )
+{
+    return private->header.primary_header.reserved_sectors;
+}
+
+static void fat16_free_fat( struct fat_private *private )
+{
+    kfree( private->fat_table );
+    kfree( private->fat_dirty );
+    private->fat_table         = 0;
+    private->fat_dirty         = 0;
+    private->fat_total_entries = 0;
+}
+
+/* the first FAT is at most 128KB, one pass over it replaces a sector read per chain hop */
+static int fat16_load_fat( struct disk *disk,
+                           struct fat_private *private )
+{
+    int res = OS_OK;
+    uint32_t first_sector    = fat16_get_first_fat_sector( private );
+    uint32_t sectors_per_fat = private->header.primary_header.sectors_per_fat;
+
+    private->fat_table = kzalloc( sectors_per_fat * disk->sector_size );
+    private->fat_dirty = kzalloc( ( sectors_per_fat + 7 ) / 8 );
+
+    if( !private->fat_table || !private->fat_dirty )
+    {
+        /* not fatal, the entries are streamed from the disk instead */
+        fat16_free_fat( private );
+        return res;
+    }
+
+    for( uint32_t sector = 0; sector < sectors_per_fat; sector += OS_FAT16_FAT_LOAD_SECTORS )
+    {
+        uint32_t total = sectors_per_fat - sector;
+
+        if( total > OS_FAT16_FAT_LOAD_SECTORS )
+        {
+            total = OS_FAT16_FAT_LOAD_SECTORS;
+        }
+
+        res = disk_read_block( disk, first_sector + sector, total, ( uint8_t * ) private->fat_table + ( sector * disk->sector_size ) );
+
+        if( res < 0 )
+        {
+            fat16_free_fat( private );
+            return res;
+        }
+    }
+
+    private->fat_total_entries = ( sectors_per_fat * disk->sector_size ) / OS_FAT16_FAT_ENTRY_SIZE;
+
+    return res;
+}
+
+/* every free cluster in a bitmap, without the FAT in memory the disk stays read only */
+static int fat16_init_allocator( struct disk *disk,
+                                 struct fat_private *private )
+{
+    int res = OS_OK;
+    struct fat_header *header = &private->header.primary_header;
+    uint32_t total_sectors    = header->number_of_sectors ? header->number_of_sectors : header->sectors_big;
+
+    if( !private->fat_table || ( total_sectors <= private->root_directory.ending_sector_pos ) )
+    {
+        return res;
+    }
+
+    private->total_clusters = ( ( total_sectors - private->root_directory.ending_sector_pos ) / header->sectors_per_cluster ) + 2;
+
+    if( private->total_clusters > private->fat_total_entries )
+    {
+        private->total_clusters = private->fat_total_entries;
+    }
+
+    if( private->total_clusters > OS_FAT16_RESERVED )
+    {
+        private->total_clusters = OS_FAT16_RESERVED;
+    }
+
+    private->free_bitmap = kzalloc( ( private->total_clusters + 7 ) / 8 );
+
+    if( !private->free_bitmap )
+    {
+        return res;
+    }
+
+    for( uint32_t cluster = 2; cluster < private->total_clusters; cluster++ )
+    {
+        if( private->fat_table[ cluster ] == OS_FAT16_UNUSED )
+        {
+            private->free_bitmap[ cluster / 8 ] |= 1 << ( cluster % 8 );
+            private->free_clusters++;
+        }
+    }
+
+    private->next_free = 2;
+
+    return res;
+}
+
 int fat16_resolve( struct disk *disk )
 {
     int res = OS_OK;
@@ -236,6 +349,24 @@ int fat16_resolve( struct disk *disk )
         return res;
     }
 
+    if( ( fat16_load_fat( disk, fat_private ) != OS_OK ) || ( fat16_init_allocator( disk, fat_private ) != OS_OK ) )
+    {
+        res = -IO_ERROR;
+
+        if( stream )
+        {
+            diskstreamer_close( stream );
+        }
+
+        if( res < 0 )
+        {
+            kfree( fat_private );
+            disk->fs_private = 0;
+        }
+
+        return res;
+    }
+
     if( stream )
     {
         diskstreamer_close( stream );
@@ -323,11 +454,6 @@ static int fat16_cluster_to_sector( struct fat_private *private,
     return private->root_directory.ending_sector_pos + ( ( cluster - 2 ) *private->header.primary_header.sectors_per_cluster );
 }
 
-static uint32_t fat16_get_first_fat_sector( struct fat_private *private )
-{
-    return private->header.primary_header.reserved_sectors;
-}
-
 static int fat16_get_fat_entry( struct disk *disk,
                                 int cluster )
 {
@@ -335,6 +461,18 @@ static int fat16_get_fat_entry( struct disk *disk,
     struct fat_private *private = disk->fs_private;
     struct disk_stream *stream = private->fat_read_stream;
 
+    if( private->fat_table )
+    {
+        if( ( cluster < 0 ) || ( cluster >= private->fat_total_entries ) )
+        {
+            res = -IO_ERROR;
+            return res;
+        }
+
+        res = private->fat_table[ cluster ];
+        return res;
+    }
+
     if( !stream )
     {
         return res;
@@ -342,7 +480,7 @@ static int fat16_get_fat_entry( struct disk *disk,
 
     uint32_t fat_table_position = fat16_get_first_fat_sector( private ) * disk->sector_size;
 
-    res = diskstreamer_seek( stream, fat_table_position * ( cluster * OS_FAT16_FAT_ENTRY_SIZE ) );
+    res = diskstreamer_seek( stream, fat_table_position + ( cluster * OS_FAT16_FAT_ENTRY_SIZE ) );
 
     if( res < 0 )
     {
@@ -363,6 +501,65 @@ static int fat16_get_fat_entry( struct disk *disk,
     return res;
 }
 
+/* changes the table in memory only, fat16_sync_fat() writes it out */
+static int fat16_set_fat_entry( struct disk *disk,
+                                int cluster,
+                                uint16_t value )
+{
+    int res = OS_OK;
+    struct fat_private *private = disk->fs_private;
+
+    if( !private->fat_table || ( cluster < 0 ) || ( cluster >= private->fat_total_entries ) )
+    {
+        res = -IO_ERROR;
+        return res;
+    }
+
+    uint32_t sector = ( cluster * OS_FAT16_FAT_ENTRY_SIZE ) / disk->sector_size;
+
+    private->fat_table[ cluster ]    = value;
+    private->fat_dirty[ sector / 8 ] |= 1 << ( sector % 8 );
+
+    return res;
+}
+
+/* write the changed FAT sectors to every copy of the table */
+static int fat16_sync_fat( struct disk *disk )
+{
+    int res = OS_OK;
+    struct fat_private *private = disk->fs_private;
+    struct fat_header *header   = &private->header.primary_header;
+
+    if( !private->fat_table )
+    {
+        return res;
+    }
+
+    for( uint32_t sector = 0; sector < header->sectors_per_fat; sector++ )
+    {
+        if( !( private->fat_dirty[ sector / 8 ] & ( 1 << ( sector % 8 ) ) ) )
+        {
+            continue;
+        }
+
+        void *data = ( uint8_t * ) private->fat_table + ( sector * disk->sector_size );
+
+        for( int copy = 0; copy < header->fat_copies; copy++ )
+        {
+            res = disk_write_block( disk, fat16_get_first_fat_sector( private ) + ( copy * header->sectors_per_fat ) + sector, 1, data );
+
+            if( res < 0 )
+            {
+                return res;
+            }
+        }
+
+        private->fat_dirty[ sector / 8 ] &= ~( 1 << ( sector % 8 ) );
+    }
+
+    return res;
+}
+
 /* get the correct cluster to use based on the starting cluster and the offset */
 static int fat16_get_cluster_for_offset( struct disk *disk,
                                          int starting_cluster,
@@ -378,7 +575,13 @@ static int fat16_get_cluster_for_offset( struct disk *disk,
     {
         int entry = fat16_get_fat_entry( disk, cluster_to_use );
 
-        if( ( entry == 0xFF8 ) || ( entry == 0xFFF ) )
+        if( entry < 0 )
+        {
+            res = entry;
+            return res;
+        }
+
+        if( entry >= OS_FAT16_END_OF_CHAIN )
         {
             /* we are at the last entry in the file */
             res = -IO_ERROR;
@@ -393,13 +596,13 @@ static int fat16_get_cluster_for_offset( struct disk *disk,
         }
 
         /* reserved sectors? */
-        if( ( entry == 0xFF0 ) || ( entry == 0xFF6 ) )
+        if( entry >= OS_FAT16_RESERVED )
         {
             res = -IO_ERROR;
             return res;
         }
 
-        if( entry == 0x00 )
+        if( entry == OS_FAT16_UNUSED )
         {
             res = -IO_ERROR;
             return res;
@@ -413,6 +616,206 @@ static int fat16_get_cluster_for_offset( struct disk *disk,
     return res;
 }
 
+static bool fat16_cluster_is_free( struct fat_private *private,
+                                   uint32_t cluster )
+{
+    return ( cluster >= 2 ) && ( cluster < private->total_clusters ) && ( private->free_bitmap[ cluster / 8 ] & ( 1 << ( cluster % 8 ) ) );
+}
+
+static void fat16_mark_cluster( struct fat_private *private,
+                                uint32_t cluster,
+                                bool free )
+{
+    if( free )
+    {
+        private->free_bitmap[ cluster / 8 ] |= 1 << ( cluster % 8 );
+        private->free_clusters++;
+    }
+    else
+    {
+        private->free_bitmap[ cluster / 8 ] &= ~( 1 << ( cluster % 8 ) );
+        private->free_clusters--;
+    }
+}
+
+/* the first run of total free clusters between first and last */
+static int fat16_find_free_run_between( struct fat_private *private,
+                                        uint32_t first,
+                                        uint32_t last,
+                                        uint32_t total )
+{
+    uint32_t run = 0;
+
+    for( uint32_t cluster = first; cluster < last; cluster++ )
+    {
+        run = fat16_cluster_is_free( private, cluster ) ? run + 1 : 0;
+
+        if( run == total )
+        {
+            return cluster - total + 1;
+        }
+    }
+
+    return -NO_MEMORY_ERROR;
+}
+
+/* next fit, searches on from the last allocation and wraps around once */
+static int fat16_find_free_run( struct fat_private *private,
+                                uint32_t total )
+{
+    int res = fat16_find_free_run_between( private, private->next_free, private->total_clusters, total );
+
+    if( res < 0 )
+    {
+        res = fat16_find_free_run_between( private, 2, private->next_free + total - 1, total );
+    }
+
+    return res;
+}
+
+/*
+ * append total clusters to a chain, zero last starts a new one and first gets its first cluster,
+ * the clusters follow the last one on the disk when they are free and form one run when they can
+ */
+static int fat16_extend_chain( struct disk *disk,
+                               uint32_t last,
+                               uint32_t total,
+                               uint32_t *first )
+{
+    int res = OS_OK;
+    struct fat_private *private = disk->fs_private;
+
+    if( total > private->free_clusters )
+    {
+        res = -NO_MEMORY_ERROR;
+        return res;
+    }
+
+    while( total > 0 )
+    {
+        int start = 0;
+        uint32_t run = 0;
+
+        if( last && fat16_cluster_is_free( private, last + 1 ) )
+        {
+            start = last + 1;
+
+            while( ( run < total ) && fat16_cluster_is_free( private, start + run ) )
+            {
+                run++;
+            }
+        }
+        else
+        {
+            /* a fragmented disk hands out whatever is free, one cluster at a time */
+            run   = total;
+            start = fat16_find_free_run( private, run );
+
+            if( start < 0 )
+            {
+                run   = 1;
+                start = fat16_find_free_run( private, run );
+            }
+
+            if( start < 0 )
+            {
+                res = start;
+                return res;
+            }
+        }
+
+        for( uint32_t cluster = start; cluster < start + run; cluster++ )
+        {
+            fat16_mark_cluster( private, cluster, false );
+            fat16_set_fat_entry( disk, cluster, ( cluster + 1 < start + run ) ? cluster + 1 : OS_FAT16_END_OF_FILE );
+        }
+
+        if( last )
+        {
+            fat16_set_fat_entry( disk, last, start );
+        }
+        else
+        {
+            *first = start;
+        }
+
+        last   = start + run - 1;
+        total -= run;
+        private->next_free = ( last + 1 < private->total_clusters ) ? last + 1 : 2;
+    }
+
+    return res;
+}
+
+/* give the clusters from cluster to the end of the chain back */
+static void fat16_free_chain( struct disk *disk,
+                              uint32_t cluster )
+{
+    struct fat_private *private = disk->fs_private;
+
+    while( ( cluster >= 2 ) && ( cluster < private->total_clusters ) )
+    {
+        int next = fat16_get_fat_entry( disk, cluster );
+
+        fat16_set_fat_entry( disk, cluster, OS_FAT16_UNUSED );
+
+        if( !fat16_cluster_is_free( private, cluster ) )
+        {
+            fat16_mark_cluster( private, cluster, true );
+        }
+
+        if( next < 0 )
+        {
+            break;
+        }
+
+        cluster = next;
+    }
+}
+
+/* where the directory entry in the slot of the directory starting at cluster, zero for the root, sits on the disk */
+static int fat16_directory_entry_position( struct disk *disk,
+                                           uint32_t cluster,
+                                           int slot )
+{
+    struct fat_private *private = disk->fs_private;
+    int size_of_cluster_bytes   = private->header.primary_header.sectors_per_cluster * disk->sector_size;
+    int offset = slot * sizeof( struct fat_directory_item );
+
+    if( cluster == 0 )
+    {
+        return fat16_sector_to_absolute( disk, private->root_directory.sector_pos ) + offset;
+    }
+
+    int data_cluster = fat16_get_cluster_for_offset( disk, cluster, offset );
+
+    if( data_cluster < 0 )
+    {
+        return data_cluster;
+    }
+
+    return fat16_sector_to_absolute( disk, fat16_cluster_to_sector( private, data_cluster ) ) + ( offset % size_of_cluster_bytes );
+}
+
+/* read, patch and write back the sector holding the bytes */
+static int fat16_write_partial( struct disk *disk,
+                                uint32_t position,
+                                void *in,
+                                uint32_t total )
+{
+    char sector[ OS_SECTOR_SIZE ];
+    int res = disk_read_block( disk, position / disk->sector_size, 1, sector );
+
+    if( res < 0 )
+    {
+        return res;
+    }
+
+    memcpy( sector + ( position % disk->sector_size ), in, total );
+
+    return disk_write_block( disk, position / disk->sector_size, 1, sector );
+}
+
 static int fat16_read_internal_from_stream( struct disk *disk,
                                             struct disk_stream *stream,
                                             int cluster,
@@ -454,8 +857,8 @@ static int fat16_read_internal_from_stream( struct disk *disk,
 
     if( total_bytes_to_read > 0 )
     {
-        /* we still have to read */
-        res = fat16_read_internal_from_stream( disk, stream, cluster, offset + total_to_read, total_bytes_to_read, out + total_to_read );
+        /* we still have to read, carry on from this cluster instead of the start of the chain */
+        res = fat16_read_internal_from_stream( disk, stream, cluster_to_use, offset_from_cluster + total_to_read, total_bytes_to_read, out + total_to_read );
     }
 
     return res;
@@ -473,20 +876,413 @@ static int fat16_read_internal( struct disk *disk,
     return fat16_read_internal_from_stream( disk, stream, starting_cluster, offset, total, out );
 }
 
-void fat16_free_directory( struct fat_directory *directory )
+/* walk the chain once, count the runs of consecutive clusters and store them when extents is set */
+static int fat16_walk_extents( struct disk *disk,
+                               int cluster,
+                               struct fat_extent *extents )
 {
-    if( !directory )
-    {
-        return;
-    }
+    int res = OS_OK;
+    int total    = 0;
+    int previous = -1;
+    uint32_t index = 0;
 
-    if( directory->item )
+    while( cluster < OS_FAT16_END_OF_CHAIN )
     {
-        kfree( directory->item );
-    }
+        /* free, bad or reserved clusters and cycles mean a broken chain */
+        if( ( cluster < 2 ) || ( cluster >= OS_FAT16_RESERVED ) || ( index >= OS_FAT16_RESERVED ) )
+        {
+            res = -IO_ERROR;
+            return res;
+        }
 
-    kfree( directory );
-}
+        if( cluster != previous + 1 )
+        {
+            if( extents )
+            {
+                extents[ total ].file_cluster   = index;
+                extents[ total ].cluster        = cluster;
+                extents[ total ].total_clusters = 0;
+            }
+
+            total++;
+        }
+
+        if( extents )
+        {
+            extents[ total - 1 ].total_clusters++;
+        }
+
+        previous = cluster;
+        index++;
+        cluster = fat16_get_fat_entry( disk, cluster );
+
+        if( cluster < 0 )
+        {
+            res = cluster;
+            return res;
+        }
+    }
+
+    res = total;
+
+    return res;
+}
+
+static int fat16_build_extents( struct disk *disk,
+                                struct fat_file_descriptor *desc )
+{
+    int res = OS_OK;
+    int first_cluster = fat16_get_first_cluster( desc->item->item );
+
+    if( desc->item->extents || ( first_cluster == 0 ) )
+    {
+        return res;
+    }
+
+    res = fat16_walk_extents( disk, first_cluster, 0 );
+
+    if( res <= 0 )
+    {
+        return res;
+    }
+
+    desc->item->extents = kzalloc( sizeof( struct fat_extent ) * res );
+
+    if( !desc->item->extents )
+    {
+        res = -NO_MEMORY_ERROR;
+        return res;
+    }
+
+    desc->item->total_extents = res;
+    res = fat16_walk_extents( disk, first_cluster, desc->item->extents );
+
+    return ( res < 0 ) ? res : OS_OK;
+}
+
+/* binary search for the run holding the cluster with the given index in the file */
+static struct fat_extent *fat16_find_extent( struct fat_file_descriptor *desc,
+                                             uint32_t file_cluster )
+{
+    int low  = 0;
+    int high = ( int ) desc->item->total_extents - 1;
+
+    while( low <= high )
+    {
+        int middle = ( low + high ) / 2;
+        struct fat_extent *extent = &desc->item->extents[ middle ];
+
+        if( file_cluster < extent->file_cluster )
+        {
+            high = middle - 1;
+        }
+        else if( file_cluster >= extent->file_cluster + extent->total_clusters )
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            return extent;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * file data through the extent map, the whole sectors of every run of consecutive clusters
+ * are read straight into the caller buffer with one vectored read, only partial sectors are copied
+ */
+static int fat16_read_extents( struct disk *disk,
+                               struct fat_file_descriptor *desc,
+                               uint32_t offset,
+                               uint32_t total,
+                               void *out )
+{
+    int res = fat16_build_extents( disk, desc );
+    struct fat_private *private = disk->fs_private;
+    struct disk_stream *stream  = private->cluster_read_stream;
+    uint32_t size_of_cluster_bytes = private->header.primary_header.sectors_per_cluster * disk->sector_size;
+    struct disk_io_vector vector[ OS_FAT16_READ_VECTOR ];
+    int total_vector = 0;
+
+    while( ( total > 0 ) && ( res >= 0 ) )
+    {
+        struct fat_extent *extent = fat16_find_extent( desc, offset / size_of_cluster_bytes );
+
+        if( !extent )
+        {
+            res = -IO_ERROR;
+            break;
+        }
+
+        uint32_t offset_in_extent = offset - ( extent->file_cluster * size_of_cluster_bytes );
+        uint32_t chunk = ( extent->total_clusters * size_of_cluster_bytes ) - offset_in_extent;
+
+        if( chunk > total )
+        {
+            chunk = total;
+        }
+
+        uint32_t position = fat16_sector_to_absolute( disk, fat16_cluster_to_sector( private, extent->cluster ) ) + offset_in_extent;
+        uint32_t head     = ( disk->sector_size - ( position % disk->sector_size ) ) % disk->sector_size;
+
+        if( head > chunk )
+        {
+            head = chunk;
+        }
+
+        uint32_t sectors = ( chunk - head ) / disk->sector_size;
+        uint32_t tail    = chunk - head - ( sectors * disk->sector_size );
+
+        if( head > 0 )
+        {
+            res = diskstreamer_seek( stream, position );
+
+            if( res >= 0 )
+            {
+                res = diskstreamer_read( stream, out, head );
+            }
+        }
+
+        if( ( sectors > 0 ) && ( res >= 0 ) )
+        {
+            vector[ total_vector ].lba           = ( position + head ) / disk->sector_size;
+            vector[ total_vector ].total_sectors = sectors;
+            vector[ total_vector ].buffer        = out + head;
+            total_vector++;
+
+            if( total_vector == OS_FAT16_READ_VECTOR )
+            {
+                res = disk_read_vector( disk, vector, total_vector );
+                total_vector = 0;
+            }
+        }
+
+        if( ( tail > 0 ) && ( res >= 0 ) )
+        {
+            res = diskstreamer_seek( stream, position + chunk - tail );
+
+            if( res >= 0 )
+            {
+                res = diskstreamer_read( stream, out + chunk - tail, tail );
+            }
+        }
+
+        offset += chunk;
+        out    += chunk;
+        total  -= chunk;
+    }
+
+    if( ( total_vector > 0 ) && ( res >= 0 ) )
+    {
+        res = disk_read_vector( disk, vector, total_vector );
+    }
+
+    return res;
+}
+
+/* make the chain of the file long enough to hold length bytes, an empty file gets its first cluster */
+static int fat16_extend_file( struct disk *disk,
+                              struct fat_item *f_item,
+                              uint32_t length )
+{
+    int res = OS_OK;
+    struct fat_private *private    = disk->fs_private;
+    struct fat_directory_item *item = f_item->item;
+    uint32_t size_of_cluster_bytes = private->header.primary_header.sectors_per_cluster * disk->sector_size;
+    uint32_t needed = ( length + size_of_cluster_bytes - 1 ) / size_of_cluster_bytes;
+    uint32_t have   = 0;
+    uint32_t last   = 0;
+    uint32_t first  = 0;
+
+    if( f_item->total_extents > 0 )
+    {
+        struct fat_extent *extent = &f_item->extents[ f_item->total_extents - 1 ];
+
+        have = extent->file_cluster + extent->total_clusters;
+        last = extent->cluster + extent->total_clusters - 1;
+    }
+
+    if( needed <= have )
+    {
+        return res;
+    }
+
+    res = fat16_extend_chain( disk, last, needed - have, &first );
+
+    if( !last && first )
+    {
+        item->high_16_bits_first_cluster = 0;
+        item->low_16_bits_first_cluster  = first;
+    }
+
+    /* rebuilt on the next access, the new runs may have merged with the last one */
+    kfree( f_item->extents );
+    f_item->extents       = 0;
+    f_item->total_extents = 0;
+
+    return res;
+}
+
+/* cut the chain of the file after the clusters needed for length bytes */
+static int fat16_shrink_file( struct disk *disk,
+                              struct fat_item *f_item,
+                              uint32_t length )
+{
+    int res = OS_OK;
+    struct fat_private *private    = disk->fs_private;
+    struct fat_directory_item *item = f_item->item;
+    uint32_t size_of_cluster_bytes = private->header.primary_header.sectors_per_cluster * disk->sector_size;
+    uint32_t keep  = ( length + size_of_cluster_bytes - 1 ) / size_of_cluster_bytes;
+    uint32_t first = fat16_get_first_cluster( item );
+
+    if( first == 0 )
+    {
+        return res;
+    }
+
+    if( keep == 0 )
+    {
+        fat16_free_chain( disk, first );
+        item->high_16_bits_first_cluster = 0;
+        item->low_16_bits_first_cluster  = 0;
+    }
+    else
+    {
+        struct fat_extent *extent = 0;
+
+        for( uint32_t idx = 0; idx < f_item->total_extents; idx++ )
+        {
+            if( ( keep - 1 >= f_item->extents[ idx ].file_cluster ) && ( keep - 1 < f_item->extents[ idx ].file_cluster + f_item->extents[ idx ].total_clusters ) )
+            {
+                extent = &f_item->extents[ idx ];
+                break;
+            }
+        }
+
+        /* a shorter chain needs no cut */
+        if( extent )
+        {
+            uint32_t last = extent->cluster + ( ( keep - 1 ) - extent->file_cluster );
+            int next      = fat16_get_fat_entry( disk, last );
+
+            if( next < 0 )
+            {
+                res = next;
+                return res;
+            }
+
+            fat16_set_fat_entry( disk, last, OS_FAT16_END_OF_FILE );
+            fat16_free_chain( disk, next );
+        }
+    }
+
+    /* cached pages past the cut, or of a chain that is gone, must not be found again */
+    pagecache_invalidate( disk->id, first );
+
+    kfree( f_item->extents );
+    f_item->extents       = 0;
+    f_item->total_extents = 0;
+
+    return res;
+}
+
+/* the mirror of fat16_read_extents, partial sectors are read, patched and written back */
+static int fat16_write_extents( struct disk *disk,
+                                struct fat_file_descriptor *desc,
+                                uint32_t offset,
+                                uint32_t total,
+                                char *in )
+{
+    int res = fat16_build_extents( disk, desc );
+    struct fat_private *private = disk->fs_private;
+    uint32_t size_of_cluster_bytes = private->header.primary_header.sectors_per_cluster * disk->sector_size;
+
+    while( ( total > 0 ) && ( res >= 0 ) )
+    {
+        struct fat_extent *extent = fat16_find_extent( desc, offset / size_of_cluster_bytes );
+
+        if( !extent )
+        {
+            res = -IO_ERROR;
+            break;
+        }
+
+        uint32_t offset_in_extent = offset - ( extent->file_cluster * size_of_cluster_bytes );
+        uint32_t chunk = ( extent->total_clusters * size_of_cluster_bytes ) - offset_in_extent;
+
+        if( chunk > total )
+        {
+            chunk = total;
+        }
+
+        uint32_t position = fat16_sector_to_absolute( disk, fat16_cluster_to_sector( private, extent->cluster ) ) + offset_in_extent;
+        uint32_t head     = ( disk->sector_size - ( position % disk->sector_size ) ) % disk->sector_size;
+
+        if( head > chunk )
+        {
+            head = chunk;
+        }
+
+        uint32_t sectors = ( chunk - head ) / disk->sector_size;
+        uint32_t tail    = chunk - head - ( sectors * disk->sector_size );
+
+        if( head > 0 )
+        {
+            res = fat16_write_partial( disk, position, in, head );
+        }
+
+        for( uint32_t sector = 0; ( sector < sectors ) && ( res >= 0 ); sector += OS_DISK_MAX_SECTORS_PER_TRANSFER )
+        {
+            uint32_t total_sectors = sectors - sector;
+
+            if( total_sectors > OS_DISK_MAX_SECTORS_PER_TRANSFER )
+            {
+                total_sectors = OS_DISK_MAX_SECTORS_PER_TRANSFER;
+            }
+
+            res = disk_write_block( disk, ( ( position + head ) / disk->sector_size ) + sector, total_sectors, in + head + ( sector * disk->sector_size ) );
+        }
+
+        if( ( tail > 0 ) && ( res >= 0 ) )
+        {
+            res = fat16_write_partial( disk, position + chunk - tail, in + chunk - tail, tail );
+        }
+
+        offset += chunk;
+        in     += chunk;
+        total  -= chunk;
+    }
+
+    return res;
+}
+
+/* the index goes stale when entries change, the next lookup rebuilds it */
+static void fat16_invalidate_directory_index( struct fat_directory *directory )
+{
+    kfree( directory->index_buckets );
+    kfree( directory->index_next );
+    directory->index_buckets       = 0;
+    directory->index_next          = 0;
+    directory->total_index_buckets = 0;
+}
+
+void fat16_free_directory( struct fat_directory *directory )
+{
+    if( !directory )
+    {
+        return;
+    }
+
+    if( directory->item )
+    {
+        kfree( directory->item );
+    }
+
+    fat16_invalidate_directory_index( directory );
+    kfree( directory );
+}
 
 void fat16_fat_item_free( struct fat_item *item )
 {
@@ -499,230 +1295,1285 @@ void fat16_fat_item_free( struct fat_item *item )
         kfree( item->item );
     }
 
-    kfree( item );
-}
+    kfree( item );
+}
+
+struct fat_directory *fat16_load_fat_directory( struct disk *disk,
+                                                struct fat_directory_item *item )
+{
+    int res = OS_OK;
+    struct fat_directory *directory = 0;
+    struct fat_private *fat_private = disk->fs_private;
+
+    if( !( item->attribute & FAT_FILE_SUBDIRECTORY ) )
+    {
+        res = -INVALID_ARGUMENT_ERROR;
+
+        if( res != OS_OK )
+        {
+            fat16_free_directory( directory );
+        }
+
+        return directory;
+    }
+
+    directory = kzalloc( sizeof( struct fat_directory ) );
+
+    if( !directory )
+    {
+        res = -NO_MEMORY_ERROR;
+
+        if( res != OS_OK )
+        {
+            fat16_free_directory( directory );
+        }
+
+        return directory;
+    }
+
+    int cluster        = fat16_get_first_cluster( item );
+    int cluster_sector = fat16_cluster_to_sector( fat_private, cluster );
+    int total_items    = fat16_get_total_items_for_directory( disk, cluster_sector );
+
+    directory->total_number_of_items = total_items;
+    directory->cluster = cluster;
+    int directory_size = directory->total_number_of_items * sizeof( struct fat_directory_item );
+
+    directory->item = kzalloc( directory_size );
+
+    if( !directory->item )
+    {
+        res = -NO_MEMORY_ERROR;
+
+        if( res != OS_OK )
+        {
+            fat16_free_directory( directory );
+        }
+
+        return 0;
+    }
+
+    res = fat16_read_internal( disk, cluster, 0x00, directory_size, directory->item );
+
+    if( res != OS_OK )
+    {
+        fat16_free_directory( directory );
+        return 0;
+    }
+
+    return directory;
+}
+
+struct fat_item *fat16_new_fat_item_for_directory_item( struct disk *disk,
+                                                        struct fat_directory_item *item )
+{
+    struct fat_item *f_item = kzalloc( sizeof( struct fat_item ) );
+
+    if( !f_item )
+    {
+        return 0;
+    }
+
+    if( item->attribute & FAT_FILE_SUBDIRECTORY )
+    {
+        f_item->directory = fat16_load_fat_directory( disk, item );
+        f_item->type      = FAT_ITEM_TYPE_DIRECTORY;
+        return f_item;
+    }
+
+    f_item->type = FAT_ITEM_TYPE_FILE;
+    f_item->item = fat16_clone_directory_item( item, sizeof( struct fat_directory_item ) );
+
+    return f_item;
+}
+
+/* names are kept in lower case, an 8.3 name never needs more than OS_FAT16_NAME_SIZE */
+static bool fat16_dentry_name( char *out,
+                               const char *name )
+{
+    int idx = 0;
+
+    for( ; name[ idx ]; idx++ )
+    {
+        if( idx >= OS_FAT16_NAME_SIZE - 1 )
+        {
+            return false;
+        }
+
+        out[ idx ] = tolower( name[ idx ] );
+    }
+
+    out[ idx ] = 0x00;
+
+    return true;
+}
+
+static uint32_t fat16_dentry_hash( uint32_t parent,
+                                   const char *name )
+{
+    uint32_t hash = parent * 2654435761U;
+
+    while( *name )
+    {
+        hash = ( hash * 31 ) + *name;
+        name++;
+    }
+
+    return hash % OS_FAT16_DENTRY_BUCKETS;
+}
+
+static struct fat_dentry *fat16_dentry_lookup( struct fat_private *private,
+                                               uint32_t parent,
+                                               const char *name )
+{
+    struct fat_dentry_cache *cache = &private->dentry_cache;
+
+    for( int index = cache->buckets[ fat16_dentry_hash( parent, name ) ]; index >= 0; index = cache->entries[ index ].next )
+    {
+        struct fat_dentry *dentry = &cache->entries[ index ];
+
+        if( ( dentry->parent == parent ) && ( strncmp( dentry->name, name, sizeof( dentry->name ) ) == 0 ) )
+        {
+            dentry->referenced = true;
+            return dentry;
+        }
+    }
+
+    return 0;
+}
+
+static void fat16_dentry_unlink( struct fat_dentry_cache *cache,
+                                 int index )
+{
+    struct fat_dentry *dentry = &cache->entries[ index ];
+    int *link = &cache->buckets[ fat16_dentry_hash( dentry->parent, dentry->name ) ];
+
+    while( *link >= 0 )
+    {
+        if( *link == index )
+        {
+            *link = dentry->next;
+            break;
+        }
+
+        link = &cache->entries[ *link ].next;
+    }
+
+    dentry->valid = false;
+}
+
+/* clock over all entries, like the sector cache */
+static int fat16_dentry_evict( struct fat_dentry_cache *cache )
+{
+    while( true )
+    {
+        int index = cache->hand;
+        struct fat_dentry *dentry = &cache->entries[ index ];
+
+        cache->hand = ( cache->hand + 1 ) % OS_FAT16_DENTRY_ENTRIES;
+
+        if( !dentry->valid )
+        {
+            return index;
+        }
+
+        if( dentry->referenced )
+        {
+            dentry->referenced = false;
+            continue;
+        }
+
+        fat16_dentry_unlink( cache, index );
+
+        return index;
+    }
+}
+
+/* remember the result of a directory scan, a zero item records that the name does not exist */
+static void fat16_dentry_insert( struct fat_private *private,
+                                 uint32_t parent,
+                                 const char *name,
+                                 struct fat_directory_item *item,
+                                 int slot )
+{
+    struct fat_dentry_cache *cache = &private->dentry_cache;
+    int index = fat16_dentry_evict( cache );
+    struct fat_dentry *dentry = &cache->entries[ index ];
+    uint32_t bucket = fat16_dentry_hash( parent, name );
+
+    strncpy( dentry->name, name, sizeof( dentry->name ) );
+    dentry->parent     = parent;
+    dentry->slot       = slot;
+    dentry->negative   = !item;
+    dentry->valid      = true;
+    dentry->referenced = false;
+
+    if( item )
+    {
+        memcpy( &dentry->item, item, sizeof( struct fat_directory_item ) );
+    }
+
+    dentry->next = cache->buckets[ bucket ];
+    cache->buckets[ bucket ] = index;
+}
+
+/* drop what is known about a name, it is about to change */
+static void fat16_dentry_forget( struct fat_private *private,
+                                 uint32_t parent,
+                                 const char *name )
+{
+    struct fat_dentry *dentry = fat16_dentry_lookup( private, parent, name );
+
+    if( dentry )
+    {
+        fat16_dentry_unlink( &private->dentry_cache, dentry - private->dentry_cache.entries );
+    }
+}
+
+/* "name.ext" to the space padded upper case form of a directory entry, false if it is no 8.3 name */
+static bool fat16_pack_name( uint8_t *out,
+                             const char *name )
+{
+    int length = strlen( name );
+    int dot    = length;
+
+    for( int idx = length - 1; idx >= 0; idx-- )
+    {
+        if( name[ idx ] == '.' )
+        {
+            dot = idx;
+            break;
+        }
+    }
+
+    if( ( dot == 0 ) || ( dot > 8 ) || ( length - dot - 1 > 3 ) )
+    {
+        return false;
+    }
+
+    memset( out, ' ', OS_FAT16_PACKED_NAME_SIZE );
+
+    for( int idx = 0; idx < dot; idx++ )
+    {
+        out[ idx ] = toupper( name[ idx ] );
+    }
+
+    for( int idx = dot + 1; idx < length; idx++ )
+    {
+        out[ 8 + ( idx - dot - 1 ) ] = toupper( name[ idx ] );
+    }
+
+    /* a name really starting with 0xE5 is stored as 0x05 */
+    if( out[ 0 ] == OS_DIRECTORY_ENTRY_IS_FREE )
+    {
+        out[ 0 ] = 0x05;
+    }
+
+    return true;
+}
+
+/* skips free slots, volume labels and long name parts */
+static bool fat16_is_named_entry( struct fat_directory_item *item )
+{
+    return ( item->filename[ 0 ] != 0x00 ) && ( item->filename[ 0 ] != OS_DIRECTORY_ENTRY_IS_FREE ) && !( item->attribute & FAT_FILE_VOLUME_LABEL );
+}
+
+static uint32_t fat16_packed_name_hash( const uint8_t *packed )
+{
+    uint32_t hash = 2166136261U;
+
+    for( int idx = 0; idx < OS_FAT16_PACKED_NAME_SIZE; idx++ )
+    {
+        hash = ( hash ^ packed[ idx ] ) * 16777619U;
+    }
+
+    return hash;
+}
+
+static int fat16_build_directory_index( struct fat_directory *directory )
+{
+    int res = OS_OK;
+
+    directory->total_index_buckets = directory->total_number_of_items;
+    directory->index_buckets       = kzalloc( sizeof( int ) * directory->total_index_buckets );
+    directory->index_next          = kzalloc( sizeof( int ) * directory->total_number_of_items );
+
+    if( !directory->index_buckets || !directory->index_next )
+    {
+        res = -NO_MEMORY_ERROR;
+        fat16_invalidate_directory_index( directory );
+        return res;
+    }
+
+    for( int idx = 0; idx < directory->total_index_buckets; idx++ )
+    {
+        directory->index_buckets[ idx ] = -1;
+    }
+
+    for( int idx = 0; idx < directory->total_number_of_items; idx++ )
+    {
+        struct fat_directory_item *item = &directory->item[ idx ];
+
+        if( !fat16_is_named_entry( item ) )
+        {
+            continue;
+        }
+
+        uint32_t bucket = fat16_packed_name_hash( item->filename ) % directory->total_index_buckets;
+
+        directory->index_next[ idx ]       = directory->index_buckets[ bucket ];
+        directory->index_buckets[ bucket ] = idx;
+    }
+
+    return res;
+}
+
+/* returns the entry with the packed name, large directories are searched through their index */
+struct fat_directory_item *fat16_find_item_in_directory( struct fat_directory *directory,
+                                                         uint8_t *packed )
+{
+    if( !directory->index_buckets && ( directory->total_number_of_items >= OS_FAT16_DIRECTORY_INDEX_MIN ) )
+    {
+        /* without memory for the index the directory is scanned */
+        fat16_build_directory_index( directory );
+    }
+
+    if( directory->index_buckets )
+    {
+        uint32_t bucket = fat16_packed_name_hash( packed ) % directory->total_index_buckets;
+
+        for( int idx = directory->index_buckets[ bucket ]; idx >= 0; idx = directory->index_next[ idx ] )
+        {
+            if( memcmp( directory->item[ idx ].filename, packed, OS_FAT16_PACKED_NAME_SIZE ) == 0 )
+            {
+                return &directory->item[ idx ];
+            }
+        }
+
+        return 0;
+    }
+
+    for( int idx = 0; idx < directory->total_number_of_items; idx++ )
+    {
+        struct fat_directory_item *item = &directory->item[ idx ];
+
+        if( fat16_is_named_entry( item ) && ( memcmp( item->filename, packed, OS_FAT16_PACKED_NAME_SIZE ) == 0 ) )
+        {
+            return item;
+        }
+    }
+
+    return 0;
+}
+
+/* a directory held open by a descriptor is already in memory, with its index */
+static struct fat_directory *fat16_find_open_directory( struct fat_private *private,
+                                                        uint32_t cluster )
+{
+    for( struct fat_item *f_item = private->open_items; f_item; f_item = f_item->next )
+    {
+        if( ( f_item->type == FAT_ITEM_TYPE_DIRECTORY ) && ( f_item->directory->cluster == cluster ) )
+        {
+            return f_item->directory;
+        }
+    }
+
+    return 0;
+}
+
+/* write a directory entry to the disk and to every copy of it in memory */
+static int fat16_write_directory_entry( struct disk *disk,
+                                        uint32_t parent,
+                                        int slot,
+                                        struct fat_directory_item *item )
+{
+    int res = OS_OK;
+    struct fat_private *private = disk->fs_private;
+    int position = fat16_directory_entry_position( disk, parent, slot );
+
+    if( position < 0 )
+    {
+        res = position;
+        return res;
+    }
+
+    res = fat16_write_partial( disk, position, item, sizeof( struct fat_directory_item ) );
+
+    if( res < 0 )
+    {
+        return res;
+    }
+
+    struct fat_directory *directory = parent ? fat16_find_open_directory( private, parent ) : &private->root_directory;
+
+    if( directory )
+    {
+        /* the root directory is held in full, an open directory grows by the new slot */
+        if( parent && ( slot >= directory->total_number_of_items ) )
+        {
+            struct fat_directory_item *items = kzalloc( ( slot + 1 ) * sizeof( struct fat_directory_item ) );
+
+            if( !items )
+            {
+                res = -NO_MEMORY_ERROR;
+                return res;
+            }
+
+            memcpy( items, directory->item, directory->total_number_of_items * sizeof( struct fat_directory_item ) );
+            kfree( directory->item );
+            directory->item = items;
+        }
+
+        if( ( slot >= directory->total_number_of_items ) || ( memcmp( directory->item[ slot ].filename, item->filename, OS_FAT16_PACKED_NAME_SIZE ) != 0 ) )
+        {
+            fat16_invalidate_directory_index( directory );
+        }
+
+        memcpy( &directory->item[ slot ], item, sizeof( struct fat_directory_item ) );
+
+        if( slot >= directory->total_number_of_items )
+        {
+            directory->total_number_of_items = slot + 1;
+        }
+    }
+
+    char filename[ OS_MAX_PATH ];
+    char key[ OS_FAT16_NAME_SIZE ];
+
+    fat16_get_full_relative_filename( item, filename, sizeof( filename ) );
+
+    if( fat16_dentry_name( key, filename ) )
+    {
+        struct fat_dentry *dentry = fat16_dentry_lookup( private, parent, key );
+
+        if( dentry && !dentry->negative && ( dentry->slot == slot ) )
+        {
+            memcpy( &dentry->item, item, sizeof( struct fat_directory_item ) );
+        }
+    }
+
+    return res;
+}
+
+/* resolve one name in a directory, zero for the root, only a dentry cache miss reads the directory */
+static int fat16_lookup( struct disk *disk,
+                         struct fat_directory_item *parent_item,
+                         const char *name,
+                         struct fat_directory_item *out,
+                         int *slot )
+{
+    int res = OS_OK;
+    struct fat_private *private = disk->fs_private;
+    uint32_t parent = parent_item ? fat16_get_first_cluster( parent_item ) : 0;
+    char key[ OS_FAT16_NAME_SIZE ];
+    uint8_t packed[ OS_FAT16_PACKED_NAME_SIZE ];
+
+    if( !fat16_dentry_name( key, name ) || !fat16_pack_name( packed, name ) )
+    {
+        res = -BAD_PATH_ERROR;
+        return res;
+    }
+
+    struct fat_dentry *dentry = fat16_dentry_lookup( private, parent, key );
+
+    if( dentry )
+    {
+        if( dentry->negative )
+        {
+            res = -BAD_PATH_ERROR;
+            return res;
+        }
+
+        memcpy( out, &dentry->item, sizeof( struct fat_directory_item ) );
+        *slot = dentry->slot;
+        return res;
+    }
+
+    struct fat_directory *directory = parent_item ? fat16_find_open_directory( private, parent ) : &private->root_directory;
+    bool loaded = false;
+
+    if( !directory )
+    {
+        directory = fat16_load_fat_directory( disk, parent_item );
+        loaded    = true;
+
+        if( !directory )
+        {
+            res = -IO_ERROR;
+            return res;
+        }
+    }
+
+    struct fat_directory_item *item = fat16_find_item_in_directory( directory, packed );
+
+    if( item )
+    {
+        memcpy( out, item, sizeof( struct fat_directory_item ) );
+        *slot = item - directory->item;
+    }
+    else
+    {
+        res = -BAD_PATH_ERROR;
+    }
+
+    fat16_dentry_insert( private, parent, key, item, item ? *slot : -1 );
+
+    if( loaded )
+    {
+        fat16_free_directory( directory );
+    }
+
+    return res;
+}
+
+/* the in-core object of a directory entry, shared by every descriptor open on it */
+static struct fat_item *fat16_get_item( struct disk *disk,
+                                        uint32_t parent,
+                                        struct fat_directory_item *item,
+                                        int slot )
+{
+    struct fat_private *private = disk->fs_private;
+    char filename[ OS_MAX_PATH ];
+    char key[ OS_FAT16_NAME_SIZE ];
+
+    fat16_get_full_relative_filename( item, filename, sizeof( filename ) );
+
+    if( !fat16_dentry_name( key, filename ) )
+    {
+        return 0;
+    }
+
+    for( struct fat_item *f_item = private->open_items; f_item; f_item = f_item->next )
+    {
+        if( ( f_item->parent == parent ) && ( strncmp( f_item->name, key, sizeof( f_item->name ) ) == 0 ) )
+        {
+            f_item->references++;
+            return f_item;
+        }
+    }
+
+    struct fat_item *f_item = fat16_new_fat_item_for_directory_item( disk, item );
+
+    if( !f_item )
+    {
+        return 0;
+    }
+
+    if( ( f_item->type == FAT_ITEM_TYPE_DIRECTORY ) ? !f_item->directory : !f_item->item )
+    {
+        fat16_fat_item_free( f_item );
+        return 0;
+    }
+
+    strncpy( f_item->name, key, sizeof( f_item->name ) );
+    f_item->disk       = disk;
+    f_item->parent     = parent;
+    f_item->slot       = slot;
+    f_item->references = 1;
+    f_item->next       = private->open_items;
+    private->open_items = f_item;
+
+    return f_item;
+}
+
+static void fat16_put_item( struct fat_item *item )
+{
+    struct fat_private *private = item->disk->fs_private;
+
+    item->references--;
+
+    if( item->references > 0 )
+    {
+        return;
+    }
+
+    for( struct fat_item **link = &private->open_items; *link; link = &( *link )->next )
+    {
+        if( *link == item )
+        {
+            *link = item->next;
+            break;
+        }
+    }
+
+    kfree( item->extents );
+    fat16_fat_item_free( item );
+}
+
+/* resolve every component but the last, returns the last one or zero when a directory on the way is missing */
+static struct path_part *fat16_get_parent( struct disk *disk,
+                                           struct path_part *path,
+                                           struct fat_directory_item *parent_item,
+                                           bool *has_parent )
+{
+    struct fat_directory_item item;
+    int slot = 0;
+
+    *has_parent = false;
+
+    while( path->next )
+    {
+        if( fat16_lookup( disk, *has_parent ? parent_item : 0, path->part, &item, &slot ) < 0 )
+        {
+            return 0;
+        }
+
+        if( !( item.attribute & FAT_FILE_SUBDIRECTORY ) )
+        {
+            return 0;
+        }
+
+        memcpy( parent_item, &item, sizeof( struct fat_directory_item ) );
+        *has_parent = true;
+        path        = path->next;
+    }
+
+    return path;
+}
+
+/* warm paths are a hash lookup per component and a walk over the open items */
+struct fat_item *fat16_get_directory_entry( struct disk *disk,
+                                            struct path_part *path )
+{
+    struct fat_directory_item parent_item;
+    struct fat_directory_item item;
+    bool has_parent = false;
+    int slot = 0;
+
+    path = fat16_get_parent( disk, path, &parent_item, &has_parent );
+
+    if( !path || ( fat16_lookup( disk, has_parent ? &parent_item : 0, path->part, &item, &slot ) < 0 ) )
+    {
+        return 0;
+    }
+
+    return fat16_get_item( disk, has_parent ? fat16_get_first_cluster( &parent_item ) : 0, &item, slot );
+}
+
+static void fat16_free_file_descriptor( struct fat_file_descriptor *desc )
+{
+    fat16_put_item( desc->item );
+    kfree( desc );
+}
+
+/* a new empty file in the first free slot of its directory, directories are not grown */
+static struct fat_item *fat16_create( struct disk *disk,
+                                      struct path_part *path )
+{
+    struct fat_private *private = disk->fs_private;
+    struct fat_directory_item parent_item;
+    struct fat_directory_item item;
+    bool has_parent = false;
+    char key[ OS_FAT16_NAME_SIZE ];
+    uint8_t packed[ OS_FAT16_PACKED_NAME_SIZE ];
+
+    path = fat16_get_parent( disk, path, &parent_item, &has_parent );
+
+    if( !path || !fat16_dentry_name( key, path->part ) || !fat16_pack_name( packed, path->part ) )
+    {
+        return 0;
+    }
+
+    uint32_t parent = has_parent ? fat16_get_first_cluster( &parent_item ) : 0;
+    struct fat_directory *directory = has_parent ? fat16_find_open_directory( private, parent ) : &private->root_directory;
+    bool loaded = false;
+    int capacity = private->header.primary_header.root_dir_entries;
+
+    if( !directory )
+    {
+        directory = fat16_load_fat_directory( disk, &parent_item );
+        loaded    = true;
+
+        if( !directory )
+        {
+            return 0;
+        }
+    }
+
+    if( has_parent )
+    {
+        int total_clusters = 0;
+
+        /* a subdirectory holds as many entries as its chain has room for, the count stops a cycle */
+        for( int cluster = parent; ( cluster >= 2 ) && ( cluster < OS_FAT16_RESERVED ) && ( total_clusters < OS_FAT16_RESERVED ); cluster = fat16_get_fat_entry( disk, cluster ) )
+        {
+            total_clusters++;
+        }
+
+        capacity = ( total_clusters * private->header.primary_header.sectors_per_cluster * disk->sector_size ) / sizeof( struct fat_directory_item );
+    }
+
+    int slot = directory->total_number_of_items;
+
+    for( int idx = 0; idx < directory->total_number_of_items; idx++ )
+    {
+        if( directory->item[ idx ].filename[ 0 ] == OS_DIRECTORY_ENTRY_IS_FREE )
+        {
+            slot = idx;
+            break;
+        }
+    }
+
+    /* the name exists after all, or the directory is full */
+    if( fat16_find_item_in_directory( directory, packed ) || ( slot >= capacity ) )
+    {
+        if( loaded )
+        {
+            fat16_free_directory( directory );
+        }
+
+        return 0;
+    }
+
+    bool end_marker = slot == directory->total_number_of_items;
+
+    if( loaded )
+    {
+        fat16_free_directory( directory );
+    }
+
+    bzero( &item, sizeof( item ) );
+    memcpy( item.filename, packed, sizeof( item.filename ) );
+    memcpy( item.ext, packed + sizeof( item.filename ), sizeof( item.ext ) );
+    item.attribute = FAT_FILE_ARCHIVED;
+
+    if( fat16_write_directory_entry( disk, parent, slot, &item ) < 0 )
+    {
+        return 0;
+    }
+
+    /* the new entry took the place of the end marker, it moves one slot on */
+    if( end_marker && ( slot + 1 < capacity ) )
+    {
+        struct fat_directory_item end;
+        int position = fat16_directory_entry_position( disk, parent, slot + 1 );
+
+        bzero( &end, sizeof( end ) );
+
+        if( ( position < 0 ) || ( fat16_write_partial( disk, position, &end, sizeof( end ) ) < 0 ) )
+        {
+            return 0;
+        }
+    }
+
+    fat16_dentry_forget( private, parent, key );
+    fat16_dentry_insert( private, parent, key, &item, slot );
+
+    return fat16_get_item( disk, parent, &item, slot );
+}
+
+void *fat16_open( struct disk *disk,
+                  struct path_part *path,
+                  FILE_MODE mode )
+{
+    struct fat_file_descriptor *descriptor = 0;
+    struct fat_private *private = disk->fs_private;
+    int res = 0;
+
+    /* writing needs the FAT and the free clusters in memory */
+    if( ( mode != FILE_MODE_READ ) && !private->free_bitmap )
+    {
+        res = -READ_ONLY_ERROR;
+        return ERROR( res );
+    }
+
+    descriptor = kzalloc( sizeof( struct fat_file_descriptor ) );
+
+    if( !descriptor )
+    {
+        res = -NO_MEMORY_ERROR;
+        return ERROR( res );
+    }
+
+    descriptor->item = fat16_get_directory_entry( disk, path );
+
+    if( !descriptor->item && ( mode != FILE_MODE_READ ) )
+    {
+        descriptor->item = fat16_create( disk, path );
+    }
+
+    if( !descriptor->item )
+    {
+        res = -IO_ERROR;
+        kfree( descriptor );
+        return ERROR( res );
+    }
+
+    if( ( mode != FILE_MODE_READ ) && ( ( descriptor->item->type != FAT_ITEM_TYPE_FILE ) || ( descriptor->item->item->attribute & FAT_FILE_READ_ONLY ) ) )
+    {
+        res = -READ_ONLY_ERROR;
+        fat16_free_file_descriptor( descriptor );
+        return ERROR( res );
+    }
+
+    descriptor->pos  = 0;
+    descriptor->mode = mode;
+
+    if( mode == FILE_MODE_WRITE )
+    {
+        res = fat16_truncate( disk, descriptor, 0 );
+
+        if( res < 0 )
+        {
+            fat16_free_file_descriptor( descriptor );
+            return ERROR( res );
+        }
+    }
+
+    return descriptor;
+}
+
+/* grow the window while reads follow each other, shrink it on random access */
+static void fat16_update_readahead_window( struct fat_file_descriptor *desc,
+                                           uint32_t offset )
+{
+    if( offset == desc->readahead_next )
+    {
+        desc->readahead_window = desc->readahead_window ? desc->readahead_window * 2 : OS_FAT16_READAHEAD_MIN;
+
+        if( desc->readahead_window > OS_FAT16_READAHEAD_MAX )
+        {
+            desc->readahead_window = OS_FAT16_READAHEAD_MAX;
+        }
+    }
+    else
+    {
+        desc->readahead_window /= 2;
+
+        if( desc->readahead_window < OS_FAT16_READAHEAD_MIN )
+        {
+            desc->readahead_window = 0;
+        }
+    }
+}
+
+/*
+ * file data through the page cache, without an output buffer the pages are only brought in,
+ * every run of missing pages is read with one extent read, straight into the caller buffer
+ * when it covers whole pages of it, otherwise into the read ahead buffer, and then copied into the cache
+ */
+static int fat16_read_pages( struct disk *disk,
+                             struct fat_file_descriptor *desc,
+                             uint32_t offset,
+                             uint32_t total,
+                             char *out )
+{
+    int res = OS_OK;
+    struct fat_private *private     = disk->fs_private;
+    struct fat_directory_item *item = desc->item->item;
+    uint32_t file = fat16_get_first_cluster( item );
+    uint32_t end  = offset + total;
+
+    /* built before any page is taken, allocations may reclaim cached pages */
+    res = fat16_build_extents( disk, desc );
+
+    if( res < 0 )
+    {
+        return res;
+    }
+
+    if( !private->readahead_buffer )
+    {
+        /* without it missing pages are read one at a time */
+        private->readahead_buffer = kzalloc( OS_FAT16_READAHEAD_MAX );
+    }
+
+    while( offset < end )
+    {
+        uint32_t index       = offset / PAGING_PAGE_SIZE;
+        uint32_t page_start  = index * PAGING_PAGE_SIZE;
+        uint32_t page_offset = offset - page_start;
+        uint32_t chunk       = PAGING_PAGE_SIZE - page_offset;
+
+        if( chunk > end - offset )
+        {
+            chunk = end - offset;
+        }
+
+        /* past the end of the file reads as zeros */
+        if( page_start >= item->filesize )
+        {
+            if( out )
+            {
+                bzero( out, chunk );
+                out += chunk;
+            }
+
+            offset += chunk;
+            continue;
+        }
+
+        void *data = pagecache_lookup( disk->id, file, index );
+
+        if( data )
+        {
+            if( out )
+            {
+                memcpy( out, data + page_offset, chunk );
+                out += chunk;
+            }
+
+            offset += chunk;
+            continue;
+        }
+
+        /* the run of missing pages touched by the read, up to the end of the file */
+        uint32_t limit = ( ( end - page_start ) + PAGING_PAGE_SIZE - 1 ) / PAGING_PAGE_SIZE;
+        uint32_t pages = 1;
+
+        while( ( pages < limit ) && ( page_start + ( pages * PAGING_PAGE_SIZE ) < item->filesize ) && !pagecache_lookup( disk->id, file, index + pages ) )
+        {
+            pages++;
+        }
+
+        /* whole pages of the caller buffer are read into in place, a partial last page is left for the next round */
+        if( out && ( page_offset == 0 ) && ( pages > 1 ) && ( page_start + ( pages * PAGING_PAGE_SIZE ) > end ) )
+        {
+            pages--;
+        }
+
+        bool direct  = out && ( page_offset == 0 ) && ( page_start + ( pages * PAGING_PAGE_SIZE ) <= end );
+        char *target = direct ? out : private->readahead_buffer;
+
+        if( !direct && ( pages > OS_FAT16_READAHEAD_MAX / PAGING_PAGE_SIZE ) )
+        {
+            pages = OS_FAT16_READAHEAD_MAX / PAGING_PAGE_SIZE;
+        }
+
+        bool in_page = !target;
+
+        if( in_page )
+        {
+            /* no buffer to gather the run in, the page itself is the target */
+            pages  = 1;
+            target = pagecache_insert( disk->id, file, index );
+        }
+
+        uint32_t run      = pages * PAGING_PAGE_SIZE;
+        uint32_t run_fill = ( page_start + run > item->filesize ) ? item->filesize - page_start : run;
 
-struct fat_directory *fat16_load_fat_directory( struct disk *disk,
-                                                struct fat_directory_item *item )
-{
-    int res = OS_OK;
-    struct fat_directory *directory = 0;
-    struct fat_private *fat_private = disk->fs_private;
+        /* no memory to cache it either, read the data around the cache */
+        if( !target )
+        {
+            if( out )
+            {
+                uint32_t available = ( offset + chunk > item->filesize ) ? item->filesize - offset : chunk;
 
-    if( !( item->attribute & FAT_FILE_SUBDIRECTORY ) )
-    {
-        res = -INVALID_ARGUMENT_ERROR;
+                res = fat16_read_extents( disk, desc, offset, available, out );
 
-        if( res != OS_OK )
+                if( res < 0 )
+                {
+                    return res;
+                }
+
+                bzero( out + available, chunk - available );
+                out += chunk;
+            }
+
+            offset += chunk;
+            continue;
+        }
+
+        res = fat16_read_extents( disk, desc, page_start, run_fill, target );
+
+        if( res < 0 )
         {
-            fat16_free_directory( directory );
+            if( in_page )
+            {
+                pagecache_remove( disk->id, file, index );
+            }
+
+            return res;
         }
 
-        return directory;
-    }
+        bzero( target + run_fill, run - run_fill );
 
-    directory = kzalloc( sizeof( struct fat_directory ) );
+        for( uint32_t page = 0; ( page < pages ) && !in_page; page++ )
+        {
+            void *cached = pagecache_insert( disk->id, file, index + page );
 
-    if( !directory )
-    {
-        res = -NO_MEMORY_ERROR;
+            if( cached )
+            {
+                memcpy( cached, target + ( page * PAGING_PAGE_SIZE ), PAGING_PAGE_SIZE );
+            }
+        }
 
-        if( res != OS_OK )
+        uint32_t done = ( page_start + run < end ) ? page_start + run - offset : end - offset;
+
+        if( out && !direct )
         {
-            fat16_free_directory( directory );
+            memcpy( out, target + page_offset, done );
         }
 
-        return directory;
+        if( out )
+        {
+            out += done;
+        }
+
+        offset += done;
     }
 
-    int cluster        = fat16_get_first_cluster( item );
-    int cluster_sector = fat16_cluster_to_sector( fat_private, cluster );
-    int total_items    = fat16_get_total_items_for_directory( disk, cluster_sector );
+    return res;
+}
 
-    directory->total_number_of_items = total_items;
-    int directory_size = directory->total_number_of_items * sizeof( struct fat_directory_item );
+/* serve the read from the page cache, a sequential reader gets the window behind it prefetched */
+static int fat16_read_ahead( struct disk *disk,
+                             struct fat_file_descriptor *desc,
+                             uint32_t offset,
+                             uint32_t total,
+                             char *out_ptr )
+{
+    int res = OS_OK;
+    struct fat_directory_item *item = desc->item->item;
 
-    directory->item = kzalloc( directory_size );
+    fat16_update_readahead_window( desc, offset );
 
-    if( !directory->item )
+    res = fat16_read_pages( disk, desc, offset, total, out_ptr );
+
+    if( ISERR( res ) )
     {
-        res = -NO_MEMORY_ERROR;
+        return res;
+    }
 
-        if( res != OS_OK )
+    desc->readahead_next = offset + total;
+
+    if( desc->readahead_window && ( desc->readahead_next < item->filesize ) )
+    {
+        uint32_t fill = item->filesize - desc->readahead_next;
+
+        if( fill > desc->readahead_window )
         {
-            fat16_free_directory( directory );
+            fill = desc->readahead_window;
         }
 
-        return directory;
+        /* a failed prefetch only costs the next read a miss */
+        fat16_read_pages( disk, desc, desc->readahead_next, fill, 0 );
     }
 
-    res = fat16_read_internal( disk, cluster, 0x00, directory_size, directory->item );
+    return res;
+}
 
-    if( res != OS_OK )
+int fat16_read( struct disk *disk,
+                void *descriptor,
+                uint32_t size,
+                uint32_t nmemb,
+                char *out_ptr )
+{
+    int res = OS_OK;
+    struct fat_file_descriptor *fat_desc = descriptor;
+
+    res = fat16_read_ahead( disk, fat_desc, fat_desc->pos, size * nmemb, out_ptr );
+
+    if( ISERR( res ) )
     {
-        fat16_free_directory( directory );
-        return directory;
+        return res;
     }
 
-    return directory;
+    /* the next read carries on where this one stopped */
+    fat_desc->pos += size * nmemb;
+
+    res = nmemb;
+
+    return res;
 }
 
-struct fat_item *fat16_new_fat_item_for_directory_item( struct disk *disk,
-                                                        struct fat_directory_item *item )
+/* file data to the disk, the clusters must already be there, cached pages of the range are dropped */
+static int fat16_write_data( struct disk *disk,
+                             struct fat_file_descriptor *desc,
+                             uint32_t offset,
+                             uint32_t total,
+                             char *in )
 {
-    struct fat_item *f_item = kzalloc( sizeof( struct fat_item ) );
+    int res = fat16_write_extents( disk, desc, offset, total, in );
+    uint32_t file = fat16_get_first_cluster( desc->item->item );
 
-    if( !f_item )
+    for( uint32_t index = offset / PAGING_PAGE_SIZE; ( total > 0 ) && ( index <= ( offset + total - 1 ) / PAGING_PAGE_SIZE ); index++ )
     {
-        return 0;
+        pagecache_remove( disk->id, file, index );
     }
 
-    if( item->attribute & FAT_FILE_SUBDIRECTORY )
-    {
-        f_item->directory = fat16_load_fat_directory( disk, item );
-        f_item->type      = FAT_ITEM_TYPE_DIRECTORY;
-        return f_item;
-    }
+    return res;
+}
 
-    f_item->type = FAT_ITEM_TYPE_FILE;
-    f_item->item = fat16_clone_directory_item( item, sizeof( struct fat_directory_item ) );
+/* the entry and the FAT go to the disk after every change, the FAT last */
+static int fat16_sync_file( struct disk *disk,
+                            struct fat_item *f_item )
+{
+    int res = fat16_write_directory_entry( disk, f_item->parent, f_item->slot, f_item->item );
+    int status = fat16_sync_fat( disk );
 
-    return f_item;
+    return ( res < 0 ) ? res : status;
 }
 
-struct fat_item *fat16_find_item_in_directory( struct disk *disk,
-                                               struct fat_directory *directory,
-                                               const char *name )
+static int fat16_check_writable( struct fat_file_descriptor *desc )
 {
-    struct fat_item *f_item = 0;
-    char temp_filename[ OS_MAX_PATH ];
-
-    for( int idx = 0; idx < directory->total_number_of_items; idx++ )
+    if( desc->item->type != FAT_ITEM_TYPE_FILE )
     {
-        fat16_get_full_relative_filename( &directory->item[ idx ], temp_filename, sizeof( temp_filename ) );
+        return -INVALID_ARGUMENT_ERROR;
+    }
 
-        if( istrncmp( temp_filename, name, sizeof( temp_filename ) ) == 0 )
-        {
-            /* found it lets create a new fat_item */
-            f_item = fat16_new_fat_item_for_directory_item( disk, &directory->item[ idx ] );
-        }
+    if( desc->mode == FILE_MODE_READ )
+    {
+        return -READ_ONLY_ERROR;
     }
 
-    return f_item;
+    return OS_OK;
 }
 
-struct fat_item *fat16_get_directory_entry( struct disk *disk,
-                                            struct path_part *path )
+int fat16_write( struct disk *disk,
+                 void *descriptor,
+                 uint32_t size,
+                 uint32_t nmemb,
+                 char *in_ptr )
 {
-    struct fat_private *fat_private = disk->fs_private;
-    struct fat_item *current_item   = 0;
-    struct fat_item *root_item      = fat16_find_item_in_directory( disk, &fat_private->root_directory, path->part );
+    int res = OS_OK;
+    struct fat_file_descriptor *desc = descriptor;
+
+    res = fat16_check_writable( desc );
 
-    if( !root_item )
+    if( res < 0 )
     {
-        return current_item;
+        return res;
     }
 
-    struct path_part *next_part = path->next;
+    struct fat_directory_item *item = desc->item->item;
+    uint32_t total  = size * nmemb;
+    uint32_t offset = ( desc->mode == FILE_MODE_APPEND ) ? item->filesize : desc->pos;
+    uint32_t end    = offset + total;
+
+    if( ( end < offset ) || ( ( size > 0 ) && ( total / size != nmemb ) ) )
+    {
+        res = -INVALID_ARGUMENT_ERROR;
+        return res;
+    }
 
-    current_item = root_item;
+    res = fat16_build_extents( disk, desc );
 
-    while( next_part != 0 )
+    if( res >= 0 )
     {
-        if( current_item->type != FAT_ITEM_TYPE_DIRECTORY )
-        {
-            current_item = 0;
-            break;
-        }
+        res = fat16_extend_file( disk, desc->item, end );
+    }
 
-        struct fat_item *temp_item = fat16_find_item_in_directory( disk, current_item->directory, next_part->part );
-        fat16_fat_item_free( current_item );
-        current_item = temp_item;
-        next_part    = next_part->next;
+    if( res >= 0 )
+    {
+        res = fat16_write_data( disk, desc, offset, total, in_ptr );
     }
 
-    return current_item;
-}
+    if( ( res >= 0 ) && ( end > item->filesize ) )
+    {
+        item->filesize = end;
+    }
 
-void *fat16_open( struct disk *disk,
-                  struct path_part *path,
-                  FILE_MODE mode )
-{
-    struct fat_file_descriptor *descriptor = 0;
-    int res = 0;
+    /* clusters taken by a failed write stay with the file, they are still in its chain */
+    int status = fat16_sync_file( disk, desc->item );
+
+    res = ( res < 0 ) ? res : status;
 
-    if( mode != FILE_MODE_READ )
+    if( res < 0 )
     {
-        res = -READ_ONLY_ERROR;
+        return res;
+    }
 
-        if( descriptor )
-        {
-            kfree( descriptor );
-        }
+    desc->pos = end;
+    res       = nmemb;
 
-        return ERROR( res );
-    }
+    return res;
+}
 
-    descriptor = kzalloc( sizeof( struct fat_file_descriptor ) );
+/* shrinking frees the clusters past the new end, growing fills the new bytes with zeros */
+int fat16_truncate( struct disk *disk,
+                    void *descriptor,
+                    uint32_t length )
+{
+    int res = OS_OK;
+    struct fat_file_descriptor *desc = descriptor;
 
-    if( !descriptor )
+    res = fat16_check_writable( desc );
+
+    if( res < 0 )
     {
-        res = -NO_MEMORY_ERROR;
+        return res;
+    }
 
-        if( descriptor )
-        {
-            kfree( descriptor );
-        }
+    struct fat_directory_item *item = desc->item->item;
+    uint32_t size = item->filesize;
 
-        return ERROR( res );
-    }
+    res = fat16_build_extents( disk, desc );
 
-    descriptor->item = fat16_get_directory_entry( disk, path );
+    if( res < 0 )
+    {
+        return res;
+    }
 
-    if( !descriptor->item )
+    if( length < size )
     {
-        res = -IO_ERROR;
+        res = fat16_shrink_file( disk, desc->item, length );
+    }
+    else if( length > size )
+    {
+        res = fat16_extend_file( disk, desc->item, length );
 
-        if( descriptor )
+        char *zeros = ( res >= 0 ) ? kzalloc( PAGING_PAGE_SIZE ) : 0;
+
+        if( ( res >= 0 ) && !zeros )
         {
-            kfree( descriptor );
+            res = -NO_MEMORY_ERROR;
         }
 
-        return ERROR( res );
+        for( uint32_t offset = size; ( offset < length ) && ( res >= 0 ); offset += PAGING_PAGE_SIZE )
+        {
+            uint32_t chunk = ( length - offset < PAGING_PAGE_SIZE ) ? length - offset : PAGING_PAGE_SIZE;
+
+            res = fat16_write_data( disk, desc, offset, chunk, zeros );
+        }
+
+        kfree( zeros );
+    }
+
+    if( res >= 0 )
+    {
+        item->filesize = length;
     }
 
-    descriptor->pos = 0;
+    int status = fat16_sync_file( disk, desc->item );
 
-    return descriptor;
+    return ( res < 0 ) ? res : status;
 }
 
-int fat16_read( struct disk *disk,
-                void *descriptor,
-                uint32_t size,
-                uint32_t nmemb,
-                char *out_ptr )
+/* reserve the clusters for a range without changing the size, later writes find them in one run */
+int fat16_allocate( struct disk *disk,
+                    void *descriptor,
+                    uint32_t offset,
+                    uint32_t length )
 {
     int res = OS_OK;
-    struct fat_file_descriptor *fat_desc = descriptor;
-    struct fat_directory_item *item      = fat_desc->item->item;
-    int offset = fat_desc->pos;
+    struct fat_file_descriptor *desc = descriptor;
 
-    for( uint32_t idx = 0; idx < nmemb; idx++ )
+    res = fat16_check_writable( desc );
+
+    if( res < 0 )
     {
-        res = fat16_read_internal( disk, fat16_get_first_cluster( item ), offset, size, out_ptr );
+        return res;
+    }
 
-        if( ISERR( res ) )
-        {
-            return res;
-        }
+    if( offset + length < offset )
+    {
+        res = -INVALID_ARGUMENT_ERROR;
+        return res;
+    }
+
+    res = fat16_build_extents( disk, desc );
 
-        out_ptr += size;
-        offset  += size;
+    if( res < 0 )
+    {
+        return res;
     }
 
-    res = nmemb;
+    res = fat16_extend_file( disk, desc->item, offset + length );
 
-    return res;
+    int status = fat16_sync_file( disk, desc->item );
+
+    return ( res < 0 ) ? res : status;
 }
 
 int fat16_seek( void *private,
@@ -740,32 +2591,37 @@ int fat16_seek( void *private,
     }
 
     struct fat_directory_item *ritem = desc_item->item;
-
-    if( offset >= ritem->filesize )
-    {
-        res = -IO_ERROR;
-        return res;
-    }
+    uint32_t pos = 0;
 
     switch( seek_mode )
     {
         case SEEK_SET:
-            desc->pos = offset;
+            pos = offset;
             break;
 
         case SEEK_END:
-            res = -UNIMPLIMENTED_ERROR;
+            /* the offset is negative or zero here */
+            pos = ritem->filesize + ( int ) offset;
             break;
 
         case SEEK_CUR:
-            desc->pos += offset;
+            pos = desc->pos + ( int ) offset;
             break;
 
         default:
             res = -INVALID_ARGUMENT_ERROR;
-            break;
+            return res;
+    }
+
+    /* the end of the file is a valid position, writes carry on from there */
+    if( pos > ritem->filesize )
+    {
+        res = -IO_ERROR;
+        return res;
     }
 
+    desc->pos = pos;
+
     return res;
 }
 
@@ -796,14 +2652,54 @@ int fat16_stat( struct disk *disk,
     return res;
 }
 
-static void fat16_free_file_descriptor( struct fat_file_descriptor *desc )
-{
-    fat16_fat_item_free( desc->item );
-    kfree( desc );
-}
-
 int fat16_close( void *private )
 {
     fat16_free_file_descriptor( ( struct fat_file_descriptor * ) private );
     return OS_OK;
 }
+
+int fat16_bmap( struct disk *disk,
+                void *private,
+                uint32_t offset )
+{
+    int res = OS_OK;
+    struct fat_file_descriptor *desc = private;
+    struct fat_private *fs_private   = disk->fs_private;
+
+    if( desc->item->type != FAT_ITEM_TYPE_FILE )
+    {
+        res = -INVALID_ARGUMENT_ERROR;
+        return res;
+    }
+
+    struct fat_directory_item *ritem = desc->item->item;
+
+    if( offset >= ritem->filesize )
+    {
+        res = -INVALID_ARGUMENT_ERROR;
+        return res;
+    }
+
+    int size_of_cluster_bytes = fs_private->header.primary_header.sectors_per_cluster * disk->sector_size;
+
+    res = fat16_build_extents( disk, desc );
+
+    if( res < 0 )
+    {
+        return res;
+    }
+
+    struct fat_extent *extent = fat16_find_extent( desc, offset / size_of_cluster_bytes );
+
+    if( !extent )
+    {
+        res = -IO_ERROR;
+        return res;
+    }
+
+    int cluster = extent->cluster + ( ( offset / size_of_cluster_bytes ) - extent->file_cluster );
+
+    res = fat16_cluster_to_sector( fs_private, cluster ) + ( ( offset % size_of_cluster_bytes ) / disk->sector_size );
+
+    return res;
+}
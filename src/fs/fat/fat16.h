@@ -6,13 +6,39 @@
 #include "disk/disk.h"
 #include "disk/disk_streamer.h"
 #include <stdint.h>
+#include <stdbool.h>
 
 #define OS_FAT16_SIGNATURE            0x29
 #define OS_FAT16_FAT_ENTRY_SIZE       0x02
-#define OS_FAT16_BAD_SECTOR           0xFF7
+#define OS_FAT16_BAD_SECTOR           0xFFF7
 #define OS_FAT16_UNUSED               0x00
+/* 0xFFF0 - 0xFFF6 are reserved, 0xFFF8 and above end the chain */
+#define OS_FAT16_RESERVED             0xFFF0
+#define OS_FAT16_END_OF_CHAIN         0xFFF8
+/* written at the end of a chain */
+#define OS_FAT16_END_OF_FILE          0xFFFF
 #define OS_DIRECTORY_ENTRY_IS_FREE    0xE5
 
+/* the read ahead window starts at the minimum and doubles on every sequential read */
+#define OS_FAT16_READAHEAD_MIN        4096
+#define OS_FAT16_READAHEAD_MAX        65536
+
+/* sector runs gathered before a vectored read is issued */
+#define OS_FAT16_READ_VECTOR          16
+
+/* sectors per read while loading the FAT on mount */
+#define OS_FAT16_FAT_LOAD_SECTORS     128
+
+/* directory entry cache, per mounted disk */
+#define OS_FAT16_DENTRY_ENTRIES       256
+#define OS_FAT16_DENTRY_BUCKETS       64
+/* 8.3 name with the dot and the terminator */
+#define OS_FAT16_NAME_SIZE            13
+/* 8.3 name as stored in a directory entry, padded with spaces */
+#define OS_FAT16_PACKED_NAME_SIZE     11
+/* directories with at least this many entries get a hash index over their names */
+#define OS_FAT16_DIRECTORY_INDEX_MIN  64
+
 /* FAT directory entry attributes bitmask */
 #define FAT_FILE_READ_ONLY            0x01
 #define FAT_FILE_HIDDEN               0x02
@@ -88,11 +114,30 @@ __attribute__( ( packed ) );
 struct fat_directory
 {
     struct fat_directory_item *item;
+    /* entry slots up to the end marker, free slots included */
     int total_number_of_items;
     int sector_pos;
     int ending_sector_pos;
+    /* first cluster, zero for the root */
+    uint32_t cluster;
+
+    /* hash index over the packed names, built on the first lookup in a large directory */
+    int *index_buckets;
+    /* next entry in the same bucket, -1 ends the chain */
+    int *index_next;
+    uint32_t total_index_buckets;
 };
 
+/* a run of consecutive clusters of a file */
+struct fat_extent
+{
+    /* index of the first cluster of the run within the file */
+    uint32_t file_cluster;
+    uint32_t cluster;
+    uint32_t total_clusters;
+};
+
+/* in-core directory entry, shared by every descriptor open on it */
 struct fat_item
 {
     union
@@ -102,12 +147,55 @@ struct fat_item
     };
 
     FAT_ITEM_TYPE type;
+
+    struct disk *disk;
+    /* first cluster of the directory holding the entry, zero for the root */
+    uint32_t parent;
+    /* index of the entry in that directory, writes go back to it */
+    int slot;
+    char name[ OS_FAT16_NAME_SIZE ];
+    uint32_t references;
+    struct fat_item *next;
+
+    /* the cluster chain of the file as sorted runs, built on first use */
+    struct fat_extent *extents;
+    uint32_t total_extents;
+};
+
+/* a resolved name, negative entries remember names that do not exist */
+struct fat_dentry
+{
+    char name[ OS_FAT16_NAME_SIZE ];
+    /* first cluster of the directory holding the name, zero for the root */
+    uint32_t parent;
+    struct fat_directory_item item;
+    int slot;
+    /* next entry in the same hash bucket, -1 ends the chain */
+    int next;
+    bool valid;
+    bool negative;
+    /* set on every hit, cleared by the clock hand */
+    bool referenced;
+};
+
+struct fat_dentry_cache
+{
+    struct fat_dentry entries[ OS_FAT16_DENTRY_ENTRIES ];
+    int buckets[ OS_FAT16_DENTRY_BUCKETS ];
+    uint32_t hand;
 };
 
 struct fat_file_descriptor
 {
     struct fat_item *item;
     uint32_t pos;
+    /* appends always go to the end of the file */
+    FILE_MODE mode;
+
+    /* bytes prefetched into the page cache past a sequential read, zero while the access pattern looks random */
+    uint32_t readahead_window;
+    /* where the next read starts if the file is streamed */
+    uint32_t readahead_next;
 };
 
 struct fat_private
@@ -118,9 +206,31 @@ struct fat_private
     /* used to stream data clusters */
     struct disk_stream *cluster_read_stream;
 
-    /* used to stream the file allocation table */
+    /* used to stream the file allocation table when it could not be loaded */
     struct disk_stream *fat_read_stream;
 
+    /* copy of the first FAT, loaded on mount, chain walks never touch the disk */
+    uint16_t *fat_table;
+    uint32_t fat_total_entries;
+    /* one bit per FAT sector changed in memory but not yet on the disk */
+    uint8_t *fat_dirty;
+
+    /* one bit per cluster, set when free, built on mount, zero keeps the disk read only */
+    uint8_t *free_bitmap;
+    /* clusters two and up hold data, the first two are not clusters */
+    uint32_t total_clusters;
+    uint32_t free_clusters;
+    /* allocations continue from here, next fit */
+    uint32_t next_free;
+
+    /* missing pages are read into it as one run and then copied into the page cache, allocated on first use */
+    char *readahead_buffer;
+
+    /* name lookups that need no directory scan */
+    struct fat_dentry_cache dentry_cache;
+    /* directory entries held open by descriptors */
+    struct fat_item *open_items;
+
     /* used in situation where we stream the directory */
     struct disk_stream *directory_stream;
 };
@@ -134,6 +244,18 @@ int fat16_read( struct disk *disk,
                 uint32_t size,
                 uint32_t nmemb,
                 char *out_ptr );
+int fat16_write( struct disk *disk,
+                 void *descriptor,
+                 uint32_t size,
+                 uint32_t nmemb,
+                 char *in_ptr );
+int fat16_truncate( struct disk *disk,
+                    void *descriptor,
+                    uint32_t length );
+int fat16_allocate( struct disk *disk,
+                    void *descriptor,
+                    uint32_t offset,
+                    uint32_t length );
 int fat16_seek( void *private,
                 uint32_t offset,
                 FILE_SEEK_MODE seek_mode );
@@ -141,6 +263,9 @@ int fat16_stat( struct disk *disk,
                 void *private,
                 struct file_stat *stat );
 int fat16_close( void *private );
+int fat16_bmap( struct disk *disk,
+                void *private,
+                uint32_t offset );
 struct filesystem *fat16_init();
 
 #endif /* FAT16_H_ */
@@ -268,7 +268,7 @@ int fread( void *ptr,
 
     struct file_descriptor *desc = file_get_descriptor( fd );
 
-    if( !fd )
+    if( !desc )
     {
         res = -INVALID_ARGUMENT_ERROR;
         return res;
@@ -279,6 +279,85 @@ int fread( void *ptr,
     return res;
 }
 
+int fwrite( void *ptr,
+            uint32_t size,
+            uint32_t nmemb,
+            int fd )
+{
+    int res = OS_OK;
+
+    if( ( size == 0 ) || ( nmemb == 0 ) || ( fd < 1 ) )
+    {
+        res = -IO_ERROR;
+        return res;
+    }
+
+    struct file_descriptor *desc = file_get_descriptor( fd );
+
+    if( !desc )
+    {
+        res = -INVALID_ARGUMENT_ERROR;
+        return res;
+    }
+
+    if( !desc->filesystem->write )
+    {
+        res = -READ_ONLY_ERROR;
+        return res;
+    }
+
+    res = desc->filesystem->write( desc->disk, desc->private, size, nmemb, ( char * ) ptr );
+
+    return res;
+}
+
+int ftruncate( int fd,
+               uint32_t length )
+{
+    int res = OS_OK;
+    struct file_descriptor *desc = file_get_descriptor( fd );
+
+    if( !desc )
+    {
+        res = -IO_ERROR;
+        return res;
+    }
+
+    if( !desc->filesystem->truncate )
+    {
+        res = -READ_ONLY_ERROR;
+        return res;
+    }
+
+    res = desc->filesystem->truncate( desc->disk, desc->private, length );
+
+    return res;
+}
+
+int fallocate( int fd,
+               uint32_t offset,
+               uint32_t length )
+{
+    int res = OS_OK;
+    struct file_descriptor *desc = file_get_descriptor( fd );
+
+    if( !desc )
+    {
+        res = -IO_ERROR;
+        return res;
+    }
+
+    if( !desc->filesystem->allocate )
+    {
+        res = -READ_ONLY_ERROR;
+        return res;
+    }
+
+    res = desc->filesystem->allocate( desc->disk, desc->private, offset, length );
+
+    return res;
+}
+
 int fseek( int fd,
            int offset,
            FILE_SEEK_MODE whence )
@@ -334,3 +413,38 @@ int fclose( int fd )
 
     return res;
 }
+
+int fbmap( int fd,
+           uint32_t offset )
+{
+    int res = OS_OK;
+    struct file_descriptor *desc = file_get_descriptor( fd );
+
+    if( !desc )
+    {
+        res = -IO_ERROR;
+        return res;
+    }
+
+    if( !desc->filesystem->bmap )
+    {
+        res = -UNIMPLIMENTED_ERROR;
+        return res;
+    }
+
+    res = desc->filesystem->bmap( desc->disk, desc->private, offset );
+
+    return res;
+}
+
+struct disk *fdisk( int fd )
+{
+    struct file_descriptor *desc = file_get_descriptor( fd );
+
+    if( !desc )
+    {
+        return 0;
+    }
+
+    return desc->disk;
+}
@@ -55,6 +55,20 @@ typedef int (*FS_READ_FUNCTION)( struct disk *disk,
                                  uint32_t size,
                                  uint32_t nmemb,
                                  char *out );
+typedef int (*FS_WRITE_FUNCTION)( struct disk *disk,
+                                  void *private,
+                                  uint32_t size,
+                                  uint32_t nmemb,
+                                  char *in );
+/* sets the size of the file, growing files read as zeros */
+typedef int (*FS_TRUNCATE_FUNCTION)( struct disk *disk,
+                                     void *private,
+                                     uint32_t length );
+/* reserves disk space for the range without changing the size of the file */
+typedef int (*FS_ALLOCATE_FUNCTION)( struct disk *disk,
+                                     void *private,
+                                     uint32_t offset,
+                                     uint32_t length );
 typedef int (*FS_SEEK_FUNCTION)( void *private,
                                  uint32_t offset,
                                  FILE_SEEK_MODE );
@@ -63,6 +77,10 @@ typedef int (*FS_STAT_FUNCTION)( struct disk *disk,
                                  void *private,
                                  struct file_stat *stat );
 typedef int (*FS_CLOSE_FUNCTION)( void *private );
+/* returns the absolute disk sector that holds the given file offset */
+typedef int (*FS_BMAP_FUNCTION)( struct disk *disk,
+                                 void *private,
+                                 uint32_t offset );
 
 struct filesystem
 {
@@ -73,6 +91,11 @@ struct filesystem
     FS_SEEK_FUNCTION seek;
     FS_STAT_FUNCTION stat;
     FS_CLOSE_FUNCTION close;
+    FS_BMAP_FUNCTION bmap;
+    /* optional, without them the filesystem is read only */
+    FS_WRITE_FUNCTION write;
+    FS_TRUNCATE_FUNCTION truncate;
+    FS_ALLOCATE_FUNCTION allocate;
 
     char name[ 20 ];
 };
@@ -84,12 +107,24 @@ int fread( void *ptr,
            uint32_t size,
            uint32_t nmemb,
            int fd );
+int fwrite( void *ptr,
+            uint32_t size,
+            uint32_t nmemb,
+            int fd );
+int ftruncate( int fd,
+               uint32_t length );
+int fallocate( int fd,
+               uint32_t offset,
+               uint32_t length );
 int fseek( int fd,
            int offset,
            FILE_SEEK_MODE whence );
 int fstat( int fd,
            struct file_stat *stat );
 int fclose( int fd );
+int fbmap( int fd,
+           uint32_t offset );
+struct disk *fdisk( int fd );
 void fs_insert_filesystem( struct filesystem *filesystem );
 struct filesystem *fs_resolve( struct disk *disk );
 
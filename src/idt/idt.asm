@@ -9,8 +9,10 @@ global idt_load
 global no_interrupt
 global enable_interrupts
 global disable_interrupts
+global wait_for_interrupt
 global isr80h_wrapper
 global interrupt_pointer_table
+global interrupt_error_code
 
 enable_interrupts:
     sti
@@ -20,6 +22,13 @@ disable_interrupts:
     cli
     ret
 
+; sleep until the next interrupt, sti only takes effect after hlt so none is missed
+wait_for_interrupt:
+    sti
+    hlt
+    cli
+    ret
+
 idt_load:
     push ebp            ; retrive state of processor
     mov ebp, esp
@@ -40,6 +49,11 @@ no_interrupt:
 %macro interrupt 1
     global int%1
     int%1:
+%if ( %1 == 8 ) || ( ( %1 >= 10 ) && ( %1 <= 14 ) ) || ( %1 == 17 )
+        ; the processor pushed an error code for this exception
+        ; keep it aside so every vector shares the same frame layout
+        pop dword [interrupt_error_code]
+%endif
         ; INTERRUPT FRAME START
         ; ALREADY PUSHED TO US BY THE PROCESSOR UPON ENTRY TO THIS INTERRUPT
         ; uint32_t ip
@@ -98,6 +112,10 @@ section .data
 tmp_res:
     dd 0
 
+; error code of the last exception that pushed one
+interrupt_error_code:
+    dd 0
+
 %macro interrupt_array_entry 1
     dd int%1
 %endmacro
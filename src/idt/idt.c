@@ -6,6 +6,11 @@
 #include "task/task.h"
 #include "status.h"
 #include "task/process.h"
+#include "memory/paging/paging.h"
+#include "memory/swap/swap.h"
+#include "memory/ksm/ksm.h"
+#include "disk/disk_cache.h"
+#include "aio/aio.h"
 
 struct idt_desc idt_descriptors[ OS_TOTAL_INTERRUPTS ];
 struct idtr_desc idtr_descriptor;
@@ -16,6 +21,7 @@ extern void no_interrupt();
 extern void isr80h_wrapper();
 
 extern void *interrupt_pointer_table[ OS_TOTAL_INTERRUPTS ];
+extern uint32_t interrupt_error_code;
 
 static INTERRUPT_CALLBACK_FUNCTION interrupt_callbacks[ OS_TOTAL_INTERRUPTS ];
 static ISR80H_COMMAND isr80h_commands[ OS_MAX_ISR80H_COMMANDS ];
@@ -26,9 +32,35 @@ void no_interrupt_handler()
     outb( 0x20, 0x20 );
 }
 
+static void idt_end_of_interrupt( int interrupt )
+{
+    /* the slave controller needs its own acknowledgement */
+    if( ( interrupt >= PIC_SLAVE_INTERRUPT_START ) && ( interrupt < PIC_SLAVE_INTERRUPT_START + 8 ) )
+    {
+        outb( PIC_SLAVE_COMMAND, PIC_END_OF_INTERRUPT );
+    }
+
+    outb( PIC_MASTER_COMMAND, PIC_END_OF_INTERRUPT );
+}
+
 void interrupt_handler( int interrupt,
                         struct interrupt_frame *frame )
 {
+    /*
+     * the kernel itself is only interrupted while it waits for a device, the saved
+     * task state and the page directory belong to the code we interrupted
+     */
+    if( frame->cs == KERNEL_CODE_SELECTOR )
+    {
+        if( interrupt_callbacks[ interrupt ] != 0 )
+        {
+            interrupt_callbacks[ interrupt ]( frame );
+        }
+
+        idt_end_of_interrupt( interrupt );
+        return;
+    }
+
     kernel_page();
 
     if( interrupt_callbacks[ interrupt ] != 0 )
@@ -40,7 +72,7 @@ void interrupt_handler( int interrupt,
     task_page();
 
     /* interrupt acknowledgement */
-    outb( 0x20, 0x20 );
+    idt_end_of_interrupt( interrupt );
 }
 
 void idt_zero()
@@ -72,6 +104,25 @@ void idt_handle_exception()
     task_next();
 }
 
+void idt_page_fault()
+{
+    void *address = paging_get_fault_address();
+
+    /* a page that is not present may only have been moved out to swap */
+    if( !( interrupt_error_code & PAGING_FAULT_PRESENT ) && ( swap_fault( task_current(), address ) == OS_OK ) )
+    {
+        return;
+    }
+
+    /* a write to a merged page gets its own copy */
+    if( ( interrupt_error_code & PAGING_FAULT_PRESENT ) && ( interrupt_error_code & PAGING_FAULT_WRITE ) && ( ksm_unshare( task_current(), address ) == OS_OK ) )
+    {
+        return;
+    }
+
+    idt_handle_exception();
+}
+
 void idt_init()
 {
     memset( idt_descriptors, 0, sizeof( idt_descriptors ) );
@@ -92,6 +143,7 @@ void idt_init()
         idt_register_interrupt_callback( i, idt_handle_exception );
     }
 
+    idt_register_interrupt_callback( 0x0E, idt_page_fault );
     idt_register_interrupt_callback( 0x20, idt_clock );
 
     /* load the interrupt descriptor table */
@@ -168,6 +220,15 @@ void idt_clock()
     /* interrupt acknowledgement */
     outb( 0x20, 0x20 );
 
+    /* merge identical process pages a few at a time, does nothing unless enabled */
+    ksm_scan();
+
+    /* write dirty disk sectors back every few seconds */
+    diskcache_writeback_tick();
+
+    /* carry on with asynchronous requests the submitters did not wait for */
+    aio_tick();
+
     /* switch to the next task */
     task_next();
 }
@@ -9,6 +9,16 @@
 #define IDT_TYPE_INTERRUPT_GATE_32BIT    0xE
 #define IDT_TYPE_TRAP_GATE_32BIT         0xF
 
+/* programmable interrupt controllers, remapped right after the hardware exceptions */
+#define PIC_MASTER_COMMAND               0x20
+#define PIC_MASTER_DATA                  0x21
+#define PIC_SLAVE_COMMAND                0xA0
+#define PIC_SLAVE_DATA                   0xA1
+#define PIC_END_OF_INTERRUPT             0x20
+#define PIC_MASTER_INTERRUPT_START       0x20
+#define PIC_SLAVE_INTERRUPT_START        0x28
+#define PIC_MASTER_CASCADE_IRQ_MASK      0b00000100
+
 #define LOWER_OFFSET_ADDRESS_MASK        0x0000FFFF
 #define UNUSED_FIELD                     0x00
 #define PRIVILEGE_LEVEL                  3 /* user space */
@@ -60,10 +70,12 @@ typedef void ( *INTERRUPT_CALLBACK_FUNCTION )();
 void idt_init();
 void enable_interrupts();
 void disable_interrupts();
+void wait_for_interrupt();
 void isr80h_register_command( int command_id,
                               ISR80H_COMMAND command );
 int idt_register_interrupt_callback( int interrupt,
                                      INTERRUPT_CALLBACK_FUNCTION interrupt_callback );
 void idt_clock();
+void idt_page_fault();
 
 #endif /* IDT_H_ */
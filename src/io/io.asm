@@ -4,6 +4,11 @@ global insb
 global insw
 global outb
 global outw
+global insl
+global outl
+global insw_rep
+global outsw_rep
+global insl_rep
 
 insb:
     push ebp
@@ -47,4 +52,73 @@ outw:
     out dx, ax
 
     pop ebp
-    ret
\ No newline at end of file
+    ret
+
+insl:
+    push ebp
+    mov ebp, esp
+
+    mov edx, [ebp+8]
+    in eax, dx
+
+    pop ebp
+    ret
+
+outl:
+    push ebp
+    mov ebp, esp
+
+    mov eax, [ebp+12]
+    mov edx, [ebp+8]
+    out dx, eax
+
+    pop ebp
+    ret
+
+; insw_rep( port, buffer, count ), count words from the port into the buffer
+insw_rep:
+    push ebp
+    mov ebp, esp
+    push edi
+
+    mov edx, [ebp+8]
+    mov edi, [ebp+12]
+    mov ecx, [ebp+16]
+    cld
+    rep insw
+
+    pop edi
+    pop ebp
+    ret
+
+; outsw_rep( port, buffer, count ), count words from the buffer to the port
+outsw_rep:
+    push ebp
+    mov ebp, esp
+    push esi
+
+    mov edx, [ebp+8]
+    mov esi, [ebp+12]
+    mov ecx, [ebp+16]
+    cld
+    rep outsw
+
+    pop esi
+    pop ebp
+    ret
+
+; insl_rep( port, buffer, count ), count double words from the port into the buffer
+insl_rep:
+    push ebp
+    mov ebp, esp
+    push edi
+
+    mov edx, [ebp+8]
+    mov edi, [ebp+12]
+    mov ecx, [ebp+16]
+    cld
+    rep insd
+
+    pop edi
+    pop ebp
+    ret
@@ -3,10 +3,23 @@
 
 unsigned char insb( unsigned short port );
 unsigned short insw( unsigned short port );
+unsigned int insl( unsigned short port );
 
 void outb( unsigned short port,
            unsigned char val );
 void outw( unsigned short port,
            unsigned short val );
+void outl( unsigned short port,
+           unsigned int val );
+
+void insw_rep( unsigned short port,
+               void *buffer,
+               unsigned int count );
+void outsw_rep( unsigned short port,
+                void *buffer,
+                unsigned int count );
+void insl_rep( unsigned short port,
+               void *buffer,
+               unsigned int count );
 
 #endif /* IO_H_ */
@@ -0,0 +1,19 @@
+#include "aio.h"
+#include "aio/aio.h"
+#include "task/task.h"
+#include "task/process.h"
+
+void *isr80h_command23_aio_setup( struct interrupt_frame *frame )
+{
+    uint32_t entries = ( uint32_t ) task_get_stack_item( task_current(), 0 );
+
+    return aio_setup( task_current()->process, entries );
+}
+
+void *isr80h_command24_aio_enter( struct interrupt_frame *frame )
+{
+    uint32_t to_submit    = ( uint32_t ) task_get_stack_item( task_current(), 0 );
+    uint32_t min_complete = ( uint32_t ) task_get_stack_item( task_current(), 1 );
+
+    return ( void * ) aio_enter( task_current()->process, to_submit, min_complete );
+}
@@ -0,0 +1,9 @@
+#ifndef ISR80H_AIO_H_
+#define ISR80H_AIO_H_
+
+struct interrupt_frame;
+
+void *isr80h_command23_aio_setup( struct interrupt_frame *frame );
+void *isr80h_command24_aio_enter( struct interrupt_frame *frame );
+
+#endif /* ISR80H_AIO_H_ */
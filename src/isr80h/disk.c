@@ -0,0 +1,102 @@
+#include "disk.h"
+#include "task/task.h"
+#include "disk/disk.h"
+#include "disk/disk_cache.h"
+#include "disk/disk_trace.h"
+#include "status.h"
+#include "config.h"
+
+void *isr80h_command17_disk_cache_stats( struct interrupt_frame *frame )
+{
+    struct disk_cache_stats stats;
+
+    diskcache_get_stats( &stats );
+
+    return ( void * ) copy_to_task( task_current(), task_get_stack_item( task_current(), 0 ), &stats, sizeof( stats ) );
+}
+
+/* write back everything cached for the drive and empty its write cache */
+void *isr80h_command18_disk_flush( struct interrupt_frame *frame )
+{
+    int drive = ( int ) task_get_stack_item( task_current(), 0 );
+
+    return ( void * ) disk_flush( disk_get( drive ) );
+}
+
+void *isr80h_command19_disk_queue_stats( struct interrupt_frame *frame )
+{
+    struct disk *disk = disk_get( ( int ) task_get_stack_item( task_current(), 0 ) );
+    struct disk_queue_stats stats;
+
+    if( !disk )
+    {
+        return ( void * ) -INVALID_ARGUMENT_ERROR;
+    }
+
+    /* the stats may straddle two pages of the process */
+    diskqueue_get_stats( &disk->queue, &stats );
+
+    return ( void * ) copy_to_task( task_current(), task_get_stack_item( task_current(), 1 ), &stats, sizeof( stats ) );
+}
+
+void *isr80h_command20_disk_set_scheduler( struct interrupt_frame *frame )
+{
+    struct disk *disk = disk_get( ( int ) task_get_stack_item( task_current(), 0 ) );
+    int scheduler = ( int ) task_get_stack_item( task_current(), 1 );
+
+    if( !disk )
+    {
+        return ( void * ) -INVALID_ARGUMENT_ERROR;
+    }
+
+    return ( void * ) diskqueue_set_scheduler( &disk->queue, scheduler );
+}
+
+/* turn the request trace on or off, the ring keeps its entries either way */
+void *isr80h_command21_disk_trace_control( struct interrupt_frame *frame )
+{
+    bool enable = task_get_stack_item( task_current(), 0 ) != 0;
+
+    return ( void * ) disktrace_enable( enable );
+}
+
+/* drain up to max trace entries into the buffer of the process, returns how many */
+void *isr80h_command22_disk_trace_read( struct interrupt_frame *frame )
+{
+    struct disk_trace_entry entry;
+    struct disk_trace_entry *entries = task_get_stack_item( task_current(), 0 );
+    int max   = ( int ) task_get_stack_item( task_current(), 1 );
+    int total = 0;
+
+    if( !entries || ( max < 0 ) )
+    {
+        return ( void * ) -INVALID_ARGUMENT_ERROR;
+    }
+
+    if( max > OS_DISK_TRACE_ENTRIES )
+    {
+        max = OS_DISK_TRACE_ENTRIES;
+    }
+
+    /* one entry at a time, every destination page is translated on its own and checked before an entry is taken */
+    while( total < max )
+    {
+        void *first = &entries[ total ];
+        void *last  = ( void * ) &entries[ total + 1 ] - 1;
+
+        if( !task_user_address_to_physical( task_current(), first, true ) || !task_user_address_to_physical( task_current(), last, true ) )
+        {
+            return ( void * ) ( total ? total : -INVALID_ARGUMENT_ERROR );
+        }
+
+        if( disktrace_read( &entry, 1 ) != 1 )
+        {
+            break;
+        }
+
+        copy_to_task( task_current(), first, &entry, sizeof( entry ) );
+        total++;
+    }
+
+    return ( void * ) total;
+}
@@ -0,0 +1,13 @@
+#ifndef ISR80H_DISK_H_
+#define ISR80H_DISK_H_
+
+struct interrupt_frame;
+
+void *isr80h_command17_disk_cache_stats( struct interrupt_frame *frame );
+void *isr80h_command18_disk_flush( struct interrupt_frame *frame );
+void *isr80h_command19_disk_queue_stats( struct interrupt_frame *frame );
+void *isr80h_command20_disk_set_scheduler( struct interrupt_frame *frame );
+void *isr80h_command21_disk_trace_control( struct interrupt_frame *frame );
+void *isr80h_command22_disk_trace_read( struct interrupt_frame *frame );
+
+#endif /* ISR80H_DISK_H_ */
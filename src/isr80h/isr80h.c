@@ -4,6 +4,9 @@
 #include "io.h"
 #include "heap.h"
 #include "process.h"
+#include "memory.h"
+#include "disk.h"
+#include "aio.h"
 
 void isr80h_register_commands()
 {
@@ -17,4 +20,19 @@ void isr80h_register_commands()
     isr80h_register_command( SYSTEM_COMMAND7_INVOKE_SYSTEM_COMMAND, isr80h_command7_invoke_system_command );
     isr80h_register_command( SYSTEM_COMMAND8_GET_PROGRAM_ARGUMENTS, isr80h_command8_get_program_arguments );
     isr80h_register_command( SYSTEM_COMMAND9_EXIT, isr80h_command9_exit );
+    isr80h_register_command( SYSTEM_COMMAND10_SWAP_STATS, isr80h_command10_swap_stats );
+    isr80h_register_command( SYSTEM_COMMAND11_ZRAM_STATS, isr80h_command11_zram_stats );
+    isr80h_register_command( SYSTEM_COMMAND12_KSM_CONTROL, isr80h_command12_ksm_control );
+    isr80h_register_command( SYSTEM_COMMAND13_KSM_STATS, isr80h_command13_ksm_stats );
+    isr80h_register_command( SYSTEM_COMMAND14_SHM_OPEN, isr80h_command14_shm_open );
+    isr80h_register_command( SYSTEM_COMMAND15_SHM_ATTACH, isr80h_command15_shm_attach );
+    isr80h_register_command( SYSTEM_COMMAND16_SHM_DETACH, isr80h_command16_shm_detach );
+    isr80h_register_command( SYSTEM_COMMAND17_DISK_CACHE_STATS, isr80h_command17_disk_cache_stats );
+    isr80h_register_command( SYSTEM_COMMAND18_DISK_FLUSH, isr80h_command18_disk_flush );
+    isr80h_register_command( SYSTEM_COMMAND19_DISK_QUEUE_STATS, isr80h_command19_disk_queue_stats );
+    isr80h_register_command( SYSTEM_COMMAND20_DISK_SET_SCHEDULER, isr80h_command20_disk_set_scheduler );
+    isr80h_register_command( SYSTEM_COMMAND21_DISK_TRACE_CONTROL, isr80h_command21_disk_trace_control );
+    isr80h_register_command( SYSTEM_COMMAND22_DISK_TRACE_READ, isr80h_command22_disk_trace_read );
+    isr80h_register_command( SYSTEM_COMMAND23_AIO_SETUP, isr80h_command23_aio_setup );
+    isr80h_register_command( SYSTEM_COMMAND24_AIO_ENTER, isr80h_command24_aio_enter );
 }
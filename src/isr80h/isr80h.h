@@ -12,7 +12,22 @@ enum systemCommands
     SYSTEM_COMMAND6_PROCESS_LOAD_START,
     SYSTEM_COMMAND7_INVOKE_SYSTEM_COMMAND,
     SYSTEM_COMMAND8_GET_PROGRAM_ARGUMENTS,
-    SYSTEM_COMMAND9_EXIT
+    SYSTEM_COMMAND9_EXIT,
+    SYSTEM_COMMAND10_SWAP_STATS,
+    SYSTEM_COMMAND11_ZRAM_STATS,
+    SYSTEM_COMMAND12_KSM_CONTROL,
+    SYSTEM_COMMAND13_KSM_STATS,
+    SYSTEM_COMMAND14_SHM_OPEN,
+    SYSTEM_COMMAND15_SHM_ATTACH,
+    SYSTEM_COMMAND16_SHM_DETACH,
+    SYSTEM_COMMAND17_DISK_CACHE_STATS,
+    SYSTEM_COMMAND18_DISK_FLUSH,
+    SYSTEM_COMMAND19_DISK_QUEUE_STATS,
+    SYSTEM_COMMAND20_DISK_SET_SCHEDULER,
+    SYSTEM_COMMAND21_DISK_TRACE_CONTROL,
+    SYSTEM_COMMAND22_DISK_TRACE_READ,
+    SYSTEM_COMMAND23_AIO_SETUP,
+    SYSTEM_COMMAND24_AIO_ENTER
 };
 
 void isr80h_register_commands();
@@ -0,0 +1,70 @@
+#include "memory.h"
+#include "task/task.h"
+#include "memory/swap/swap.h"
+#include "memory/zram/zram.h"
+#include "memory/ksm/ksm.h"
+#include "memory/shm/shm.h"
+#include "task/process.h"
+
+void *isr80h_command10_swap_stats( struct interrupt_frame *frame )
+{
+    struct swap_stats stats;
+    swap_get_stats( &stats );
+
+    return ( void * ) copy_to_task( task_current(), task_get_stack_item( task_current(), 0 ), &stats, sizeof( stats ) );
+}
+
+void *isr80h_command11_zram_stats( struct interrupt_frame *frame )
+{
+    struct zram_stats stats;
+    zram_get_stats( &stats );
+
+    return ( void * ) copy_to_task( task_current(), task_get_stack_item( task_current(), 0 ), &stats, sizeof( stats ) );
+}
+
+void *isr80h_command12_ksm_control( struct interrupt_frame *frame )
+{
+    uint32_t pages_per_tick = ( uint32_t ) task_get_stack_item( task_current(), 0 );
+
+    ksm_set_rate( pages_per_tick );
+
+    return 0;
+}
+
+void *isr80h_command13_ksm_stats( struct interrupt_frame *frame )
+{
+    struct ksm_stats stats;
+    ksm_get_stats( &stats );
+
+    return ( void * ) copy_to_task( task_current(), task_get_stack_item( task_current(), 0 ), &stats, sizeof( stats ) );
+}
+
+void *isr80h_command14_shm_open( struct interrupt_frame *frame )
+{
+    void *name_user_ptr = task_get_stack_item( task_current(), 0 );
+    size_t size         = ( size_t ) task_get_stack_item( task_current(), 1 );
+    char name[ OS_SHM_NAME_SIZE ];
+
+    int res = copy_string_from_task( task_current(), name_user_ptr, name, sizeof( name ) );
+
+    if( res < 0 )
+    {
+        return ( void * ) res;
+    }
+
+    return ( void * ) shm_open( task_current()->process, name, size );
+}
+
+void *isr80h_command15_shm_attach( struct interrupt_frame *frame )
+{
+    int handle = ( int ) task_get_stack_item( task_current(), 0 );
+
+    return shm_attach( task_current()->process, handle );
+}
+
+void *isr80h_command16_shm_detach( struct interrupt_frame *frame )
+{
+    void *ptr = task_get_stack_item( task_current(), 0 );
+
+    return ( void * ) shm_detach( task_current()->process, ptr );
+}
@@ -0,0 +1,14 @@
+#ifndef ISR80H_MEMORY_H_
+#define ISR80H_MEMORY_H_
+
+struct interrupt_frame;
+
+void *isr80h_command10_swap_stats( struct interrupt_frame *frame );
+void *isr80h_command11_zram_stats( struct interrupt_frame *frame );
+void *isr80h_command12_ksm_control( struct interrupt_frame *frame );
+void *isr80h_command13_ksm_stats( struct interrupt_frame *frame );
+void *isr80h_command14_shm_open( struct interrupt_frame *frame );
+void *isr80h_command15_shm_attach( struct interrupt_frame *frame );
+void *isr80h_command16_shm_detach( struct interrupt_frame *frame );
+
+#endif /* ISR80H_MEMORY_H_ */
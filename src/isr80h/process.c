@@ -5,6 +5,8 @@
 #include "status.h"
 #include "string/string.h"
 #include "kernel.h"
+#include "memory/memory.h"
+#include "memory/heap/kheap.h"
 
 void *isr80h_command6_process_load_start( struct interrupt_frame *frame )
 {
@@ -38,12 +40,62 @@ void *isr80h_command6_process_load_start( struct interrupt_frame *frame )
     return 0;
 }
 
+static void isr80h_free_command_arguments( struct command_argument *root_argument )
+{
+    while( root_argument )
+    {
+        struct command_argument *next = root_argument->next;
+        kfree( root_argument );
+        root_argument = next;
+    }
+}
+
+/* copy the argument list into kernel memory, its next pointers are only valid in the process address space */
+static struct command_argument *isr80h_copy_command_arguments( struct task *task,
+                                                               void *user_argument )
+{
+    struct command_argument *root_argument = 0;
+    struct command_argument *last_argument = 0;
+
+    while( user_argument )
+    {
+        /* allocate first, the allocation may swap out the page we are about to read */
+        struct command_argument *argument = kzalloc( sizeof( struct command_argument ) );
+
+        if( !argument )
+        {
+            isr80h_free_command_arguments( root_argument );
+            return 0;
+        }
+
+        struct command_argument *physical = task_virtual_address_to_physical( task, user_argument );
+
+        memcpy( argument->argument, physical->argument, sizeof( argument->argument ) );
+        argument->argument[ sizeof( argument->argument ) - 1 ] = 0x00;
+        user_argument = physical->next;
+
+        if( last_argument )
+        {
+            last_argument->next = argument;
+        }
+        else
+        {
+            root_argument = argument;
+        }
+
+        last_argument = argument;
+    }
+
+    return root_argument;
+}
+
 void *isr80h_command7_invoke_system_command( struct interrupt_frame *frame )
 {
-    struct command_argument *arguments = task_virtual_address_to_physical( task_current(), task_get_stack_item( task_current(), 0 ) );
+    struct command_argument *arguments = isr80h_copy_command_arguments( task_current(), task_get_stack_item( task_current(), 0 ) );
 
     if( !arguments || ( strlen( arguments[ 0 ].argument ) == 0 ) )
     {
+        isr80h_free_command_arguments( arguments );
         return ERROR( -INVALID_ARGUMENT_ERROR );
     }
 
@@ -59,10 +111,12 @@ void *isr80h_command7_invoke_system_command( struct interrupt_frame *frame )
 
     if( res < 0 )
     {
+        isr80h_free_command_arguments( arguments );
         return ERROR( res );
     }
 
     res = process_inject_arguments( process, root_command_argument );
+    isr80h_free_command_arguments( arguments );
 
     if( res < 0 )
     {
@@ -31,10 +31,29 @@ _start:
     mov al, 0x20        ; interrupt 0x20 is where master ISR should start
     out 0x21, al
 
+    mov al, 00000100b   ; the slave PIC hangs off IRQ2
+    out 0x21, al
+
     mov al, 00000001b   ; put PIC into x86 mode
     out 0x21, al
     ; end remap of the master PIC
 
+    ; remap the slave PIC, the disk raises IRQ14 through it
+    mov al, 00010001b   ; put PIC into init. mode
+    out 0xA0, al        ; tell slave PIC
+
+    mov al, 0x28        ; interrupt 0x28 is where slave ISR should start
+    out 0xA1, al
+
+    mov al, 00000010b   ; cascade identity of the slave
+    out 0xA1, al
+
+    mov al, 00000001b   ; put PIC into x86 mode
+    out 0xA1, al
+    ; end remap of the slave PIC
+
+    ; the boot loader leaves the address of the E820 memory map in esi
+    push esi
     call kernel_main
     
     jmp $
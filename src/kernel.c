@@ -18,6 +18,10 @@
 #include "status.h"
 #include "isr80h/isr80h.h"
 #include "keyboard/keyboard.h"
+#include "memory/swap/swap.h"
+#include "memory/zram/zram.h"
+#include "memory/ksm/ksm.h"
+#include "memory/page_cache/page_cache.h"
 
 static uint16_t *video_mem   = 0;
 static uint16_t terminal_row = 0;
@@ -141,7 +145,7 @@ struct gdt_structured gdt_structured[ OS_TOTAL_GDT_SEGMENTS ] =
     { .base = ( uint32_t ) &tss, .limit = sizeof( tss ), .type = 0xE9 }
 };
 
-void kernel_main()
+void kernel_main( struct e820_map *memory_map )
 {
     terminal_init();
 
@@ -151,8 +155,11 @@ void kernel_main()
     /* load the gdt  */
     gdt_load( gdt_real, sizeof( gdt_real ) );
 
-    /* initialize the heap */
-    kheap_init();
+    /* initialize the heap from the BIOS memory map */
+    kheap_init( memory_map );
+
+    /* cache file data in pages before anything reads a file, it is reclaimed before swapping */
+    pagecache_init();
 
     /* initialize the filesystems */
     fs_init();
@@ -163,6 +170,9 @@ void kernel_main()
     /* initialize the interrupt descriptor table */
     idt_init();
 
+    /* the disk can complete commands through IRQ14 now */
+    disk_enable_interrupts();
+
     /* setup the TSS */
     bzero( &tss, sizeof( tss ) );
     tss.esp0 = 0x600000;
@@ -189,6 +199,15 @@ void kernel_main()
     /* initialize all the system keyboard */
     keyboard_init();
 
+    /* cold process pages are compressed in memory first, then go to the swap file */
+    zram_init();
+
+    /* same page merging, the scanner is enabled by a system command */
+    ksm_init();
+
+    /* overcommit memory by swapping cold process pages to the swap file, optional */
+    swap_init( OS_SWAP_FILE );
+
     /* ====================================================================== */
     struct process *process = 0;
     int res = process_load_switch( "0:/blank.elf", &process );
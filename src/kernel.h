@@ -14,11 +14,13 @@
 
 #include <stdint.h>
 
+struct e820_map;
+
 void print( const char *str );
 void panic( const char *msg );
 void kernel_page();
 void kernel_registers();
-void kernel_main();
+void kernel_main( struct e820_map *memory_map );
 void terminal_writechar( char chr,
                          uint8_t color );
 
@@ -0,0 +1,96 @@
+#include "e820.h"
+
+bool e820_is_valid( struct e820_map *map )
+{
+    return map && ( map->total_entries > 0 ) && ( map->total_entries <= OS_E820_MAX_ENTRIES );
+}
+
+bool e820_is_usable_entry( struct e820_entry *entry )
+{
+    /* acpi 3.x: bit 0 clear means the entry should be ignored */
+    return ( entry->type == E820_TYPE_USABLE ) && ( entry->acpi_attributes & 0x01 );
+}
+
+/* clip an entry to the 32 bit address space, returns false if nothing is left */
+bool e820_clip_entry( struct e820_entry *entry,
+                      uint32_t *start_out,
+                      uint32_t *end_out )
+{
+    uint64_t start = entry->base;
+    uint64_t end   = entry->base + entry->length;
+
+    if( ( entry->length == 0 ) || ( start >= E820_ADDRESS_LIMIT ) )
+    {
+        return false;
+    }
+
+    if( end > E820_ADDRESS_LIMIT )
+    {
+        end = E820_ADDRESS_LIMIT;
+    }
+
+    *start_out = ( uint32_t ) start;
+    *end_out   = ( uint32_t ) end;
+
+    return true;
+}
+
+/* the end of the highest usable region reachable with 32 bit pointers */
+uint32_t e820_get_usable_end( struct e820_map *map )
+{
+    uint32_t usable_end = 0;
+
+    for( uint32_t idx = 0; idx < map->total_entries; idx++ )
+    {
+        uint32_t start = 0;
+        uint32_t end   = 0;
+
+        if( !e820_is_usable_entry( &map->entries[ idx ] ) || !e820_clip_entry( &map->entries[ idx ], &start, &end ) )
+        {
+            continue;
+        }
+
+        if( end > usable_end )
+        {
+            usable_end = end;
+        }
+    }
+
+    return usable_end;
+}
+
+/* true if [start, end) is covered by usable memory and no reserved region overlaps it */
+bool e820_is_range_usable( struct e820_map *map,
+                           uint32_t start,
+                           uint32_t end )
+{
+    bool covered = false;
+
+    for( uint32_t idx = 0; idx < map->total_entries; idx++ )
+    {
+        uint32_t entry_start = 0;
+        uint32_t entry_end   = 0;
+
+        if( !e820_clip_entry( &map->entries[ idx ], &entry_start, &entry_end ) )
+        {
+            continue;
+        }
+
+        if( e820_is_usable_entry( &map->entries[ idx ] ) )
+        {
+            if( ( entry_start <= start ) && ( entry_end >= end ) )
+            {
+                covered = true;
+            }
+
+            continue;
+        }
+
+        if( ( entry_start < end ) && ( entry_end > start ) )
+        {
+            return false;
+        }
+    }
+
+    return covered;
+}
@@ -0,0 +1,45 @@
+#ifndef E820_H_
+#define E820_H_
+
+#include "config.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/* memory region types reported by the BIOS (int 0x15, eax = 0xE820) */
+#define E820_TYPE_USABLE              1
+#define E820_TYPE_RESERVED            2
+#define E820_TYPE_ACPI_RECLAIMABLE    3
+#define E820_TYPE_ACPI_NVS            4
+#define E820_TYPE_BAD_MEMORY          5
+
+/* highest address we can reach with 32 bit pointers */
+#define E820_ADDRESS_LIMIT            0xFFFFF000
+
+struct e820_entry
+{
+    uint64_t base;
+    uint64_t length;
+    uint32_t type;
+    uint32_t acpi_attributes;
+}
+__attribute__( ( packed ) );
+
+/* the memory map as the boot loader leaves it at OS_E820_MAP_ADDRESS */
+struct e820_map
+{
+    uint32_t total_entries;
+    struct e820_entry entries[ OS_E820_MAX_ENTRIES ];
+}
+__attribute__( ( packed ) );
+
+bool e820_is_valid( struct e820_map *map );
+bool e820_is_usable_entry( struct e820_entry *entry );
+bool e820_clip_entry( struct e820_entry *entry,
+                      uint32_t *start_out,
+                      uint32_t *end_out );
+uint32_t e820_get_usable_end( struct e820_map *map );
+bool e820_is_range_usable( struct e820_map *map,
+                           uint32_t start,
+                           uint32_t end );
+
+#endif /* E820_H_ */
@@ -106,7 +106,8 @@ int heap_get_start_block( struct heap *heap,
         }
     }
 
-    if( block_start == -1 )
+    /* the last free run may be shorter than what we need */
+    if( ( block_start == -1 ) || ( current_block != total_blocks ) )
     {
         return -NO_MEMORY_ERROR;
     }
@@ -200,5 +201,76 @@ void *heap_malloc( struct heap *heap,
 void heap_free( struct heap *heap,
                 void *ptr )
 {
+    if( ( ptr < heap->start_addr ) || !heap_validate_alignment( ptr ) )
+    {
+        /* not one of our blocks */
+        return;
+    }
+
     heap_mark_blocks_free( heap, heap_address_to_block( heap, ptr ) );
 }
+
+static void heap_set_range( struct heap *heap,
+                            int start_block,
+                            int end_block,
+                            HEAP_BLOCK_TABLE_ENTRY entry )
+{
+    if( start_block < 0 )
+    {
+        start_block = 0;
+    }
+
+    if( end_block > ( int ) heap->table->total_entries )
+    {
+        end_block = heap->table->total_entries;
+    }
+
+    for( int block = start_block; block < end_block; block++ )
+    {
+        heap->table->entries[ block ] = entry;
+    }
+}
+
+/* mark every block touching [start, end) as permanently taken */
+void heap_reserve_range( struct heap *heap,
+                         uint32_t start,
+                         uint32_t end )
+{
+    uint32_t heap_start = ( uint32_t ) heap->start_addr;
+    uint32_t heap_end   = heap_start + ( heap->table->total_entries * OS_HEAP_BLOCK_SIZE );
+
+    if( ( end <= heap_start ) || ( start >= heap_end ) )
+    {
+        return;
+    }
+
+    start = ( start < heap_start ) ? heap_start : start;
+    end   = ( end > heap_end ) ? heap_end : end;
+
+    int start_block = ( start - heap_start ) / OS_HEAP_BLOCK_SIZE;
+    int end_block   = ( heap_align_value_to_upper( end - heap_start ) ) / OS_HEAP_BLOCK_SIZE;
+
+    heap_set_range( heap, start_block, end_block, HEAP_BLOCK_TABLE_ENTRY_TAKEN );
+}
+
+/* mark every block that lies entirely inside [start, end) as free */
+void heap_release_range( struct heap *heap,
+                         uint32_t start,
+                         uint32_t end )
+{
+    uint32_t heap_start = ( uint32_t ) heap->start_addr;
+    uint32_t heap_end   = heap_start + ( heap->table->total_entries * OS_HEAP_BLOCK_SIZE );
+
+    if( ( end <= heap_start ) || ( start >= heap_end ) )
+    {
+        return;
+    }
+
+    start = ( start < heap_start ) ? heap_start : start;
+    end   = ( end > heap_end ) ? heap_end : end;
+
+    int start_block = ( heap_align_value_to_upper( start - heap_start ) ) / OS_HEAP_BLOCK_SIZE;
+    int end_block   = ( end - heap_start ) / OS_HEAP_BLOCK_SIZE;
+
+    heap_set_range( heap, start_block, end_block, HEAP_BLOCK_TABLE_ENTRY_FREE );
+}
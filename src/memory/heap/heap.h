@@ -34,5 +34,11 @@ void *heap_malloc( struct heap *heap,
                    size_t size );
 void heap_free( struct heap *heap,
                 void *ptr );
+void heap_reserve_range( struct heap *heap,
+                         uint32_t start,
+                         uint32_t end );
+void heap_release_range( struct heap *heap,
+                         uint32_t start,
+                         uint32_t end );
 
 #endif /* HEAP_H_ */
@@ -3,30 +3,150 @@
 #include "config.h"
 #include "kernel.h"
 #include "memory/memory.h"
+#include "memory/e820/e820.h"
 
 struct heap kernel_heap;
 struct heap_table kernel_heap_table;
 
-void kheap_init()
+static KHEAP_RECLAIM_FUNCTION kheap_reclaimers[ OS_HEAP_MAX_RECLAIMERS ];
+static bool kheap_reclaiming = false;
+
+/* keep the blocks the BIOS did not report as usable out of the allocator */
+static void kheap_apply_memory_map( struct e820_map *memory_map,
+                                    uint32_t data_start,
+                                    uint32_t heap_end )
 {
-    int total_table_entries = OS_HEAP_SIZE_BYTES / OS_HEAP_BLOCK_SIZE;
+    /* start out with everything taken and open up the usable regions, reserved regions win where they overlap */
+    heap_reserve_range( &kernel_heap, data_start, heap_end );
+
+    for( uint32_t idx = 0; idx < memory_map->total_entries; idx++ )
+    {
+        struct e820_entry *entry = &memory_map->entries[ idx ];
+        uint32_t start = 0;
+        uint32_t end   = 0;
 
-    kernel_heap_table.entries       = ( HEAP_BLOCK_TABLE_ENTRY * ) OS_HEAP_TABLE_ADDRESS;
-    kernel_heap_table.total_entries = total_table_entries;
+        if( e820_is_usable_entry( entry ) && e820_clip_entry( entry, &start, &end ) )
+        {
+            heap_release_range( &kernel_heap, start, end );
+        }
+    }
 
-    void *end = ( void * ) ( OS_HEAP_ADDRESS + OS_HEAP_SIZE_BYTES );
+    for( uint32_t idx = 0; idx < memory_map->total_entries; idx++ )
+    {
+        struct e820_entry *entry = &memory_map->entries[ idx ];
+        uint32_t start = 0;
+        uint32_t end   = 0;
+
+        if( !e820_is_usable_entry( entry ) && e820_clip_entry( entry, &start, &end ) )
+        {
+            heap_reserve_range( &kernel_heap, start, end );
+        }
+    }
+}
+
+void kheap_init( struct e820_map *memory_map )
+{
+    uint32_t heap_start = OS_HEAP_ADDRESS;
+    uint32_t heap_end   = OS_HEAP_ADDRESS + OS_HEAP_SIZE_BYTES;
+    bool has_memory_map = e820_is_valid( memory_map );
+
+    if( has_memory_map )
+    {
+        /* the heap covers all the memory above OS_HEAP_ADDRESS */
+        heap_end = e820_get_usable_end( memory_map ) & ~( OS_HEAP_BLOCK_SIZE - 1 );
+    }
 
-    int res = heap_create( &kernel_heap, ( void * ) OS_HEAP_ADDRESS, end, &kernel_heap_table );
+    /* process heaps are mapped above this address, the kernel heap must stay below */
+    if( heap_end > OS_PROGRAM_VIRTUAL_HEAP_ADDRESS )
+    {
+        heap_end = OS_PROGRAM_VIRTUAL_HEAP_ADDRESS;
+    }
+
+    if( heap_end <= heap_start )
+    {
+        panic( "not enough memory for the kernel heap\n" );
+    }
+
+    /* the table sits at the start of the heap region, one entry per block */
+    uint32_t total_blocks = ( heap_end - heap_start ) / OS_HEAP_BLOCK_SIZE;
+    uint32_t table_size   = ( ( total_blocks + OS_HEAP_BLOCK_SIZE - 1 ) / OS_HEAP_BLOCK_SIZE ) * OS_HEAP_BLOCK_SIZE;
+    uint32_t data_start   = heap_start + table_size;
+
+    if( data_start >= heap_end )
+    {
+        panic( "not enough memory for the kernel heap\n" );
+    }
+
+    if( has_memory_map && !e820_is_range_usable( memory_map, heap_start, data_start ) )
+    {
+        panic( "kernel heap table is not in usable memory\n" );
+    }
+
+    kernel_heap_table.entries       = ( HEAP_BLOCK_TABLE_ENTRY * ) heap_start;
+    kernel_heap_table.total_entries = ( heap_end - data_start ) / OS_HEAP_BLOCK_SIZE;
+
+    int res = heap_create( &kernel_heap, ( void * ) data_start, ( void * ) heap_end, &kernel_heap_table );
 
     if( res < 0 )
     {
         print( "failed to create heap\n" );
+        return;
+    }
+
+    if( has_memory_map )
+    {
+        kheap_apply_memory_map( memory_map, data_start, heap_end );
+    }
+}
+
+/* cheap reclaimers should register first, they are asked before the others */
+void kheap_register_reclaim( KHEAP_RECLAIM_FUNCTION reclaim )
+{
+    for( int idx = 0; idx < OS_HEAP_MAX_RECLAIMERS; idx++ )
+    {
+        if( !kheap_reclaimers[ idx ] )
+        {
+            kheap_reclaimers[ idx ] = reclaim;
+            return;
+        }
+    }
+}
+
+static int kheap_reclaim( size_t size )
+{
+    for( int idx = 0; idx < OS_HEAP_MAX_RECLAIMERS && kheap_reclaimers[ idx ]; idx++ )
+    {
+        int released = kheap_reclaimers[ idx ]( size );
+
+        if( released > 0 )
+        {
+            return released;
+        }
     }
+
+    return 0;
 }
 
 void *kmalloc( size_t size )
 {
-    return heap_malloc( &kernel_heap, size );
+    void *ptr = heap_malloc( &kernel_heap, size );
+
+    /* out of memory, let the reclaimer free pages and try again */
+    while( !ptr && size && kheap_reclaimers[ 0 ] && !kheap_reclaiming )
+    {
+        kheap_reclaiming = true;
+        int released = kheap_reclaim( size );
+        kheap_reclaiming = false;
+
+        if( released <= 0 )
+        {
+            break;
+        }
+
+        ptr = heap_malloc( &kernel_heap, size );
+    }
+
+    return ptr;
 }
 
 void kfree( void *ptr )
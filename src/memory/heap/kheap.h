@@ -3,7 +3,13 @@
 
 #include <stddef.h>
 
-void kheap_init();
+struct e820_map;
+
+/* frees memory under pressure, returns the number of pages released */
+typedef int (*KHEAP_RECLAIM_FUNCTION)( size_t size );
+
+void kheap_init( struct e820_map *memory_map );
+void kheap_register_reclaim( KHEAP_RECLAIM_FUNCTION reclaim );
 void *kmalloc( size_t size );
 void kfree( void *ptr );
 void *kzalloc( size_t size );
@@ -0,0 +1,432 @@
+#include "ksm.h"
+#include "config.h"
+#include "status.h"
+#include "task/task.h"
+#include "task/process.h"
+#include "memory/memory.h"
+#include "memory/heap/kheap.h"
+#include "memory/swap/swap.h"
+#include "time/tsc.h"
+
+struct ksm ksm;
+
+static void ksm_clear_unstable()
+{
+    bzero( ksm.unstable, sizeof( struct ksm_candidate ) * OS_KSM_UNSTABLE_SLOTS );
+}
+
+/* merge identical process heap pages, the scanner stays off until a rate is set */
+int ksm_init()
+{
+    int res = OS_OK;
+
+    bzero( &ksm, sizeof( ksm ) );
+
+    ksm.frames   = kzalloc( sizeof( struct ksm_frame ) * OS_KSM_MAX_FRAMES );
+    ksm.buckets  = kzalloc( sizeof( int16_t ) * OS_KSM_HASH_BUCKETS );
+    ksm.unstable = kzalloc( sizeof( struct ksm_candidate ) * OS_KSM_UNSTABLE_SLOTS );
+
+    if( !ksm.frames || !ksm.buckets || !ksm.unstable )
+    {
+        res = -NO_MEMORY_ERROR;
+        kfree( ksm.frames );
+        kfree( ksm.buckets );
+        kfree( ksm.unstable );
+        bzero( &ksm, sizeof( ksm ) );
+        return res;
+    }
+
+    for( int idx = 0; idx < OS_KSM_HASH_BUCKETS; idx++ )
+    {
+        ksm.buckets[ idx ] = -1;
+    }
+
+    return res;
+}
+
+static bool ksm_is_enabled()
+{
+    return ksm.frames != 0;
+}
+
+void ksm_set_rate( uint32_t pages_per_tick )
+{
+    if( pages_per_tick > OS_KSM_MAX_PAGES_PER_TICK )
+    {
+        pages_per_tick = OS_KSM_MAX_PAGES_PER_TICK;
+    }
+
+    ksm.pages_per_tick       = pages_per_tick;
+    ksm.stats.pages_per_tick = pages_per_tick;
+}
+
+static uint32_t ksm_checksum( void *frame )
+{
+    uint32_t *words = frame;
+    uint32_t hash   = 2166136261U;
+
+    for( int idx = 0; idx < PAGING_PAGE_SIZE / sizeof( uint32_t ); idx++ )
+    {
+        hash = ( hash ^ words[ idx ] ) * 16777619U;
+    }
+
+    return hash;
+}
+
+static uint32_t *ksm_get_entry( struct process *process,
+                                void *virtual )
+{
+    return paging_get_entry( paging_chunk_get_directory( process->task->page_directory ), virtual );
+}
+
+static int ksm_find_stable( void *frame,
+                            uint32_t checksum )
+{
+    for( int index = ksm.buckets[ checksum % OS_KSM_HASH_BUCKETS ]; index >= 0; index = ksm.frames[ index ].next )
+    {
+        struct ksm_frame *shared = &ksm.frames[ index ];
+
+        if( ( shared->checksum == checksum ) && ( memcmp( shared->frame, frame, PAGING_PAGE_SIZE ) == 0 ) )
+        {
+            return index;
+        }
+    }
+
+    return -INVALID_ARGUMENT_ERROR;
+}
+
+static int ksm_find_frame( void *frame )
+{
+    for( int index = 0; index < OS_KSM_MAX_FRAMES; index++ )
+    {
+        if( ksm.frames[ index ].frame == frame )
+        {
+            return index;
+        }
+    }
+
+    return -INVALID_ARGUMENT_ERROR;
+}
+
+static int ksm_alloc_frame( void *frame,
+                            uint32_t checksum )
+{
+    for( int index = 0; index < OS_KSM_MAX_FRAMES; index++ )
+    {
+        struct ksm_frame *shared = &ksm.frames[ index ];
+
+        if( shared->frame )
+        {
+            continue;
+        }
+
+        uint32_t bucket = checksum % OS_KSM_HASH_BUCKETS;
+
+        shared->frame        = frame;
+        shared->checksum     = checksum;
+        shared->references   = 0;
+        shared->next         = ksm.buckets[ bucket ];
+        ksm.buckets[ bucket ] = index;
+        ksm.stats.pages_shared++;
+
+        return index;
+    }
+
+    return -NO_MEMORY_ERROR;
+}
+
+/* forget a shared frame, the frame itself is left to the caller */
+static void ksm_free_frame( int index )
+{
+    struct ksm_frame *shared = &ksm.frames[ index ];
+    int16_t *link = &ksm.buckets[ shared->checksum % OS_KSM_HASH_BUCKETS ];
+
+    while( *link >= 0 )
+    {
+        if( *link == index )
+        {
+            *link = shared->next;
+            break;
+        }
+
+        link = &ksm.frames[ *link ].next;
+    }
+
+    shared->frame = 0;
+    ksm.stats.pages_shared--;
+}
+
+static void ksm_map_merged( struct process *process,
+                            void *virtual,
+                            uint32_t *entry,
+                            int index )
+{
+    /* a copy in the swap file would be stale once the page is shared */
+    swap_release( process, virtual, *entry );
+
+    *entry = ( uint32_t ) ksm.frames[ index ].frame | KSM_PAGE_FLAGS;
+    ksm.frames[ index ].references++;
+    ksm.stats.pages_sharing++;
+}
+
+/* the candidate and the scanned page match, the candidate frame becomes the shared one */
+static int ksm_merge_candidate( struct ksm_candidate *candidate,
+                                struct process *process,
+                                void *virtual,
+                                uint32_t *entry )
+{
+    int res = OS_OK;
+    struct process *other = process_get( candidate->process_id );
+    void *frame           = ( void * ) ( *entry & PAGING_ADDRESS_MASK );
+
+    if( !other || !other->task )
+    {
+        res = -INVALID_ARGUMENT_ERROR;
+        return res;
+    }
+
+    uint32_t *other_entry = ksm_get_entry( other, ( void * ) candidate->virtual );
+
+    if( !other_entry || !( *other_entry & PAGING_IS_PRESENT ) || ( *other_entry & PAGING_IS_MERGED ) )
+    {
+        res = -INVALID_ARGUMENT_ERROR;
+        return res;
+    }
+
+    void *shared = ( void * ) ( *other_entry & PAGING_ADDRESS_MASK );
+
+    /* the candidate may have been written or unmapped since it was hashed */
+    if( ( shared == frame ) || ( memcmp( shared, frame, PAGING_PAGE_SIZE ) != 0 ) )
+    {
+        res = -INVALID_ARGUMENT_ERROR;
+        return res;
+    }
+
+    int index = ksm_alloc_frame( shared, candidate->checksum );
+
+    if( index < 0 )
+    {
+        res = index;
+        return res;
+    }
+
+    ksm_map_merged( other, ( void * ) candidate->virtual, other_entry, index );
+    ksm_map_merged( process, virtual, entry, index );
+    kfree( frame );
+
+    return res;
+}
+
+static void ksm_scan_page( struct process *process,
+                           void *virtual )
+{
+    uint32_t *entry = ksm_get_entry( process, virtual );
+
+    if( !entry || !( *entry & PAGING_IS_PRESENT ) || ( *entry & PAGING_IS_MERGED ) )
+    {
+        return;
+    }
+
+    void *frame       = ( void * ) ( *entry & PAGING_ADDRESS_MASK );
+    uint32_t checksum = ksm_checksum( frame );
+    int index         = ksm_find_stable( frame, checksum );
+
+    ksm.stats.pages_scanned++;
+    ksm.scanned_this_pass++;
+
+    if( index >= 0 )
+    {
+        ksm_map_merged( process, virtual, entry, index );
+        kfree( frame );
+        return;
+    }
+
+    struct ksm_candidate *candidate = &ksm.unstable[ checksum % OS_KSM_UNSTABLE_SLOTS ];
+
+    if( candidate->valid && ( candidate->checksum == checksum ) && ( ksm_merge_candidate( candidate, process, virtual, entry ) == OS_OK ) )
+    {
+        candidate->valid = false;
+        return;
+    }
+
+    candidate->virtual    = ( uint32_t ) virtual;
+    candidate->checksum   = checksum;
+    candidate->process_id = process->id;
+    candidate->valid      = true;
+}
+
+static void ksm_advance_allocation()
+{
+    ksm.hand_page = 0;
+    ksm.hand_allocation++;
+
+    if( ksm.hand_allocation < OS_MAX_PROGRAMS_ALLOCATIONS )
+    {
+        return;
+    }
+
+    ksm.hand_allocation = 0;
+    ksm.hand_process++;
+
+    if( ksm.hand_process < OS_MAX_PROCESSES )
+    {
+        return;
+    }
+
+    /* a pass is over, candidates from it may have changed since they were hashed */
+    ksm.hand_process = 0;
+    ksm_clear_unstable();
+
+    if( ksm.scanned_this_pass )
+    {
+        ksm.stats.full_scans++;
+        ksm.scanned_this_pass = 0;
+    }
+}
+
+/* next heap page under the cursor, gives up after wrapping around once */
+static int ksm_next_page( struct process **process_out,
+                          void **virtual_out )
+{
+    bool wrapped = false;
+
+    while( !wrapped )
+    {
+        struct process *process = process_get( ksm.hand_process );
+
+        if( !process || !process->task )
+        {
+            ksm.hand_allocation = OS_MAX_PROGRAMS_ALLOCATIONS;
+            wrapped = ksm.hand_process == OS_MAX_PROCESSES - 1;
+            ksm_advance_allocation();
+            continue;
+        }
+
+        struct process_allocation *allocation = &process->allocations[ ksm.hand_allocation ];
+        int total_pages = ( uint32_t ) paging_align_address( ( void * ) allocation->size ) / PAGING_PAGE_SIZE;
+
+        if( !allocation->ptr || ( ksm.hand_page >= total_pages ) )
+        {
+            wrapped = ( ksm.hand_process == OS_MAX_PROCESSES - 1 ) && ( ksm.hand_allocation == OS_MAX_PROGRAMS_ALLOCATIONS - 1 );
+            ksm_advance_allocation();
+            continue;
+        }
+
+        *process_out = process;
+        *virtual_out = allocation->ptr + ( ksm.hand_page * PAGING_PAGE_SIZE );
+        ksm.hand_page++;
+
+        return OS_OK;
+    }
+
+    return -NO_MEMORY_ERROR;
+}
+
+/* called on every clock tick, looks at a handful of pages so the cost is spread out */
+void ksm_scan()
+{
+    if( !ksm_is_enabled() || !ksm.pages_per_tick )
+    {
+        return;
+    }
+
+    uint64_t start = tsc_read();
+
+    for( uint32_t idx = 0; idx < ksm.pages_per_tick; idx++ )
+    {
+        struct process *process = 0;
+        void *virtual = 0;
+
+        if( ksm_next_page( &process, &virtual ) < 0 )
+        {
+            break;
+        }
+
+        ksm_scan_page( process, virtual );
+    }
+
+    ksm.stats.scan_cycles += tsc_read() - start;
+}
+
+/* give the task a private writable copy of a merged page */
+int ksm_unshare( struct task *task,
+                 void *virtual )
+{
+    int res = OS_OK;
+
+    if( !ksm_is_enabled() || !task )
+    {
+        res = -INVALID_ARGUMENT_ERROR;
+        return res;
+    }
+
+    uint32_t *entry = paging_get_entry( paging_chunk_get_directory( task->page_directory ), paging_align_to_lower_page( virtual ) );
+
+    if( !entry || !( *entry & PAGING_IS_PRESENT ) || !( *entry & PAGING_IS_MERGED ) )
+    {
+        res = -INVALID_ARGUMENT_ERROR;
+        return res;
+    }
+
+    void *frame = ( void * ) ( *entry & PAGING_ADDRESS_MASK );
+    int index   = ksm_find_frame( frame );
+
+    if( index < 0 )
+    {
+        res = index;
+        return res;
+    }
+
+    /* the last user simply takes the frame over */
+    if( ksm.frames[ index ].references == 1 )
+    {
+        ksm_free_frame( index );
+    }
+    else
+    {
+        void *copy = kzalloc( PAGING_PAGE_SIZE );
+
+        if( !copy )
+        {
+            res = -NO_MEMORY_ERROR;
+            return res;
+        }
+
+        memcpy( copy, frame, PAGING_PAGE_SIZE );
+        ksm.frames[ index ].references--;
+        frame = copy;
+    }
+
+    *entry = ( uint32_t ) frame | SWAP_PAGE_FLAGS | PAGING_IS_ACCESSED | PAGING_IS_DIRTY;
+    ksm.stats.pages_sharing--;
+    ksm.stats.cow_breaks++;
+
+    return res;
+}
+
+/* a merged page is being unmapped, the frame goes back to the heap with its last user */
+void ksm_release( void *frame )
+{
+    int index = ksm_find_frame( frame );
+
+    if( index < 0 )
+    {
+        return;
+    }
+
+    ksm.stats.pages_sharing--;
+    ksm.frames[ index ].references--;
+
+    if( ksm.frames[ index ].references == 0 )
+    {
+        ksm_free_frame( index );
+        kfree( frame );
+    }
+}
+
+void ksm_get_stats( struct ksm_stats *stats )
+{
+    ksm.stats.saved_bytes = ( ksm.stats.pages_sharing - ksm.stats.pages_shared ) * PAGING_PAGE_SIZE;
+
+    memcpy( stats, &ksm.stats, sizeof( struct ksm_stats ) );
+}
@@ -0,0 +1,75 @@
+#ifndef KSM_H_
+#define KSM_H_
+
+#include "memory/paging/paging.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/* merged pages are mapped read only, the first write gets a private copy */
+#define KSM_PAGE_FLAGS    ( PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL | PAGING_IS_MERGED )
+
+struct task;
+
+/* a frame shared by every page with the same contents */
+struct ksm_frame
+{
+    void *frame;
+    uint32_t checksum;
+    uint16_t references;
+    /* next frame in the same hash bucket, -1 ends the chain */
+    int16_t next;
+};
+
+/* a page seen during the current pass, merged when another page with the same contents shows up */
+struct ksm_candidate
+{
+    uint32_t virtual;
+    uint32_t checksum;
+    uint16_t process_id;
+    bool valid;
+};
+
+struct ksm_stats
+{
+    /* pages looked at per clock tick, zero when the scanner is off */
+    uint32_t pages_per_tick;
+    uint32_t pages_scanned;
+    /* complete passes over the heap pages of every process */
+    uint32_t full_scans;
+    /* shared frames in use */
+    uint32_t pages_shared;
+    /* process pages mapped to a shared frame */
+    uint32_t pages_sharing;
+    /* memory given back to the heap by merging */
+    uint32_t saved_bytes;
+    /* writes that had to copy a shared frame */
+    uint32_t cow_breaks;
+    uint64_t scan_cycles;
+};
+
+struct ksm
+{
+    struct ksm_frame *frames;
+    int16_t *buckets;
+    struct ksm_candidate *unstable;
+
+    uint32_t pages_per_tick;
+
+    /* scan cursor over the heap pages of all processes */
+    int hand_process;
+    int hand_allocation;
+    int hand_page;
+    uint32_t scanned_this_pass;
+
+    struct ksm_stats stats;
+};
+
+int ksm_init();
+void ksm_set_rate( uint32_t pages_per_tick );
+void ksm_scan();
+int ksm_unshare( struct task *task,
+                 void *virtual );
+void ksm_release( void *frame );
+void ksm_get_stats( struct ksm_stats *stats );
+
+#endif /* KSM_H_ */
@@ -1,4 +1,5 @@
 #include "memory.h"
+#include <stdint.h>
 
 void *memset( void *ptr,
               int chr,
@@ -52,7 +53,22 @@ void *memcpy( void *dest,
     char *temp1 = dest;
     char *temp2 = src;
 
-    while( len-- )
+    /* whole double words while both sides are aligned alike, sectors and pages always are */
+    if( ( ( ( uint32_t ) temp1 | ( uint32_t ) temp2 ) & 0x03 ) == 0 )
+    {
+        uint32_t *word1 = ( uint32_t * ) temp1;
+        uint32_t *word2 = ( uint32_t * ) temp2;
+
+        for( ; len >= 4; len -= 4 )
+        {
+            *word1++ = *word2++;
+        }
+
+        temp1 = ( char * ) word1;
+        temp2 = ( char * ) word2;
+    }
+
+    while( len-- > 0 )
     {
         *temp1++ = *temp2++;
     }
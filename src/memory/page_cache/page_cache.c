@@ -0,0 +1,267 @@
+#include "page_cache.h"
+#include "config.h"
+#include "status.h"
+#include "memory/memory.h"
+#include "memory/heap/kheap.h"
+#include "memory/paging/paging.h"
+
+static struct page_cache page_cache;
+
+/* file data cached in whole pages, shared by every reader of the file */
+int pagecache_init()
+{
+    int res = OS_OK;
+
+    bzero( &page_cache, sizeof( page_cache ) );
+
+    page_cache.pages = kzalloc( sizeof( struct page_cache_page ) * OS_PAGE_CACHE_MAX_PAGES );
+
+    if( !page_cache.pages )
+    {
+        res = -NO_MEMORY_ERROR;
+        return res;
+    }
+
+    for( int idx = 0; idx < OS_PAGE_CACHE_MAX_PAGES; idx++ )
+    {
+        page_cache.pages[ idx ].next = page_cache.free_pages;
+        page_cache.free_pages        = &page_cache.pages[ idx ];
+    }
+
+    page_cache.stats.total_pages = OS_PAGE_CACHE_MAX_PAGES;
+
+    /* clean file pages are the cheapest memory to give back, ask before swapping */
+    kheap_register_reclaim( pagecache_reclaim );
+
+    return res;
+}
+
+static bool pagecache_is_enabled()
+{
+    return page_cache.pages != 0;
+}
+
+static uint32_t pagecache_hash( uint32_t device,
+                                uint32_t file,
+                                uint32_t index )
+{
+    return ( ( file * 2654435761U ) + ( device * 40503U ) + index ) % OS_PAGE_CACHE_BUCKETS;
+}
+
+static void pagecache_lru_unlink( struct page_cache_page *page )
+{
+    if( page->lru_prev )
+    {
+        page->lru_prev->lru_next = page->lru_next;
+    }
+    else
+    {
+        page_cache.lru_head = page->lru_next;
+    }
+
+    if( page->lru_next )
+    {
+        page->lru_next->lru_prev = page->lru_prev;
+    }
+    else
+    {
+        page_cache.lru_tail = page->lru_prev;
+    }
+
+    page->lru_prev = 0;
+    page->lru_next = 0;
+}
+
+static void pagecache_lru_append( struct page_cache_page *page )
+{
+    page->lru_prev = page_cache.lru_tail;
+    page->lru_next = 0;
+
+    if( page_cache.lru_tail )
+    {
+        page_cache.lru_tail->lru_next = page;
+    }
+    else
+    {
+        page_cache.lru_head = page;
+    }
+
+    page_cache.lru_tail = page;
+}
+
+static struct page_cache_page **pagecache_find( uint32_t device,
+                                                uint32_t file,
+                                                uint32_t index )
+{
+    struct page_cache_page **link = &page_cache.buckets[ pagecache_hash( device, file, index ) ];
+
+    for( ; *link; link = &( *link )->next )
+    {
+        if( ( ( *link )->device == device ) && ( ( *link )->file == file ) && ( ( *link )->index == index ) )
+        {
+            break;
+        }
+    }
+
+    return link;
+}
+
+/* take the page out of the cache, its data stays with it */
+static void pagecache_unlink( struct page_cache_page *page )
+{
+    struct page_cache_page **link = pagecache_find( page->device, page->file, page->index );
+
+    if( *link )
+    {
+        *link = page->next;
+    }
+
+    pagecache_lru_unlink( page );
+    page_cache.stats.cached_pages--;
+}
+
+static void pagecache_release( struct page_cache_page *page )
+{
+    pagecache_unlink( page );
+    kfree( page->data );
+    page->data            = 0;
+    page->next            = page_cache.free_pages;
+    page_cache.free_pages = page;
+}
+
+/* returns the cached data of the page, or zero on a miss */
+void *pagecache_lookup( uint32_t device,
+                        uint32_t file,
+                        uint32_t index )
+{
+    if( !pagecache_is_enabled() )
+    {
+        return 0;
+    }
+
+    struct page_cache_page *page = *pagecache_find( device, file, index );
+
+    if( !page )
+    {
+        page_cache.stats.misses++;
+        return 0;
+    }
+
+    pagecache_lru_unlink( page );
+    pagecache_lru_append( page );
+    page_cache.stats.hits++;
+
+    return page->data;
+}
+
+/* a zeroed page for the caller to fill, the least recently used page makes room when full */
+void *pagecache_insert( uint32_t device,
+                        uint32_t file,
+                        uint32_t index )
+{
+    struct page_cache_page *page = 0;
+
+    if( !pagecache_is_enabled() )
+    {
+        return 0;
+    }
+
+    pagecache_remove( device, file, index );
+
+    if( page_cache.free_pages )
+    {
+        page = page_cache.free_pages;
+        page->data = kzalloc( PAGING_PAGE_SIZE );
+
+        if( !page->data )
+        {
+            return 0;
+        }
+
+        page_cache.free_pages = page->next;
+    }
+    else
+    {
+        /* reuse the data of the oldest page */
+        page = page_cache.lru_head;
+
+        if( !page )
+        {
+            return 0;
+        }
+
+        pagecache_unlink( page );
+        bzero( page->data, PAGING_PAGE_SIZE );
+        page_cache.stats.evictions++;
+    }
+
+    uint32_t bucket = pagecache_hash( device, file, index );
+
+    page->device = device;
+    page->file   = file;
+    page->index  = index;
+    page->next   = page_cache.buckets[ bucket ];
+    page_cache.buckets[ bucket ] = page;
+    pagecache_lru_append( page );
+    page_cache.stats.cached_pages++;
+
+    return page->data;
+}
+
+void pagecache_remove( uint32_t device,
+                       uint32_t file,
+                       uint32_t index )
+{
+    if( !pagecache_is_enabled() )
+    {
+        return;
+    }
+
+    struct page_cache_page *page = *pagecache_find( device, file, index );
+
+    if( page )
+    {
+        pagecache_release( page );
+    }
+}
+
+/* drop every page of the file, it changed on the disk */
+void pagecache_invalidate( uint32_t device,
+                           uint32_t file )
+{
+    struct page_cache_page *page = page_cache.lru_head;
+
+    while( page )
+    {
+        struct page_cache_page *next = page->lru_next;
+
+        if( ( page->device == device ) && ( page->file == file ) )
+        {
+            pagecache_release( page );
+        }
+
+        page = next;
+    }
+}
+
+/* give the least recently used pages back to the heap, returns the number of pages freed */
+int pagecache_reclaim( size_t size )
+{
+    int released    = 0;
+    int total_pages = ( uint32_t ) paging_align_address( ( void * ) size ) / PAGING_PAGE_SIZE;
+
+    /* the newest page may be in the middle of being filled, it is never taken */
+    while( ( released < total_pages ) && page_cache.lru_head && ( page_cache.lru_head != page_cache.lru_tail ) )
+    {
+        pagecache_release( page_cache.lru_head );
+        page_cache.stats.reclaimed++;
+        released++;
+    }
+
+    return released;
+}
+
+void pagecache_get_stats( struct page_cache_stats *stats )
+{
+    memcpy( stats, &page_cache.stats, sizeof( struct page_cache_stats ) );
+}
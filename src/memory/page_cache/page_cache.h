@@ -0,0 +1,64 @@
+#ifndef PAGE_CACHE_H_
+#define PAGE_CACHE_H_
+
+#include "config.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/* one page of file data */
+struct page_cache_page
+{
+    /* the disk and the file on it, with the page index in the file */
+    uint32_t device;
+    uint32_t file;
+    uint32_t index;
+    void *data;
+
+    /* next page in the same hash bucket */
+    struct page_cache_page *next;
+    /* least recently used first */
+    struct page_cache_page *lru_prev;
+    struct page_cache_page *lru_next;
+};
+
+struct page_cache_stats
+{
+    uint32_t total_pages;
+    uint32_t cached_pages;
+    uint32_t hits;
+    uint32_t misses;
+    /* pages replaced to make room for others */
+    uint32_t evictions;
+    /* pages given back to the heap under memory pressure */
+    uint32_t reclaimed;
+};
+
+struct page_cache
+{
+    struct page_cache_page *pages;
+    /* descriptors without data */
+    struct page_cache_page *free_pages;
+    struct page_cache_page *buckets[ OS_PAGE_CACHE_BUCKETS ];
+    struct page_cache_page *lru_head;
+    struct page_cache_page *lru_tail;
+
+    struct page_cache_stats stats;
+};
+
+int pagecache_init();
+void *pagecache_lookup( uint32_t device,
+                        uint32_t file,
+                        uint32_t index );
+void *pagecache_insert( uint32_t device,
+                        uint32_t file,
+                        uint32_t index );
+void pagecache_remove( uint32_t device,
+                       uint32_t file,
+                       uint32_t index );
+void pagecache_invalidate( uint32_t device,
+                           uint32_t file );
+int pagecache_reclaim( size_t size );
+void pagecache_get_stats( struct page_cache_stats *stats );
+
+#endif /* PAGE_CACHE_H_ */
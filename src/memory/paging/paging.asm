@@ -4,6 +4,7 @@ section .asm
 
 global paging_load_directory
 global enable_paging
+global paging_get_fault_address
 
 paging_load_directory:
     push ebp
@@ -20,4 +21,12 @@ enable_paging:
     or eax, 0x80000000
     mov cr0, eax
     pop ebp
+    ret
+
+; void *paging_get_fault_address();
+paging_get_fault_address:
+    push ebp
+    mov ebp, esp
+    mov eax, cr2
+    pop ebp
     ret
\ No newline at end of file
@@ -214,6 +214,24 @@ uint32_t paging_get( uint32_t *directory,
     return table[ table_index ];
 }
 
+/* the page table entry itself, so callers can test and update its bits in place */
+uint32_t *paging_get_entry( uint32_t *directory,
+                            void *virtual )
+{
+    uint32_t directory_index = 0;
+    uint32_t table_index     = 0;
+
+    if( paging_get_indexes( virtual, &directory_index, &table_index ) < 0 )
+    {
+        return 0;
+    }
+
+    uint32_t entry  = directory[ directory_index ];
+    uint32_t *table = ( uint32_t * ) ( entry & PAGING_ADDRESS_MASK );
+
+    return &table[ table_index ];
+}
+
 void *paging_get_physical_address( uint32_t *directory,
                                    void *virtual_address )
 {
@@ -4,12 +4,25 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#define PAGING_IS_DIRTY                 0b01000000
+#define PAGING_IS_ACCESSED              0b00100000
 #define PAGING_CACHE_DISABLE            0b00010000
 #define PAGING_WRITE_THORUGH            0b00001000
 #define PAGING_ACCESS_FROM_ALL          0b00000100
 #define PAGING_IS_WRITEABLE             0b00000010
 #define PAGING_IS_PRESENT               0b00000001
 
+/* bits 9 - 11 are ignored by the processor and left to the kernel */
+#define PAGING_IS_SWAPPED               0b001000000000 /* not present, bits 12 - 31 hold the swap slot */
+#define PAGING_IS_SWAP_CACHED           0b010000000000 /* present, a swap slot still holds a copy of the page */
+#define PAGING_IS_COMPRESSED            0b100000000000 /* not present, bits 12 - 31 hold the zram handle */
+#define PAGING_IS_MERGED                0b100000000000 /* present, read only frame shared by identical pages */
+
+/* page fault error code bits */
+#define PAGING_FAULT_PRESENT            0b00000001
+#define PAGING_FAULT_WRITE              0b00000010
+#define PAGING_FAULT_USER               0b00000100
+
 #define PAGING_TOTAL_ENTRY_PER_TABLE    1024
 #define PAGING_PAGE_SIZE                4096
 
@@ -47,9 +60,12 @@ void *paging_align_address( void *ptr );
 void *paging_align_to_lower_page( void *addr );
 uint32_t paging_get( uint32_t *directory,
                      void *virtual );
+uint32_t *paging_get_entry( uint32_t *directory,
+                            void *virtual );
 void *paging_get_physical_address( uint32_t *directory,
                                    void *virtual_address );
 
 void enable_paging();
+void *paging_get_fault_address();
 
 #endif /* PAGING_H_ */
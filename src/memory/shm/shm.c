@@ -0,0 +1,281 @@
+#include "shm.h"
+#include "status.h"
+#include "task/task.h"
+#include "task/process.h"
+#include "string/string.h"
+#include "memory/memory.h"
+#include "memory/heap/kheap.h"
+
+static struct shm_segment shm_segments[ OS_MAX_SHM_SEGMENTS ];
+
+static bool shm_is_valid_handle( int handle )
+{
+    return ( handle >= 0 ) && ( handle < OS_MAX_SHM_SEGMENTS ) && shm_segments[ handle ].in_use;
+}
+
+static int shm_find_by_name( const char *name )
+{
+    for( int handle = 0; handle < OS_MAX_SHM_SEGMENTS; handle++ )
+    {
+        struct shm_segment *segment = &shm_segments[ handle ];
+
+        if( segment->in_use && segment->name[ 0 ] && ( strncmp( segment->name, name, sizeof( segment->name ) ) == 0 ) )
+        {
+            return handle;
+        }
+    }
+
+    return -BAD_PATH_ERROR;
+}
+
+static void shm_destroy( int handle )
+{
+    struct shm_segment *segment = &shm_segments[ handle ];
+
+    kfree( segment->memory );
+    bzero( segment, sizeof( struct shm_segment ) );
+}
+
+static int shm_create( struct process *process,
+                       const char *name,
+                       size_t size )
+{
+    int res = OS_OK;
+
+    for( int handle = 0; handle < OS_MAX_SHM_SEGMENTS; handle++ )
+    {
+        struct shm_segment *segment = &shm_segments[ handle ];
+
+        if( segment->in_use )
+        {
+            continue;
+        }
+
+        segment->size   = ( uint32_t ) paging_align_address( ( void * ) size );
+        segment->memory = kzalloc( segment->size );
+
+        if( !segment->memory )
+        {
+            res = -NO_MEMORY_ERROR;
+            bzero( segment, sizeof( struct shm_segment ) );
+            return res;
+        }
+
+        strncpy( segment->name, name, sizeof( segment->name ) );
+        segment->name[ sizeof( segment->name ) - 1 ] = 0x00;
+        segment->creator = process->id;
+        segment->in_use  = true;
+
+        return handle;
+    }
+
+    res = -NO_MEMORY_ERROR;
+    return res;
+}
+
+/*
+ * returns the handle of the segment with the given name, creating it when there is none,
+ * an empty name always creates a new segment that is shared by passing its handle around
+ */
+int shm_open( struct process *process,
+              const char *name,
+              size_t size )
+{
+    int res = OS_OK;
+
+    if( name[ 0 ] )
+    {
+        res = shm_find_by_name( name );
+
+        if( res >= 0 )
+        {
+            return ( size <= shm_segments[ res ].size ) ? res : -INVALID_ARGUMENT_ERROR;
+        }
+    }
+
+    if( ( size == 0 ) || ( size > OS_SHM_MAX_SIZE ) )
+    {
+        res = -INVALID_ARGUMENT_ERROR;
+        return res;
+    }
+
+    return shm_create( process, name, size );
+}
+
+/* kernel address of the segment memory, the kernel is identity mapped */
+void *shm_get_memory( int handle )
+{
+    return shm_is_valid_handle( handle ) ? shm_segments[ handle ].memory : 0;
+}
+
+/* a reference held by the kernel itself, the segment outlives every detach until it is released */
+int shm_reference( int handle )
+{
+    if( !shm_is_valid_handle( handle ) )
+    {
+        return -INVALID_ARGUMENT_ERROR;
+    }
+
+    shm_segments[ handle ].references++;
+
+    return OS_OK;
+}
+
+void shm_release( int handle )
+{
+    if( !shm_is_valid_handle( handle ) )
+    {
+        return;
+    }
+
+    shm_segments[ handle ].references--;
+
+    if( shm_segments[ handle ].references == 0 )
+    {
+        shm_destroy( handle );
+    }
+}
+
+static int shm_find_free_attachment_index( struct process *process )
+{
+    for( int idx = 0; idx < OS_MAX_SHM_ATTACHMENTS; idx++ )
+    {
+        if( !process->shm_attachments[ idx ].ptr )
+        {
+            return idx;
+        }
+    }
+
+    return -NO_MEMORY_ERROR;
+}
+
+/* first fit search for a hole in the shared memory address space of the process */
+static void *shm_find_free_virtual_range( struct process *process,
+                                          uint32_t size )
+{
+    uint32_t candidate = OS_PROGRAM_VIRTUAL_SHM_ADDRESS;
+    bool moved         = true;
+
+    while( moved )
+    {
+        moved = false;
+
+        for( int idx = 0; idx < OS_MAX_SHM_ATTACHMENTS; idx++ )
+        {
+            struct process_shm_attachment *attachment = &process->shm_attachments[ idx ];
+            uint32_t start = ( uint32_t ) attachment->ptr;
+            uint32_t end   = start + shm_segments[ attachment->segment ].size;
+
+            if( attachment->ptr && ( candidate < end ) && ( candidate + size > start ) )
+            {
+                candidate = end;
+                moved     = true;
+            }
+        }
+    }
+
+    if( candidate + size > OS_PROGRAM_VIRTUAL_SHM_ADDRESS + OS_PROGRAM_VIRTUAL_SHM_SIZE )
+    {
+        return 0;
+    }
+
+    return ( void * ) candidate;
+}
+
+void *shm_attach( struct process *process,
+                  int handle )
+{
+    if( !shm_is_valid_handle( handle ) )
+    {
+        return 0;
+    }
+
+    struct shm_segment *segment = &shm_segments[ handle ];
+    int index = shm_find_free_attachment_index( process );
+
+    if( index < 0 )
+    {
+        return 0;
+    }
+
+    void *ptr = shm_find_free_virtual_range( process, segment->size );
+
+    if( !ptr )
+    {
+        return 0;
+    }
+
+    int res = paging_map_to( process->task->page_directory, ptr, segment->memory, segment->memory + segment->size, SHM_PAGE_FLAGS );
+
+    if( res < 0 )
+    {
+        return 0;
+    }
+
+    process->shm_attachments[ index ].ptr     = ptr;
+    process->shm_attachments[ index ].segment = handle;
+    segment->references++;
+
+    return ptr;
+}
+
+/* unmap a segment from the process, the last detach frees it */
+int shm_detach( struct process *process,
+                void *ptr )
+{
+    int res = -INVALID_ARGUMENT_ERROR;
+    uint32_t *directory = paging_chunk_get_directory( process->task->page_directory );
+
+    for( int idx = 0; idx < OS_MAX_SHM_ATTACHMENTS; idx++ )
+    {
+        struct process_shm_attachment *attachment = &process->shm_attachments[ idx ];
+
+        if( !ptr || ( attachment->ptr != ptr ) )
+        {
+            continue;
+        }
+
+        struct shm_segment *segment = &shm_segments[ attachment->segment ];
+
+        for( uint32_t offset = 0; offset < segment->size; offset += PAGING_PAGE_SIZE )
+        {
+            paging_set( directory, ptr + offset, 0x00 );
+        }
+
+        segment->references--;
+
+        if( segment->references == 0 )
+        {
+            shm_destroy( attachment->segment );
+        }
+
+        attachment->ptr     = 0x00;
+        attachment->segment = 0;
+        res = OS_OK;
+        break;
+    }
+
+    return res;
+}
+
+void shm_process_terminate( struct process *process )
+{
+    for( int idx = 0; idx < OS_MAX_SHM_ATTACHMENTS; idx++ )
+    {
+        if( process->shm_attachments[ idx ].ptr )
+        {
+            shm_detach( process, process->shm_attachments[ idx ].ptr );
+        }
+    }
+
+    /* segments created here that nobody ever attached would leak otherwise */
+    for( int handle = 0; handle < OS_MAX_SHM_SEGMENTS; handle++ )
+    {
+        struct shm_segment *segment = &shm_segments[ handle ];
+
+        if( segment->in_use && ( segment->creator == process->id ) && ( segment->references == 0 ) )
+        {
+            shm_destroy( handle );
+        }
+    }
+}
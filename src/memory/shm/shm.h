@@ -0,0 +1,41 @@
+#ifndef SHM_H_
+#define SHM_H_
+
+#include "memory/paging/paging.h"
+#include "config.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define SHM_PAGE_FLAGS    ( PAGING_IS_PRESENT | PAGING_IS_WRITEABLE | PAGING_ACCESS_FROM_ALL )
+
+struct process;
+
+/* physically contiguous memory mapped into every process that attaches it */
+struct shm_segment
+{
+    /* empty for segments shared by handle only */
+    char name[ OS_SHM_NAME_SIZE ];
+    void *memory;
+    /* page aligned */
+    uint32_t size;
+    /* number of attachments */
+    uint16_t references;
+    /* frees the segment on exit if nobody attached it */
+    uint16_t creator;
+    bool in_use;
+};
+
+int shm_open( struct process *process,
+              const char *name,
+              size_t size );
+void *shm_attach( struct process *process,
+                  int handle );
+int shm_detach( struct process *process,
+                void *ptr );
+void *shm_get_memory( int handle );
+int shm_reference( int handle );
+void shm_release( int handle );
+void shm_process_terminate( struct process *process );
+
+#endif /* SHM_H_ */
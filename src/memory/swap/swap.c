@@ -0,0 +1,580 @@
+#include "swap.h"
+#include "config.h"
+#include "status.h"
+#include "kernel.h"
+#include "fs/file.h"
+#include "disk/disk.h"
+#include "task/task.h"
+#include "task/process.h"
+#include "memory/memory.h"
+#include "memory/heap/kheap.h"
+#include "memory/paging/paging.h"
+#include "memory/zram/zram.h"
+#include "time/tsc.h"
+
+#define SWAP_SECTORS_PER_PAGE    ( PAGING_PAGE_SIZE / OS_SECTOR_SIZE )
+
+struct swap swap;
+
+/* either tier is enough, without a swap file every disk path finds no free slot */
+static bool swap_is_enabled()
+{
+    return ( swap.slots != 0 ) || zram_is_enabled();
+}
+
+static int swap_map_slots( int fd )
+{
+    for( uint32_t slot = 0; slot < swap.total_slots; slot++ )
+    {
+        uint32_t offset = slot * PAGING_PAGE_SIZE;
+        int first       = fbmap( fd, offset );
+        int last        = fbmap( fd, offset + PAGING_PAGE_SIZE - OS_SECTOR_SIZE );
+
+        if( ( first < 0 ) || ( last < 0 ) )
+        {
+            return -IO_ERROR;
+        }
+
+        /* a page is transferred with a single disk command so its sectors must be contiguous */
+        if( last != first + SWAP_SECTORS_PER_PAGE - 1 )
+        {
+            return -INVALID_FORMAT_ERROR;
+        }
+
+        swap.slots[ slot ].lba = first;
+    }
+
+    return OS_OK;
+}
+
+/* use a preallocated file as swap space, the file is accessed sector by sector behind the filesystem */
+int swap_init( const char *filename )
+{
+    int res = OS_OK;
+    struct file_stat stat;
+
+    bzero( &swap, sizeof( swap ) );
+
+    /* compressed memory keeps working without a swap file */
+    kheap_register_reclaim( swap_reclaim );
+
+    int fd = fopen( filename, "r" );
+
+    if( !fd )
+    {
+        res = -IO_ERROR;
+        return res;
+    }
+
+    res = fstat( fd, &stat );
+
+    if( res < 0 )
+    {
+        fclose( fd );
+        return res;
+    }
+
+    swap.disk        = fdisk( fd );
+    swap.total_slots = stat.filesize / PAGING_PAGE_SIZE;
+    swap.slots       = kzalloc( sizeof( struct swap_slot ) * swap.total_slots );
+    swap.bounce      = kzalloc( PAGING_PAGE_SIZE * OS_SWAP_CLUSTER_PAGES );
+
+    if( !swap.total_slots || !swap.slots || !swap.bounce )
+    {
+        res = -NO_MEMORY_ERROR;
+        kfree( swap.slots );
+        kfree( swap.bounce );
+        bzero( &swap, sizeof( swap ) );
+        fclose( fd );
+        return res;
+    }
+
+    res = swap_map_slots( fd );
+    fclose( fd );
+
+    if( res < 0 )
+    {
+        kfree( swap.slots );
+        kfree( swap.bounce );
+        bzero( &swap, sizeof( swap ) );
+        return res;
+    }
+
+    swap.stats.total_slots = swap.total_slots;
+
+    return res;
+}
+
+static int swap_alloc_slot()
+{
+    for( uint32_t idx = 0; idx < swap.total_slots; idx++ )
+    {
+        uint32_t slot = ( swap.next_slot + idx ) % swap.total_slots;
+
+        if( !swap.slots[ slot ].in_use )
+        {
+            swap.slots[ slot ].in_use = true;
+            swap.next_slot = slot + 1;
+            swap.stats.used_slots++;
+            return slot;
+        }
+    }
+
+    return -NO_MEMORY_ERROR;
+}
+
+static void swap_free_slot( uint32_t slot )
+{
+    if( ( slot >= swap.total_slots ) || !swap.slots[ slot ].in_use )
+    {
+        return;
+    }
+
+    swap.slots[ slot ].in_use = false;
+    swap.stats.used_slots--;
+}
+
+static int swap_find_slot( struct process *process,
+                           void *virtual )
+{
+    for( uint32_t slot = 0; slot < swap.total_slots; slot++ )
+    {
+        struct swap_slot *swap_slot = &swap.slots[ slot ];
+
+        if( swap_slot->in_use && ( swap_slot->process_id == process->id ) && ( swap_slot->virtual == ( uint32_t ) virtual ) )
+        {
+            return slot;
+        }
+    }
+
+    return -INVALID_ARGUMENT_ERROR;
+}
+
+static uint32_t *swap_get_entry( struct process *process,
+                                 void *virtual )
+{
+    return paging_get_entry( paging_chunk_get_directory( process->task->page_directory ), virtual );
+}
+
+static void swap_clock_advance_allocation( int *laps )
+{
+    swap.hand_page = 0;
+    swap.hand_allocation++;
+
+    if( swap.hand_allocation < OS_MAX_PROGRAMS_ALLOCATIONS )
+    {
+        return;
+    }
+
+    swap.hand_allocation = 0;
+    swap.hand_process++;
+
+    if( swap.hand_process >= OS_MAX_PROCESSES )
+    {
+        swap.hand_process = 0;
+        *laps += 1;
+    }
+}
+
+/*
+ * second chance clock over the heap pages of every process, a page that was
+ * accessed since the last pass loses its accessed bit and is skipped
+ */
+static int swap_clock_select( struct process **process_out,
+                              void **virtual_out )
+{
+    int laps = 0;
+
+    /* the first lap may start half way, two more full laps always find a victim if there is one */
+    while( laps < 3 )
+    {
+        struct process *process = process_get( swap.hand_process );
+
+        if( !process || !process->task )
+        {
+            swap.hand_allocation = OS_MAX_PROGRAMS_ALLOCATIONS;
+            swap_clock_advance_allocation( &laps );
+            continue;
+        }
+
+        struct process_allocation *allocation = &process->allocations[ swap.hand_allocation ];
+        int total_pages = ( uint32_t ) paging_align_address( ( void * ) allocation->size ) / PAGING_PAGE_SIZE;
+
+        if( !allocation->ptr || ( swap.hand_page >= total_pages ) )
+        {
+            swap_clock_advance_allocation( &laps );
+            continue;
+        }
+
+        void *virtual    = allocation->ptr + ( swap.hand_page * PAGING_PAGE_SIZE );
+        uint32_t *entry  = swap_get_entry( process, virtual );
+
+        swap.hand_page++;
+
+        /* merged pages belong to every process sharing them */
+        if( !entry || !( *entry & PAGING_IS_PRESENT ) || ( *entry & PAGING_IS_MERGED ) )
+        {
+            continue;
+        }
+
+        if( *entry & PAGING_IS_ACCESSED )
+        {
+            *entry &= ~PAGING_IS_ACCESSED;
+            continue;
+        }
+
+        *process_out = process;
+        *virtual_out = virtual;
+        return OS_OK;
+    }
+
+    return -NO_MEMORY_ERROR;
+}
+
+static int swap_out( struct process *process,
+                     void *virtual )
+{
+    int res         = OS_OK;
+    uint32_t *entry = swap_get_entry( process, virtual );
+    void *frame     = ( void * ) ( *entry & PAGING_ADDRESS_MASK );
+    int slot        = -1;
+    uint32_t handle = 0;
+
+    if( *entry & PAGING_IS_SWAP_CACHED )
+    {
+        slot = swap_find_slot( process, virtual );
+    }
+
+    if( ( slot >= 0 ) && !( *entry & PAGING_IS_DIRTY ) )
+    {
+        /* the copy in swap is still up to date */
+        swap.stats.clean_evictions++;
+    }
+    else if( zram_store( frame, &handle ) == OS_OK )
+    {
+        /* the frame now belongs to the pool, a stale swap copy is not needed anymore */
+        if( slot >= 0 )
+        {
+            swap_free_slot( slot );
+        }
+
+        *entry = ( handle * PAGING_PAGE_SIZE ) | PAGING_IS_COMPRESSED;
+        return res;
+    }
+    else
+    {
+        bool new_slot = slot < 0;
+
+        if( new_slot )
+        {
+            slot = swap_alloc_slot();
+
+            if( slot < 0 )
+            {
+                res = slot;
+                return res;
+            }
+        }
+
+        uint64_t start = tsc_read();
+
+        res = disk_write_block( swap.disk, swap.slots[ slot ].lba, SWAP_SECTORS_PER_PAGE, frame );
+
+        if( res < 0 )
+        {
+            if( new_slot )
+            {
+                swap_free_slot( slot );
+            }
+
+            return res;
+        }
+
+        swap.stats.page_out_cycles += tsc_read() - start;
+        swap.stats.page_outs++;
+    }
+
+    swap.slots[ slot ].process_id = process->id;
+    swap.slots[ slot ].virtual    = ( uint32_t ) virtual;
+
+    *entry = ( slot * PAGING_PAGE_SIZE ) | PAGING_IS_SWAPPED;
+    kfree( frame );
+
+    return res;
+}
+
+/* evict enough cold pages to cover the given size, returns the number of pages freed */
+int swap_reclaim( size_t size )
+{
+    int released    = 0;
+    int total_pages = ( uint32_t ) paging_align_address( ( void * ) size ) / PAGING_PAGE_SIZE;
+
+    if( !swap_is_enabled() )
+    {
+        return 0;
+    }
+
+    while( released < total_pages )
+    {
+        struct process *process = 0;
+        void *virtual = 0;
+
+        if( swap_clock_select( &process, &virtual ) < 0 )
+        {
+            break;
+        }
+
+        if( swap_out( process, virtual ) < 0 )
+        {
+            break;
+        }
+
+        released++;
+    }
+
+    return released;
+}
+
+/* true if the page at virtual sits in the given slot, so it can join a clustered read */
+static bool swap_is_in_slot( struct process *process,
+                             void *virtual,
+                             uint32_t slot )
+{
+    uint32_t *entry = swap_get_entry( process, virtual );
+
+    if( !entry || ( *entry & PAGING_IS_PRESENT ) || !( *entry & PAGING_IS_SWAPPED ) )
+    {
+        return false;
+    }
+
+    return ( slot < swap.total_slots ) && ( ( *entry / PAGING_PAGE_SIZE ) == slot );
+}
+
+/* bring a page back, together with the following pages when they sit in the next slots on disk */
+static int swap_in( struct process *process,
+                    void *virtual )
+{
+    int res = OS_OK;
+    void *frames[ OS_SWAP_CLUSTER_PAGES ];
+    uint32_t slot  = *swap_get_entry( process, virtual ) / PAGING_PAGE_SIZE;
+    int total      = 1;
+
+    if( slot >= swap.total_slots )
+    {
+        res = -INVALID_ARGUMENT_ERROR;
+        return res;
+    }
+
+    while( total < OS_SWAP_CLUSTER_PAGES )
+    {
+        void *next_virtual = virtual + ( total * PAGING_PAGE_SIZE );
+        uint32_t next_slot = slot + total;
+
+        if( !swap_is_in_slot( process, next_virtual, next_slot ) )
+        {
+            break;
+        }
+
+        if( swap.slots[ next_slot ].lba != swap.slots[ slot ].lba + ( total * SWAP_SECTORS_PER_PAGE ) )
+        {
+            break;
+        }
+
+        total++;
+    }
+
+    for( int idx = 0; idx < total; idx++ )
+    {
+        frames[ idx ] = kzalloc( PAGING_PAGE_SIZE );
+
+        if( !frames[ idx ] )
+        {
+            /* read whatever we got frames for */
+            total = idx;
+            break;
+        }
+    }
+
+    if( total == 0 )
+    {
+        res = -NO_MEMORY_ERROR;
+        return res;
+    }
+
+    void *buffer   = ( total == 1 ) ? frames[ 0 ] : swap.bounce;
+    uint64_t start = tsc_read();
+
+    res = disk_read_block( swap.disk, swap.slots[ slot ].lba, total * SWAP_SECTORS_PER_PAGE, buffer );
+
+    if( res < 0 )
+    {
+        for( int idx = 0; idx < total; idx++ )
+        {
+            kfree( frames[ idx ] );
+        }
+
+        return res;
+    }
+
+    swap.stats.page_in_cycles += tsc_read() - start;
+    swap.stats.page_ins       += total;
+
+    for( int idx = 0; idx < total; idx++ )
+    {
+        void *page_virtual = virtual + ( idx * PAGING_PAGE_SIZE );
+        uint32_t flags     = SWAP_PAGE_FLAGS | PAGING_IS_SWAP_CACHED;
+
+        if( total > 1 )
+        {
+            memcpy( frames[ idx ], buffer + ( idx * PAGING_PAGE_SIZE ), PAGING_PAGE_SIZE );
+        }
+
+        /* only the faulting page counts as used, read ahead pages stay cold until touched */
+        if( idx == 0 )
+        {
+            flags |= PAGING_IS_ACCESSED;
+        }
+
+        *swap_get_entry( process, page_virtual ) = ( uint32_t ) frames[ idx ] | flags;
+    }
+
+    return res;
+}
+
+static int swap_in_compressed( struct process *process,
+                               void *virtual )
+{
+    int res         = OS_OK;
+    uint32_t *entry = swap_get_entry( process, virtual );
+    void *frame     = kzalloc( PAGING_PAGE_SIZE );
+
+    if( !frame )
+    {
+        res = -NO_MEMORY_ERROR;
+        return res;
+    }
+
+    res = zram_load( *entry / PAGING_PAGE_SIZE, frame );
+
+    if( res < 0 )
+    {
+        kfree( frame );
+        return res;
+    }
+
+    *entry = ( uint32_t ) frame | SWAP_PAGE_FLAGS | PAGING_IS_ACCESSED;
+
+    return res;
+}
+
+/* bring back a page from whichever tier holds it */
+static int swap_in_entry( struct process *process,
+                          void *virtual,
+                          uint32_t entry )
+{
+    if( entry & PAGING_IS_COMPRESSED )
+    {
+        return swap_in_compressed( process, virtual );
+    }
+
+    return swap_in( process, virtual );
+}
+
+int swap_fault( struct task *task,
+                void *address )
+{
+    int res = OS_OK;
+    void *virtual   = paging_align_to_lower_page( address );
+    uint32_t *entry = 0;
+
+    if( !swap_is_enabled() || !task || !task->process )
+    {
+        res = -INVALID_ARGUMENT_ERROR;
+        return res;
+    }
+
+    entry = swap_get_entry( task->process, virtual );
+
+    if( !entry || ( *entry & PAGING_IS_PRESENT ) || !( *entry & ( PAGING_IS_SWAPPED | PAGING_IS_COMPRESSED ) ) )
+    {
+        res = -INVALID_ARGUMENT_ERROR;
+        return res;
+    }
+
+    bool from_disk = *entry & PAGING_IS_SWAPPED;
+
+    res = swap_in_entry( task->process, virtual, *entry );
+
+    if( ( res == OS_OK ) && from_disk )
+    {
+        swap.stats.faults++;
+    }
+
+    return res;
+}
+
+/* make sure the kernel can reach a user page through its physical address */
+int swap_ensure_resident( struct task *task,
+                          void *virtual )
+{
+    int res = OS_OK;
+    void *page      = paging_align_to_lower_page( virtual );
+    uint32_t *entry = paging_get_entry( paging_chunk_get_directory( task->page_directory ), page );
+
+    if( !entry )
+    {
+        res = -INVALID_ARGUMENT_ERROR;
+        return res;
+    }
+
+    if( !( *entry & PAGING_IS_PRESENT ) && ( *entry & ( PAGING_IS_SWAPPED | PAGING_IS_COMPRESSED ) ) && task->process )
+    {
+        res = swap_in_entry( task->process, page, *entry );
+    }
+
+    /* the kernel writes through the physical page, the processor does not track that for us */
+    if( ( res == OS_OK ) && ( *entry & PAGING_IS_PRESENT ) )
+    {
+        *entry |= PAGING_IS_DIRTY | PAGING_IS_ACCESSED;
+    }
+
+    return res;
+}
+
+/* forget the swap copy of a page that is being unmapped */
+void swap_release( struct process *process,
+                   void *virtual,
+                   uint32_t entry )
+{
+    if( !swap_is_enabled() )
+    {
+        return;
+    }
+
+    if( !( entry & PAGING_IS_PRESENT ) && ( entry & PAGING_IS_SWAPPED ) )
+    {
+        swap_free_slot( entry / PAGING_PAGE_SIZE );
+        return;
+    }
+
+    if( !( entry & PAGING_IS_PRESENT ) && ( entry & PAGING_IS_COMPRESSED ) )
+    {
+        zram_free( entry / PAGING_PAGE_SIZE );
+        return;
+    }
+
+    if( ( entry & PAGING_IS_PRESENT ) && ( entry & PAGING_IS_SWAP_CACHED ) )
+    {
+        int slot = swap_find_slot( process, virtual );
+
+        if( slot >= 0 )
+        {
+            swap_free_slot( slot );
+        }
+    }
+}
+
+void swap_get_stats( struct swap_stats *stats )
+{
+    memcpy( stats, &swap.stats, sizeof( struct swap_stats ) );
+}
@@ -0,0 +1,74 @@
+#ifndef SWAP_H_
+#define SWAP_H_
+
+#include "memory/paging/paging.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define SWAP_PAGE_FLAGS    ( PAGING_IS_PRESENT | PAGING_IS_WRITEABLE | PAGING_ACCESS_FROM_ALL )
+
+struct process;
+struct task;
+struct disk;
+
+/* one page sized slot of the swap file */
+struct swap_slot
+{
+    /* absolute sector of the slot on the swap disk */
+    uint32_t lba;
+    /* the page that owns the slot */
+    uint32_t virtual;
+    uint16_t process_id;
+    bool in_use;
+};
+
+struct swap_stats
+{
+    uint32_t total_slots;
+    uint32_t used_slots;
+    /* pages written to swap */
+    uint32_t page_outs;
+    /* pages read back from swap */
+    uint32_t page_ins;
+    /* evictions that needed no write because the swap copy was still clean */
+    uint32_t clean_evictions;
+    /* page faults resolved from swap */
+    uint32_t faults;
+    /* time spent in disk transfers, in processor cycles */
+    uint64_t page_out_cycles;
+    uint64_t page_in_cycles;
+};
+
+struct swap
+{
+    struct disk *disk;
+    struct swap_slot *slots;
+    uint32_t total_slots;
+
+    /* next fit cursor, pages evicted together end up in neighbouring slots */
+    uint32_t next_slot;
+
+    /* read buffer for clustered page ins */
+    void *bounce;
+
+    /* clock hand over the heap pages of all processes */
+    int hand_process;
+    int hand_allocation;
+    int hand_page;
+
+    struct swap_stats stats;
+};
+
+int swap_init( const char *filename );
+int swap_reclaim( size_t size );
+int swap_fault( struct task *task,
+                void *address );
+int swap_ensure_resident( struct task *task,
+                          void *virtual );
+void swap_release( struct process *process,
+                   void *virtual,
+                   uint32_t entry );
+void swap_get_stats( struct swap_stats *stats );
+
+#endif /* SWAP_H_ */
@@ -0,0 +1,263 @@
+#include "lz.h"
+#include "status.h"
+
+/* position + 1 of the last time a 4 byte sequence was seen, zero when never */
+static uint16_t lz_hash_table[ 1 << LZ_HASH_BITS ];
+
+static uint32_t lz_read32( const uint8_t *ptr )
+{
+    return ptr[ 0 ] | ( ptr[ 1 ] << 8 ) | ( ptr[ 2 ] << 16 ) | ( ( uint32_t ) ptr[ 3 ] << 24 );
+}
+
+static uint32_t lz_hash( uint32_t sequence )
+{
+    return ( sequence * 2654435761U ) >> ( 32 - LZ_HASH_BITS );
+}
+
+/* the part of a length that did not fit in its token nibble, in 255 steps */
+static int lz_write_length( uint8_t *out,
+                            int pos,
+                            int out_max,
+                            int length )
+{
+    while( length >= 255 )
+    {
+        if( pos >= out_max )
+        {
+            return -NO_MEMORY_ERROR;
+        }
+
+        out[ pos++ ] = 255;
+        length      -= 255;
+    }
+
+    if( pos >= out_max )
+    {
+        return -NO_MEMORY_ERROR;
+    }
+
+    out[ pos++ ] = length;
+
+    return pos;
+}
+
+static int lz_read_length( const uint8_t *in,
+                           int *pos,
+                           int in_size )
+{
+    int length   = 0;
+    uint8_t byte = 255;
+
+    while( byte == 255 )
+    {
+        if( *pos >= in_size )
+        {
+            return -INVALID_FORMAT_ERROR;
+        }
+
+        byte    = in[ *pos ];
+        *pos   += 1;
+        length += byte;
+    }
+
+    return length;
+}
+
+/* a match length of zero writes the final literals only sequence */
+static int lz_write_sequence( uint8_t *out,
+                              int pos,
+                              int out_max,
+                              const uint8_t *literals,
+                              int literal_length,
+                              int offset,
+                              int match_length )
+{
+    int match_extra    = match_length ? match_length - LZ_MIN_MATCH : 0;
+    int literal_nibble = ( literal_length >= 15 ) ? 15 : literal_length;
+    int match_nibble   = ( match_extra >= 15 ) ? 15 : match_extra;
+
+    if( pos >= out_max )
+    {
+        return -NO_MEMORY_ERROR;
+    }
+
+    out[ pos++ ] = ( literal_nibble << 4 ) | match_nibble;
+
+    if( literal_nibble == 15 )
+    {
+        pos = lz_write_length( out, pos, out_max, literal_length - 15 );
+
+        if( pos < 0 )
+        {
+            return pos;
+        }
+    }
+
+    if( pos + literal_length > out_max )
+    {
+        return -NO_MEMORY_ERROR;
+    }
+
+    for( int idx = 0; idx < literal_length; idx++ )
+    {
+        out[ pos++ ] = literals[ idx ];
+    }
+
+    if( !match_length )
+    {
+        return pos;
+    }
+
+    if( pos + 2 > out_max )
+    {
+        return -NO_MEMORY_ERROR;
+    }
+
+    out[ pos++ ] = offset & 0xFF;
+    out[ pos++ ] = offset >> 8;
+
+    if( match_nibble == 15 )
+    {
+        pos = lz_write_length( out, pos, out_max, match_extra - 15 );
+    }
+
+    return pos;
+}
+
+/* returns the compressed size, or -NO_MEMORY_ERROR if it does not fit in out_max */
+int lz_compress( const uint8_t *in,
+                 int in_size,
+                 uint8_t *out,
+                 int out_max )
+{
+    int ip          = 0;
+    int op          = 0;
+    int anchor      = 0;
+    int match_limit = in_size - LZ_LAST_LITERALS;
+
+    if( ( in_size < 0 ) || ( in_size > LZ_MAX_INPUT ) )
+    {
+        return -INVALID_ARGUMENT_ERROR;
+    }
+
+    for( int idx = 0; idx < ( 1 << LZ_HASH_BITS ); idx++ )
+    {
+        lz_hash_table[ idx ] = 0;
+    }
+
+    while( ip + LZ_MIN_MATCH <= match_limit )
+    {
+        uint32_t sequence = lz_read32( in + ip );
+        uint32_t hash     = lz_hash( sequence );
+        int reference     = ( int ) lz_hash_table[ hash ] - 1;
+
+        lz_hash_table[ hash ] = ip + 1;
+
+        if( ( reference < 0 ) || ( lz_read32( in + reference ) != sequence ) )
+        {
+            ip++;
+            continue;
+        }
+
+        int length = LZ_MIN_MATCH;
+
+        while( ( ip + length < match_limit ) && ( in[ reference + length ] == in[ ip + length ] ) )
+        {
+            length++;
+        }
+
+        op = lz_write_sequence( out, op, out_max, in + anchor, ip - anchor, ip - reference, length );
+
+        if( op < 0 )
+        {
+            return op;
+        }
+
+        ip    += length;
+        anchor = ip;
+    }
+
+    return lz_write_sequence( out, op, out_max, in + anchor, in_size - anchor, 0, 0 );
+}
+
+/* returns out_size, or -INVALID_FORMAT_ERROR if the block is damaged */
+int lz_decompress( const uint8_t *in,
+                   int in_size,
+                   uint8_t *out,
+                   int out_size )
+{
+    int ip = 0;
+    int op = 0;
+
+    while( ip < in_size )
+    {
+        uint8_t token      = in[ ip++ ];
+        int literal_length = token >> 4;
+
+        if( literal_length == 15 )
+        {
+            int extra = lz_read_length( in, &ip, in_size );
+
+            if( extra < 0 )
+            {
+                return extra;
+            }
+
+            literal_length += extra;
+        }
+
+        if( ( ip + literal_length > in_size ) || ( op + literal_length > out_size ) )
+        {
+            return -INVALID_FORMAT_ERROR;
+        }
+
+        for( int idx = 0; idx < literal_length; idx++ )
+        {
+            out[ op++ ] = in[ ip++ ];
+        }
+
+        /* the last sequence carries literals only */
+        if( op == out_size )
+        {
+            break;
+        }
+
+        if( ip + 2 > in_size )
+        {
+            return -INVALID_FORMAT_ERROR;
+        }
+
+        int offset       = in[ ip ] | ( in[ ip + 1 ] << 8 );
+        int match_length = token & 0x0F;
+
+        ip += 2;
+
+        if( match_length == 15 )
+        {
+            int extra = lz_read_length( in, &ip, in_size );
+
+            if( extra < 0 )
+            {
+                return extra;
+            }
+
+            match_length += extra;
+        }
+
+        match_length += LZ_MIN_MATCH;
+
+        if( ( offset == 0 ) || ( offset > op ) || ( op + match_length > out_size ) )
+        {
+            return -INVALID_FORMAT_ERROR;
+        }
+
+        /* byte by byte so overlapping matches repeat correctly */
+        for( int idx = 0; idx < match_length; idx++ )
+        {
+            out[ op ] = out[ op - offset ];
+            op++;
+        }
+    }
+
+    return ( op == out_size ) ? op : -INVALID_FORMAT_ERROR;
+}
@@ -0,0 +1,24 @@
+#ifndef LZ_H_
+#define LZ_H_
+
+#include <stdint.h>
+
+/*
+ * byte oriented LZ77 codec in the spirit of LZ4, fast enough to run on every eviction
+ * a block is a list of sequences: token, literals, 16 bit match offset, extra match length
+ */
+#define LZ_MIN_MATCH        4
+#define LZ_LAST_LITERALS    5
+#define LZ_HASH_BITS        12
+#define LZ_MAX_INPUT        65535
+
+int lz_compress( const uint8_t *in,
+                 int in_size,
+                 uint8_t *out,
+                 int out_max );
+int lz_decompress( const uint8_t *in,
+                   int in_size,
+                   uint8_t *out,
+                   int out_size );
+
+#endif /* LZ_H_ */
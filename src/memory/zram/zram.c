@@ -0,0 +1,324 @@
+#include "zram.h"
+#include "lz.h"
+#include "config.h"
+#include "status.h"
+#include "memory/memory.h"
+#include "memory/heap/kheap.h"
+#include "time/tsc.h"
+
+struct zram zram;
+
+/* keep cold process pages compressed in the kernel heap before they have to go to disk */
+int zram_init()
+{
+    int res = OS_OK;
+
+    bzero( &zram, sizeof( zram ) );
+
+    zram.pages   = kzalloc( sizeof( struct zram_pool_page ) * OS_ZRAM_MAX_POOL_PAGES );
+    zram.objects = kzalloc( sizeof( struct zram_object ) * OS_ZRAM_MAX_OBJECTS );
+    zram.scratch = kzalloc( PAGING_PAGE_SIZE );
+
+    if( !zram.pages || !zram.objects || !zram.scratch )
+    {
+        res = -NO_MEMORY_ERROR;
+        kfree( zram.pages );
+        kfree( zram.objects );
+        kfree( zram.scratch );
+        bzero( &zram, sizeof( zram ) );
+    }
+
+    return res;
+}
+
+bool zram_is_enabled()
+{
+    return zram.objects != 0;
+}
+
+static bool zram_chunk_is_used( struct zram_pool_page *page,
+                                int chunk )
+{
+    return page->bitmap[ chunk / 32 ] & ( 1U << ( chunk % 32 ) );
+}
+
+static void zram_mark_chunks( struct zram_pool_page *page,
+                              int first,
+                              int count,
+                              bool used )
+{
+    for( int chunk = first; chunk < first + count; chunk++ )
+    {
+        if( used )
+        {
+            page->bitmap[ chunk / 32 ] |= ( 1U << ( chunk % 32 ) );
+        }
+        else
+        {
+            page->bitmap[ chunk / 32 ] &= ~( 1U << ( chunk % 32 ) );
+        }
+    }
+
+    page->free_chunks += used ? -count : count;
+}
+
+/* first run of count free chunks in the page */
+static int zram_find_run( struct zram_pool_page *page,
+                          int count )
+{
+    int run = 0;
+
+    for( int chunk = 0; chunk < ZRAM_CHUNKS_PER_PAGE; chunk++ )
+    {
+        if( zram_chunk_is_used( page, chunk ) )
+        {
+            run = 0;
+            continue;
+        }
+
+        run++;
+
+        if( run == count )
+        {
+            return chunk - count + 1;
+        }
+    }
+
+    return -NO_MEMORY_ERROR;
+}
+
+/*
+ * grow the pool by a page, when the heap is exhausted the frame being compressed
+ * becomes the new pool page since its contents already live in the scratch buffer
+ */
+static int zram_open_page( void *frame,
+                           bool *adopted )
+{
+    for( int idx = 0; idx < OS_ZRAM_MAX_POOL_PAGES; idx++ )
+    {
+        struct zram_pool_page *page = &zram.pages[ idx ];
+
+        if( page->data )
+        {
+            continue;
+        }
+
+        page->data = kzalloc( PAGING_PAGE_SIZE );
+
+        if( !page->data )
+        {
+            page->data = frame;
+            *adopted   = true;
+        }
+
+        page->bitmap[ 0 ]  = 0;
+        page->bitmap[ 1 ]  = 0;
+        page->free_chunks  = ZRAM_CHUNKS_PER_PAGE;
+        zram.stats.pool_pages++;
+
+        return idx;
+    }
+
+    return -NO_MEMORY_ERROR;
+}
+
+static int zram_alloc_chunks( int count,
+                              void *frame,
+                              bool *adopted,
+                              struct zram_object *object )
+{
+    int chunk           = -NO_MEMORY_ERROR;
+    uint32_t page_index = 0;
+
+    for( uint32_t idx = 0; idx < OS_ZRAM_MAX_POOL_PAGES; idx++ )
+    {
+        page_index = ( zram.next_page + idx ) % OS_ZRAM_MAX_POOL_PAGES;
+
+        struct zram_pool_page *page = &zram.pages[ page_index ];
+
+        if( !page->data || ( page->free_chunks < count ) )
+        {
+            continue;
+        }
+
+        chunk = zram_find_run( page, count );
+
+        if( chunk >= 0 )
+        {
+            break;
+        }
+    }
+
+    if( chunk < 0 )
+    {
+        int res = zram_open_page( frame, adopted );
+
+        if( res < 0 )
+        {
+            return res;
+        }
+
+        page_index = res;
+        chunk      = 0;
+    }
+
+    zram_mark_chunks( &zram.pages[ page_index ], chunk, count, true );
+
+    zram.next_page    = page_index;
+    object->pool_page = page_index;
+    object->chunk     = chunk;
+
+    return OS_OK;
+}
+
+static void zram_free_chunks( struct zram_object *object )
+{
+    struct zram_pool_page *page = &zram.pages[ object->pool_page ];
+    int count = ( object->size + ZRAM_CHUNK_SIZE - 1 ) / ZRAM_CHUNK_SIZE;
+
+    zram_mark_chunks( page, object->chunk, count, false );
+
+    /* give empty pool pages back to the heap */
+    if( page->free_chunks == ZRAM_CHUNKS_PER_PAGE )
+    {
+        kfree( page->data );
+        page->data = 0;
+        zram.stats.pool_pages--;
+    }
+}
+
+static int zram_alloc_object()
+{
+    for( uint32_t idx = 0; idx < OS_ZRAM_MAX_OBJECTS; idx++ )
+    {
+        uint32_t handle = ( zram.next_object + idx ) % OS_ZRAM_MAX_OBJECTS;
+
+        if( !zram.objects[ handle ].in_use )
+        {
+            zram.objects[ handle ].in_use = true;
+            zram.next_object = handle + 1;
+            return handle;
+        }
+    }
+
+    return -NO_MEMORY_ERROR;
+}
+
+/* compress a page into the pool, on success the frame belongs to the pool and must not be used again */
+int zram_store( void *frame,
+                uint32_t *handle )
+{
+    int res        = OS_OK;
+    bool adopted   = false;
+    uint64_t start = tsc_read();
+
+    if( !zram_is_enabled() )
+    {
+        res = -IO_ERROR;
+        return res;
+    }
+
+    int size = lz_compress( frame, PAGING_PAGE_SIZE, zram.scratch, ZRAM_MAX_OBJECT_SIZE );
+
+    zram.stats.compress_cycles += tsc_read() - start;
+
+    if( size < 0 )
+    {
+        zram.stats.incompressible++;
+        res = -NO_MEMORY_ERROR;
+        return res;
+    }
+
+    int object_handle = zram_alloc_object();
+
+    if( object_handle < 0 )
+    {
+        res = object_handle;
+        return res;
+    }
+
+    struct zram_object *object = &zram.objects[ object_handle ];
+
+    object->size = size;
+    res = zram_alloc_chunks( ( size + ZRAM_CHUNK_SIZE - 1 ) / ZRAM_CHUNK_SIZE, frame, &adopted, object );
+
+    if( res < 0 )
+    {
+        object->in_use = false;
+        return res;
+    }
+
+    memcpy( zram.pages[ object->pool_page ].data + ( object->chunk * ZRAM_CHUNK_SIZE ), zram.scratch, size );
+
+    if( !adopted )
+    {
+        kfree( frame );
+    }
+
+    zram.stats.stored_pages++;
+    zram.stats.compressed_bytes += size;
+    zram.stats.page_outs++;
+
+    *handle = object_handle;
+
+    return res;
+}
+
+void zram_free( uint32_t handle )
+{
+    if( !zram_is_enabled() || ( handle >= OS_ZRAM_MAX_OBJECTS ) || !zram.objects[ handle ].in_use )
+    {
+        return;
+    }
+
+    struct zram_object *object = &zram.objects[ handle ];
+
+    zram_free_chunks( object );
+
+    zram.stats.stored_pages--;
+    zram.stats.compressed_bytes -= object->size;
+    object->in_use = false;
+}
+
+/* decompress a page into frame and drop it from the pool */
+int zram_load( uint32_t handle,
+               void *frame )
+{
+    int res = OS_OK;
+
+    if( !zram_is_enabled() || ( handle >= OS_ZRAM_MAX_OBJECTS ) || !zram.objects[ handle ].in_use )
+    {
+        res = -INVALID_ARGUMENT_ERROR;
+        return res;
+    }
+
+    struct zram_object *object = &zram.objects[ handle ];
+    uint8_t *data  = zram.pages[ object->pool_page ].data + ( object->chunk * ZRAM_CHUNK_SIZE );
+    uint64_t start = tsc_read();
+
+    res = lz_decompress( data, object->size, frame, PAGING_PAGE_SIZE );
+
+    zram.stats.decompress_cycles += tsc_read() - start;
+
+    if( res < 0 )
+    {
+        return res;
+    }
+
+    res = OS_OK;
+    zram.stats.faults++;
+    zram_free( handle );
+
+    return res;
+}
+
+void zram_get_stats( struct zram_stats *stats )
+{
+    /* sixteenths keep the products in 32 bits */
+    uint32_t compressed = zram.stats.compressed_bytes / 16;
+
+    zram.stats.ratio_x100   = compressed ? ( zram.stats.stored_pages * ( PAGING_PAGE_SIZE / 16 ) * 100 ) / compressed : 0;
+    zram.stats.density_x100 = zram.stats.pool_pages ? ( zram.stats.stored_pages * 100 ) / zram.stats.pool_pages : 0;
+
+    memcpy( stats, &zram.stats, sizeof( struct zram_stats ) );
+}
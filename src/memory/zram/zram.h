@@ -0,0 +1,77 @@
+#ifndef ZRAM_H_
+#define ZRAM_H_
+
+#include "memory/paging/paging.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/* the heap hands out whole pages, the pool splits them into chunks for compressed pages */
+#define ZRAM_CHUNK_SIZE          64
+#define ZRAM_CHUNKS_PER_PAGE     ( PAGING_PAGE_SIZE / ZRAM_CHUNK_SIZE )
+/* pages that do not compress below this are not worth keeping in memory */
+#define ZRAM_MAX_OBJECT_SIZE     ( ( PAGING_PAGE_SIZE / 4 ) * 3 )
+
+/* one heap page of the pool */
+struct zram_pool_page
+{
+    uint8_t *data;
+    /* one bit per chunk, set when used */
+    uint32_t bitmap[ ZRAM_CHUNKS_PER_PAGE / 32 ];
+    uint16_t free_chunks;
+};
+
+/* one compressed page, its index is the handle stored in the page table entry */
+struct zram_object
+{
+    uint16_t pool_page;
+    uint8_t chunk;
+    bool in_use;
+    uint16_t size;
+};
+
+struct zram_stats
+{
+    /* heap pages held by the pool */
+    uint32_t pool_pages;
+    /* pages currently held compressed */
+    uint32_t stored_pages;
+    uint32_t compressed_bytes;
+    /* uncompressed over compressed size, times 100 */
+    uint32_t ratio_x100;
+    /* stored pages per pool page, times 100, includes chunk waste */
+    uint32_t density_x100;
+    /* pages compressed into the pool */
+    uint32_t page_outs;
+    /* pages that did not compress well enough and went on to disk */
+    uint32_t incompressible;
+    /* pages decompressed on demand, from a page fault or a kernel access */
+    uint32_t faults;
+    uint64_t compress_cycles;
+    uint64_t decompress_cycles;
+};
+
+struct zram
+{
+    struct zram_pool_page *pages;
+    struct zram_object *objects;
+
+    /* next fit cursors */
+    uint32_t next_page;
+    uint32_t next_object;
+
+    /* compressor output, copied into the pool once the size is known */
+    uint8_t *scratch;
+
+    struct zram_stats stats;
+};
+
+int zram_init();
+bool zram_is_enabled();
+int zram_store( void *frame,
+                uint32_t *handle );
+int zram_load( uint32_t handle,
+               void *frame );
+void zram_free( uint32_t handle );
+void zram_get_stats( struct zram_stats *stats );
+
+#endif /* ZRAM_H_ */
@@ -0,0 +1,150 @@
+#include "pci.h"
+#include "io/io.h"
+#include "status.h"
+#include "memory/memory.h"
+
+static uint32_t pci_config_address( struct pci_device *device,
+                                    uint8_t offset )
+{
+    return PCI_CONFIG_ENABLE | ( device->bus << 16 ) | ( device->slot << 11 ) | ( device->function << 8 ) | ( offset & 0xFC );
+}
+
+uint32_t pci_config_read( struct pci_device *device,
+                          uint8_t offset )
+{
+    outl( PCI_CONFIG_ADDRESS, pci_config_address( device, offset ) );
+    return insl( PCI_CONFIG_DATA );
+}
+
+void pci_config_write( struct pci_device *device,
+                       uint8_t offset,
+                       uint32_t value )
+{
+    outl( PCI_CONFIG_ADDRESS, pci_config_address( device, offset ) );
+    outl( PCI_CONFIG_DATA, value );
+}
+
+/* fill in the identification of the function, false when nothing answers there */
+static bool pci_probe( struct pci_device *device )
+{
+    uint32_t id = pci_config_read( device, PCI_REGISTER_VENDOR_ID );
+
+    if( ( id & 0xFFFF ) == PCI_VENDOR_NONE )
+    {
+        return false;
+    }
+
+    uint32_t class = pci_config_read( device, PCI_REGISTER_CLASS );
+
+    device->vendor_id  = id & 0xFFFF;
+    device->device_id  = id >> 16;
+    device->class_code = class >> 24;
+    device->subclass   = ( class >> 16 ) & 0xFF;
+    device->prog_if    = ( class >> 8 ) & 0xFF;
+
+    return true;
+}
+
+typedef bool (*PCI_MATCH_FUNCTION)( struct pci_device *device,
+                                    uint16_t first,
+                                    uint16_t second );
+
+static bool pci_match_class( struct pci_device *device,
+                             uint16_t class_code,
+                             uint16_t subclass )
+{
+    return ( device->class_code == class_code ) && ( device->subclass == subclass );
+}
+
+static bool pci_match_id( struct pci_device *device,
+                          uint16_t vendor_id,
+                          uint16_t device_id )
+{
+    return ( device->vendor_id == vendor_id ) && ( device->device_id == device_id );
+}
+
+/* brute force scan of every bus, slot and function for the first matching device */
+static int pci_find( PCI_MATCH_FUNCTION match,
+                     uint16_t first,
+                     uint16_t second,
+                     struct pci_device *device_out )
+{
+    struct pci_device device;
+
+    for( int bus = 0; bus < PCI_MAX_BUSES; bus++ )
+    {
+        for( int slot = 0; slot < PCI_MAX_SLOTS; slot++ )
+        {
+            for( int function = 0; function < PCI_MAX_FUNCTIONS; function++ )
+            {
+                bzero( &device, sizeof( device ) );
+                device.bus      = bus;
+                device.slot     = slot;
+                device.function = function;
+
+                if( !pci_probe( &device ) )
+                {
+                    /* a missing function zero means an empty slot */
+                    if( function == 0 )
+                    {
+                        break;
+                    }
+
+                    continue;
+                }
+
+                if( match( &device, first, second ) )
+                {
+                    memcpy( device_out, &device, sizeof( device ) );
+                    return OS_OK;
+                }
+
+                if( ( function == 0 ) && !( ( pci_config_read( &device, PCI_REGISTER_HEADER_TYPE ) >> 16 ) & PCI_HEADER_MULTI_FUNCTION ) )
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    return -IO_ERROR;
+}
+
+int pci_find_class( uint8_t class_code,
+                    uint8_t subclass,
+                    struct pci_device *device_out )
+{
+    return pci_find( pci_match_class, class_code, subclass, device_out );
+}
+
+int pci_find_device( uint16_t vendor_id,
+                     uint16_t device_id,
+                     struct pci_device *device_out )
+{
+    return pci_find( pci_match_id, vendor_id, device_id, device_out );
+}
+
+/* base address of one of the six regions of the device, with the type bits stripped */
+uint32_t pci_get_bar( struct pci_device *device,
+                      int bar )
+{
+    uint32_t value = pci_config_read( device, PCI_REGISTER_BAR0 + ( bar * 4 ) );
+
+    if( value & PCI_BAR_IO_SPACE )
+    {
+        return value & PCI_BAR_IO_ADDRESS_MASK;
+    }
+
+    return value & PCI_BAR_MEMORY_ADDRESS_MASK;
+}
+
+void pci_enable_bus_master( struct pci_device *device )
+{
+    uint32_t command = pci_config_read( device, PCI_REGISTER_COMMAND );
+
+    /* the upper half is the status register, writing its bits back would clear them */
+    command &= 0xFFFF;
+    command |= PCI_COMMAND_IO_SPACE | PCI_COMMAND_MEMORY_SPACE | PCI_COMMAND_BUS_MASTER;
+
+    pci_config_write( device, PCI_REGISTER_COMMAND, command );
+}
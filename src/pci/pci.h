@@ -0,0 +1,65 @@
+#ifndef PCI_H_
+#define PCI_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* configuration space access mechanism #1 */
+#define PCI_CONFIG_ADDRESS             0xCF8
+#define PCI_CONFIG_DATA                0xCFC
+#define PCI_CONFIG_ENABLE              0x80000000
+
+#define PCI_MAX_BUSES                  256
+#define PCI_MAX_SLOTS                  32
+#define PCI_MAX_FUNCTIONS              8
+
+/* configuration space registers */
+#define PCI_REGISTER_VENDOR_ID         0x00
+#define PCI_REGISTER_COMMAND           0x04
+#define PCI_REGISTER_CLASS             0x08
+#define PCI_REGISTER_HEADER_TYPE       0x0C
+#define PCI_REGISTER_BAR0              0x10
+
+#define PCI_VENDOR_NONE                0xFFFF
+#define PCI_HEADER_MULTI_FUNCTION      0x80
+
+#define PCI_COMMAND_IO_SPACE           0x0001
+#define PCI_COMMAND_MEMORY_SPACE       0x0002
+#define PCI_COMMAND_BUS_MASTER         0x0004
+
+#define PCI_BAR_IO_SPACE               0x01
+#define PCI_BAR_IO_ADDRESS_MASK        0xFFFFFFFC
+#define PCI_BAR_MEMORY_ADDRESS_MASK    0xFFFFFFF0
+
+#define PCI_CLASS_MASS_STORAGE         0x01
+#define PCI_SUBCLASS_IDE               0x01
+
+struct pci_device
+{
+    uint8_t bus;
+    uint8_t slot;
+    uint8_t function;
+
+    uint16_t vendor_id;
+    uint16_t device_id;
+    uint8_t class_code;
+    uint8_t subclass;
+    uint8_t prog_if;
+};
+
+uint32_t pci_config_read( struct pci_device *device,
+                          uint8_t offset );
+void pci_config_write( struct pci_device *device,
+                       uint8_t offset,
+                       uint32_t value );
+int pci_find_class( uint8_t class_code,
+                    uint8_t subclass,
+                    struct pci_device *device_out );
+int pci_find_device( uint16_t vendor_id,
+                     uint16_t device_id,
+                     struct pci_device *device_out );
+uint32_t pci_get_bar( struct pci_device *device,
+                      int bar );
+void pci_enable_bus_master( struct pci_device *device );
+
+#endif /* PCI_H_ */
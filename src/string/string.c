@@ -123,6 +123,16 @@ char tolower( char chr )
     return chr;
 }
 
+char toupper( char chr )
+{
+    if( ( chr >= 97 ) && ( chr <= 122 ) )
+    {
+        chr -= 32;
+    }
+
+    return chr;
+}
+
 int istrncmp( const char *str1,
               const char *str2,
               int n )
@@ -21,6 +21,7 @@ int strnlen_terminator( const char *str,
                         int max,
                         char terminator );
 char tolower( char chr );
+char toupper( char chr );
 int istrncmp( const char *str1,
               const char *str2,
               int n );
@@ -7,6 +7,10 @@
 #include "kernel.h"
 #include "memory/paging/paging.h"
 #include "loader/formats/elf_loader.h"
+#include "memory/swap/swap.h"
+#include "memory/ksm/ksm.h"
+#include "memory/shm/shm.h"
+#include "aio/aio.h"
 
 /* the current process that is running */
 struct process *current_process = 0;
@@ -435,42 +439,130 @@ static int process_find_free_allocation_index( struct process *process )
     return res;
 }
 
-void *process_malloc( struct process *process,
-                      size_t size )
+static int process_allocation_total_pages( size_t size )
 {
-    void *ptr = kzalloc( size );
+    return ( uint32_t ) paging_align_address( ( void * ) size ) / PAGING_PAGE_SIZE;
+}
 
-    if( !ptr )
+/* first fit search for a hole in the process heap address space */
+static void *process_find_free_virtual_range( struct process *process,
+                                              size_t size )
+{
+    uint32_t total_bytes = process_allocation_total_pages( size ) * PAGING_PAGE_SIZE;
+    uint32_t candidate   = OS_PROGRAM_VIRTUAL_HEAP_ADDRESS;
+    bool moved           = true;
+
+    while( moved )
     {
-        if( ptr )
+        moved = false;
+
+        for( int idx = 0; idx < OS_MAX_PROGRAMS_ALLOCATIONS; idx++ )
         {
-            kfree( ptr );
+            struct process_allocation *allocation = &process->allocations[ idx ];
+            uint32_t start = ( uint32_t ) allocation->ptr;
+            uint32_t end   = start + ( process_allocation_total_pages( allocation->size ) * PAGING_PAGE_SIZE );
+
+            if( allocation->ptr && ( candidate < end ) && ( candidate + total_bytes > start ) )
+            {
+                candidate = end;
+                moved     = true;
+            }
         }
+    }
 
+    if( candidate + total_bytes > OS_PROGRAM_VIRTUAL_HEAP_ADDRESS + OS_PROGRAM_VIRTUAL_HEAP_SIZE )
+    {
         return 0;
     }
 
-    int index = process_find_free_allocation_index( process );
+    return ( void * ) candidate;
+}
 
-    if( index < 0 )
+/* unmap process heap pages and give their frames and swap slots back */
+static void process_unmap_pages( struct process *process,
+                                 void *virtual,
+                                 int total_pages )
+{
+    uint32_t *directory = paging_chunk_get_directory( process->task->page_directory );
+
+    for( int idx = 0; idx < total_pages; idx++ )
     {
-        if( ptr )
+        void *page     = virtual + ( idx * PAGING_PAGE_SIZE );
+        uint32_t entry = paging_get( directory, page );
+
+        swap_release( process, page, entry );
+
+        if( ( entry & PAGING_IS_PRESENT ) && ( entry & PAGING_IS_MERGED ) )
         {
-            kfree( ptr );
+            ksm_release( ( void * ) ( entry & PAGING_ADDRESS_MASK ) );
+        }
+        else if( entry & PAGING_IS_PRESENT )
+        {
+            kfree( ( void * ) ( entry & PAGING_ADDRESS_MASK ) );
         }
 
-        return 0;
+        paging_set( directory, page, 0x00 );
     }
+}
 
-    int res = paging_map_to( process->task->page_directory, ptr, ptr, paging_align_address( ptr + size ), PAGING_IS_WRITEABLE | PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL );
+/* back a range of the process heap with fresh frames, one page at a time so no physical contiguity is needed */
+static int process_map_new_pages( struct process *process,
+                                  void *virtual,
+                                  int total_pages )
+{
+    int res = OS_OK;
 
-    if( res < 0 )
+    for( int idx = 0; idx < total_pages; idx++ )
     {
-        if( ptr )
+        void *frame = kzalloc( PAGING_PAGE_SIZE );
+
+        if( !frame )
         {
-            kfree( ptr );
+            res = -NO_MEMORY_ERROR;
+            process_unmap_pages( process, virtual, idx );
+            return res;
         }
 
+        /* start out as recently used so the clock gives new pages a full pass */
+        res = paging_map( process->task->page_directory, virtual + ( idx * PAGING_PAGE_SIZE ), frame, SWAP_PAGE_FLAGS | PAGING_IS_ACCESSED );
+
+        if( res < 0 )
+        {
+            kfree( frame );
+            process_unmap_pages( process, virtual, idx );
+            return res;
+        }
+    }
+
+    return res;
+}
+
+void *process_malloc( struct process *process,
+                      size_t size )
+{
+    if( ( size == 0 ) || ( size > OS_PROGRAM_VIRTUAL_HEAP_SIZE ) )
+    {
+        return 0;
+    }
+
+    int index = process_find_free_allocation_index( process );
+
+    if( index < 0 )
+    {
+        return 0;
+    }
+
+    void *ptr = process_find_free_virtual_range( process, size );
+
+    if( !ptr )
+    {
+        return 0;
+    }
+
+    int res = process_map_new_pages( process, ptr, process_allocation_total_pages( size ) );
+
+    if( res < 0 )
+    {
         return 0;
     }
 
@@ -524,6 +616,11 @@ static struct process_allocation *process_get_allocation_by_addr( struct process
 void process_free( struct process *process,
                    void *ptr )
 {
+    if( !ptr )
+    {
+        return;
+    }
+
     /* unlink the pages from the process for the given address */
     struct process_allocation *allocation = process_get_allocation_by_addr( process, ptr );
 
@@ -533,18 +630,11 @@ void process_free( struct process *process,
         return;
     }
 
-    int res = paging_map_to( process->task->page_directory, allocation->ptr, allocation->ptr, paging_align_address( allocation->ptr + allocation->size ), 0x00 );
-
-    if( res < 0 )
-    {
-        return;
-    }
+    /* the pages go back to the kernel heap or swap as we unmap them */
+    process_unmap_pages( process, allocation->ptr, process_allocation_total_pages( allocation->size ) );
 
     /* unjoin the allocation */
     process_allocation_unjoin( process, ptr );
-
-    /* we can now free the memory */
-    kfree( ptr );
 }
 
 void process_get_arguments( struct process *process,
@@ -602,9 +692,10 @@ int process_inject_arguments( struct process *process,
             return res;
         }
 
-        strncpy( argument_str, current->argument, sizeof( current->argument ) );
-        argv[ i ] = argument_str;
-        current   = current->next;
+        /* the allocations are only mapped in the process, write through their physical pages */
+        strncpy( task_virtual_address_to_physical( process->task, argument_str ), current->argument, sizeof( current->argument ) );
+        *( char ** ) task_virtual_address_to_physical( process->task, &argv[ i ] ) = argument_str;
+        current = current->next;
         i++;
     }
 
@@ -618,7 +709,10 @@ static int process_terminate_allocations( struct process *process )
 {
     for( int idx = 0; idx < OS_MAX_PROGRAMS_ALLOCATIONS; idx++ )
     {
-        process_free( process, process->allocations[ idx ].ptr );
+        if( process->allocations[ idx ].ptr )
+        {
+            process_free( process, process->allocations[ idx ].ptr );
+        }
     }
 
     return 0;
@@ -694,6 +788,12 @@ int process_terminate( struct process *process )
         return res;
     }
 
+    /* close the files of the async ring, its memory goes with the shared segments */
+    aio_process_terminate( process );
+
+    /* drop our references, segments nobody else uses are freed */
+    shm_process_terminate( process );
+
     res = process_free_program_data( process );
 
     if( res < 0 )
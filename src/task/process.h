@@ -25,10 +25,18 @@ struct process_arguments
 
 struct process_allocation
 {
+    /* virtual address inside the process heap region */
     void *ptr;
     size_t size;
 };
 
+struct process_shm_attachment
+{
+    /* virtual address inside the process shared memory region, zero when unused */
+    void *ptr;
+    int segment;
+};
+
 struct process
 {
     /* the process id */
@@ -42,6 +50,9 @@ struct process
     /* the memory (malloc) allocations of the process */
     struct process_allocation allocations[ OS_MAX_PROGRAMS_ALLOCATIONS ];
 
+    /* the shared memory segments attached by the process */
+    struct process_shm_attachment shm_attachments[ OS_MAX_SHM_ATTACHMENTS ];
+
     PROCESS_FILETYPE filetype;
 
     union
@@ -73,6 +84,7 @@ struct process
 int process_load( const char *filename,
                   struct process **process );
 struct process *process_current();
+struct process *process_get( int process_id );
 int process_switch( struct process *process );
 int process_load_switch( const char *filename,
                          struct process **process );
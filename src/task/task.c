@@ -8,6 +8,8 @@
 #include "memory/paging/paging.h"
 #include "string/string.h"
 #include "loader/formats/elf_loader.h"
+#include "memory/swap/swap.h"
+#include "memory/ksm/ksm.h"
 
 /* the current task that is running */
 struct task *current_task = 0;
@@ -227,6 +229,10 @@ int copy_string_from_task( struct task *task,
         return res;
     }
 
+    /* the string may sit in swapped out pages, the kernel must not fault on them */
+    swap_ensure_resident( task, virtual );
+    swap_ensure_resident( task, virtual + size - 1 );
+
     uint32_t *task_directory = task->page_directory->directory_entry;
     uint32_t old_entry       = paging_get( task_directory, temp );
 
@@ -278,9 +284,68 @@ void *task_get_stack_item( struct task *task,
 void *task_virtual_address_to_physical( struct task *task,
                                         void *virtual_address )
 {
+    /* the caller is about to use the physical page, bring it back if it was swapped out */
+    swap_ensure_resident( task, virtual_address );
+    /* the kernel may write through the physical page, a merged page must not leak the write */
+    ksm_unshare( task, virtual_address );
+
     return paging_get_physical_address( task->page_directory->directory_entry, virtual_address );
 }
 
+/* like task_virtual_address_to_physical but zero when the page is not mapped, or not writeable for a write */
+void *task_user_address_to_physical( struct task *task,
+                                     void *virtual_address,
+                                     bool write )
+{
+    if( !virtual_address )
+    {
+        return 0;
+    }
+
+    void *physical = task_virtual_address_to_physical( task, virtual_address );
+    uint32_t entry = paging_get( task->page_directory->directory_entry, paging_align_to_lower_page( virtual_address ) );
+
+    if( !( entry & PAGING_IS_PRESENT ) || ( write && !( entry & PAGING_IS_WRITEABLE ) ) )
+    {
+        return 0;
+    }
+
+    return physical;
+}
+
+/* the pages behind a user buffer are not physically contiguous, each one is translated on its own */
+int copy_to_task( struct task *task,
+                  void *virtual,
+                  void *kernel,
+                  uint32_t size )
+{
+    int res = OS_OK;
+
+    while( size > 0 )
+    {
+        uint32_t chunk = PAGING_PAGE_SIZE - ( ( uint32_t ) virtual % PAGING_PAGE_SIZE );
+        void *physical = task_user_address_to_physical( task, virtual, true );
+
+        if( !physical )
+        {
+            res = -INVALID_ARGUMENT_ERROR;
+            return res;
+        }
+
+        if( chunk > size )
+        {
+            chunk = size;
+        }
+
+        memcpy( physical, kernel, chunk );
+        virtual += chunk;
+        kernel  += chunk;
+        size    -= chunk;
+    }
+
+    return res;
+}
+
 void task_next()
 {
     struct task *next_task = task_get_next();
@@ -4,6 +4,7 @@
 #include "config.h"
 #include "memory/paging/paging.h"
 #include <stdint.h>
+#include <stdbool.h>
 
 struct registers
 {
@@ -65,6 +66,13 @@ void *task_get_stack_item( struct task *task,
                            int index );
 void *task_virtual_address_to_physical( struct task *task,
                                         void *virtual_address );
+void *task_user_address_to_physical( struct task *task,
+                                     void *virtual_address,
+                                     bool write );
+int copy_to_task( struct task *task,
+                  void *virtual,
+                  void *kernel,
+                  uint32_t size );
 void task_next();
 
 #endif /* TASK_H_ */
@@ -0,0 +1,13 @@
+section .asm
+
+global tsc_read
+
+; uint64_t tsc_read();
+tsc_read:
+    push ebp
+    mov ebp, esp
+
+    rdtsc               ; edx:eax is already the 64 bit return value
+
+    pop ebp
+    ret
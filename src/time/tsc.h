@@ -0,0 +1,9 @@
+#ifndef TSC_H_
+#define TSC_H_
+
+#include <stdint.h>
+
+/* processor time stamp counter, used to measure latencies in cycles */
+uint64_t tsc_read();
+
+#endif /* TSC_H_ */